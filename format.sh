@@ -15,7 +15,7 @@ if [ -z "$(command -v clang-format)" ]; then
 fi
 
 print_magenta "Formatting C++ files..."
-clang-format -i --verbose --style=file "$REPO"/src/*.cpp "$REPO"/src/*.h
+clang-format -i --verbose --style=file "$REPO"/src/*.cpp "$REPO"/src/*.h "$REPO"/tests/*.cpp
 
 if [ -n "$(command -v shfmt)" ]; then
     print_magenta "Formatting shell scripts..."
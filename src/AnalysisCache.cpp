@@ -1,18 +1,42 @@
 /// Implementation of AnalysisCache.
-/// Manages the SQLite database handle, schema creation, and lightweight column migrations,
-/// and implements the load and store paths for analysis records,
-/// waveform previews, and custom gain values using prepared statements.
+/// Manages the SQLite writer connection, per-thread read-only connections,
+/// schema creation and versioned migrations, and implements the load and store paths for analysis records,
+/// waveform previews, and custom gain values using prepared statements that stay cached per connection.
+/// Also runs the maintenance pass that prunes, evicts, and vacuums, on demand or on a background thread,
+/// and converts rows to and from the portable export format.
 
 #include "AnalysisCache.h"
 
+#include "FileFingerprint.h"
 #include "utils.h"
 #include "version.h"
 
 #include <sqlite3.h>
 
-/// Helpers for marshalling SQLite values into JUCE types.
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <unordered_map>
+
+/// Helpers for marshalling SQLite values into JUCE types and reading analysis rows.
 namespace audiobatch::cache
 {
+/// Columns read by readCurrentRecord, in the order it expects them.
+constexpr auto analysisColumns = R"SQL(
+    file_name, format_name, file_size, modified_time_ms, length_in_samples,
+    duration_seconds, peak_left, peak_right, overall_peak, true_peak_left,
+    true_peak_right, overall_true_peak, max_short_term_lufs, integrated_lufs,
+    sample_rate, channels, bits_per_sample, status, error_message, analysis_version,
+    custom_gain_db, has_custom_gain, analysis_profile, is_complete, fingerprint
+)SQL";
+
+/// Identifies export files in their header line.
+constexpr auto exportFormatName = "AudioBatch analysis cache export";
+/// Version of the export file layout, independent of the database schema.
+constexpr int exportFormatVersion = 1;
+/// Exports are written once and read on many machines, so they use the strongest compression.
+constexpr int exportCompressionLevel = 9;
+
 /// Reads a text column as a juce::String, mapping SQL NULL to an empty string.
 static juce::String columnText(sqlite3_stmt* statement, const int columnIndex)
 {
@@ -50,19 +74,366 @@ static void bindBlob(sqlite3_stmt* statement, const int index, const juce::Memor
 {
     sqlite3_bind_blob(statement, index, data.getData(), static_cast<int>(data.getSize()), SQLITE_TRANSIENT);
 }
+
+/// Borrows a cached prepared statement and resets it when it goes out of scope,
+/// so the statement ends its read transaction and drops its bindings before the next use.
+class ScopedStatement
+{
+public:
+    explicit ScopedStatement(sqlite3_stmt* preparedStatement) : statement(preparedStatement) { }
+
+    ~ScopedStatement()
+    {
+        if (statement != nullptr) {
+            sqlite3_reset(statement);
+            sqlite3_clear_bindings(statement);
+        }
+    }
+
+    /// Returns the borrowed statement, or nullptr when it could not be prepared.
+    operator sqlite3_stmt*() const noexcept
+    {
+        return statement;
+    }
+
+private:
+    sqlite3_stmt* statement = nullptr;
+
+    JUCE_DECLARE_NON_COPYABLE(ScopedStatement)
+};
+
+/// Returns the statement prepared for the SQL text on the connection, preparing it on first use
+/// and keeping it in statements, or nullptr when it does not compile.
+static sqlite3_stmt* getCachedStatement(
+    sqlite3* database,
+    std::unordered_map<juce::String, sqlite3_stmt*>& statements,
+    const juce::String& sql
+)
+{
+    if (const auto found = statements.find(sql); found != statements.end()) {
+        return found->second;
+    }
+
+    sqlite3_stmt* statement = nullptr;
+
+    if (sqlite3_prepare_v3(database, sql.toRawUTF8(), -1, SQLITE_PREPARE_PERSISTENT, &statement, nullptr) != SQLITE_OK)
+    {
+        utils::logError("SQLite error: {}", juce::String::fromUTF8(sqlite3_errmsg(database)));
+        return nullptr;
+    }
+
+    statements.emplace(sql, statement);
+    return statement;
+}
+
+/// Finalizes every statement prepared by getCachedStatement.
+static void finalizeStatements(std::unordered_map<juce::String, sqlite3_stmt*>& statements)
+{
+    for (const auto& [sql, statement] : statements) {
+        sqlite3_finalize(statement);
+    }
+
+    statements.clear();
+}
+
+/// Copies a cached record into record when it is still usable for the file.
+/// The baseline record built from the file supplies the current size and modification time,
+/// and the cached record must come from a profile of at least minimumProfile.
+/// Incomplete records left by a stop-at-peak run also need a peak that reaches stopAtPeakDb.
+static bool acceptCachedRecord(
+    AudioAnalysisRecord cachedRecord,
+    const AudioAnalysisRecord& baseline,
+    const AudioAnalysisProfile minimumProfile,
+    const std::optional<float> stopAtPeakDb,
+    AudioAnalysisRecord& record
+)
+{
+    if (cachedRecord.fileSize != baseline.fileSize || cachedRecord.modifiedTimeMs != baseline.modifiedTimeMs
+        || !cachedRecord.coversProfile(minimumProfile))
+    {
+        return false;
+    }
+
+    if (!cachedRecord.isComplete && (!stopAtPeakDb.has_value() || !cachedRecord.reachesPeakLevel(*stopAtPeakDb))) {
+        return false;
+    }
+
+    if (cachedRecord.status != AudioAnalysisStatus::failed) {
+        cachedRecord.status = AudioAnalysisStatus::cached;
+    }
+
+    cachedRecord.file = baseline.file;
+    cachedRecord.fullPath = baseline.fullPath;
+    cachedRecord.fromCache = true;
+    record = std::move(cachedRecord);
+    return true;
+}
+
+/// Reads a row selected with analysisColumns into record when it is still usable for the file,
+/// following the rules of acceptCachedRecord. The row must also come from the current analysis version.
+static bool readCurrentRecord(
+    sqlite3_stmt* statement,
+    const AudioAnalysisRecord& baseline,
+    const int currentVersion,
+    const AudioAnalysisProfile minimumProfile,
+    const std::optional<float> stopAtPeakDb,
+    AudioAnalysisRecord& record
+)
+{
+    if (sqlite3_column_int64(statement, 2) != baseline.fileSize
+        || sqlite3_column_int64(statement, 3) != baseline.modifiedTimeMs
+        || sqlite3_column_int(statement, 19) != currentVersion)
+    {
+        return false;
+    }
+
+    auto cachedRecord = baseline;
+    cachedRecord.fileName = columnText(statement, 0);
+    cachedRecord.formatName = columnText(statement, 1);
+    cachedRecord.lengthInSamples = sqlite3_column_int64(statement, 4);
+    cachedRecord.durationSeconds = sqlite3_column_double(statement, 5);
+    cachedRecord.peakLeft = static_cast<float>(sqlite3_column_double(statement, 6));
+    cachedRecord.peakRight = static_cast<float>(sqlite3_column_double(statement, 7));
+    cachedRecord.overallPeak = static_cast<float>(sqlite3_column_double(statement, 8));
+    cachedRecord.truePeakLeft = sqlite3_column_double(statement, 9);
+    cachedRecord.truePeakRight = sqlite3_column_double(statement, 10);
+    cachedRecord.overallTruePeak = sqlite3_column_double(statement, 11);
+    cachedRecord.maxShortTermLufs = sqlite3_column_double(statement, 12);
+    cachedRecord.integratedLufs = sqlite3_column_double(statement, 13);
+    cachedRecord.sampleRate = sqlite3_column_int(statement, 14);
+    cachedRecord.channels = sqlite3_column_int(statement, 15);
+    cachedRecord.bitsPerSample = sqlite3_column_int(statement, 16);
+    cachedRecord.status = static_cast<AudioAnalysisStatus>(sqlite3_column_int(statement, 17));
+    cachedRecord.errorMessage = columnText(statement, 18);
+    cachedRecord.customGainDb = static_cast<float>(sqlite3_column_double(statement, 20));
+    cachedRecord.hasCustomGain = sqlite3_column_int(statement, 21) != 0;
+    cachedRecord.profile = static_cast<AudioAnalysisProfile>(sqlite3_column_int(statement, 22));
+    cachedRecord.isComplete = sqlite3_column_int(statement, 23) != 0;
+    cachedRecord.fingerprint = columnText(statement, 24);
+
+    return acceptCachedRecord(std::move(cachedRecord), baseline, minimumProfile, stopAtPeakDb, record);
+}
+
+/// Binds the key range of every path below the directory prefix, which ends with a separator,
+/// to the first two parameters of the statement.
+/// Paths below the prefix form one contiguous key range, since every one of them starts with it.
+/// Incrementing the trailing separator gives the first key past the range.
+static void bindPrefixRange(sqlite3_stmt* statement, const juce::String& prefix)
+{
+    bindText(statement, 1, prefix);
+    const auto separatorSuccessor = static_cast<juce::juce_wchar>(prefix.getLastCharacter() + 1);
+    bindText(statement, 2, prefix.dropLastCharacters(1) + juce::String::charToString(separatorSuccessor));
+}
+
+/// Builds the export entry of a record. The relative path always uses forward slashes.
+static juce::var toExportEntry(const AudioAnalysisRecord& record, const juce::String& relativePath)
+{
+    auto* entry = new juce::DynamicObject();
+    entry->setProperty("path", relativePath.replaceCharacter('\\', '/'));
+    entry->setProperty("fingerprint", record.fingerprint);
+    entry->setProperty("fileSize", static_cast<juce::int64>(record.fileSize));
+    entry->setProperty("modifiedTimeMs", static_cast<juce::int64>(record.modifiedTimeMs));
+    entry->setProperty("formatName", record.formatName);
+    entry->setProperty("lengthInSamples", static_cast<juce::int64>(record.lengthInSamples));
+    entry->setProperty("durationSeconds", record.durationSeconds);
+    entry->setProperty("peakLeft", record.peakLeft);
+    entry->setProperty("peakRight", record.peakRight);
+    entry->setProperty("overallPeak", record.overallPeak);
+    entry->setProperty("truePeakLeft", record.truePeakLeft);
+    entry->setProperty("truePeakRight", record.truePeakRight);
+    entry->setProperty("overallTruePeak", record.overallTruePeak);
+    entry->setProperty("maxShortTermLufs", record.maxShortTermLufs);
+    entry->setProperty("integratedLufs", record.integratedLufs);
+    entry->setProperty("sampleRate", record.sampleRate);
+    entry->setProperty("channels", record.channels);
+    entry->setProperty("bitsPerSample", record.bitsPerSample);
+    entry->setProperty("profile", static_cast<int>(record.profile));
+    return entry;
+}
+
+/// Reads the analysis fields of an export entry over the baseline record of the local file.
+static AudioAnalysisRecord fromExportEntry(const juce::var& entry, const AudioAnalysisRecord& baseline)
+{
+    auto record = baseline;
+    record.fingerprint = entry["fingerprint"].toString();
+    record.formatName = entry["formatName"].toString();
+    record.lengthInSamples = static_cast<juce::int64>(entry["lengthInSamples"]);
+    record.durationSeconds = static_cast<double>(entry["durationSeconds"]);
+    record.peakLeft = static_cast<float>(entry["peakLeft"]);
+    record.peakRight = static_cast<float>(entry["peakRight"]);
+    record.overallPeak = static_cast<float>(entry["overallPeak"]);
+    record.truePeakLeft = static_cast<double>(entry["truePeakLeft"]);
+    record.truePeakRight = static_cast<double>(entry["truePeakRight"]);
+    record.overallTruePeak = static_cast<double>(entry["overallTruePeak"]);
+    record.maxShortTermLufs = static_cast<double>(entry["maxShortTermLufs"]);
+    record.integratedLufs = static_cast<double>(entry["integratedLufs"]);
+    record.sampleRate = static_cast<int>(entry["sampleRate"]);
+    record.channels = static_cast<int>(entry["channels"]);
+    record.bitsPerSample = static_cast<int>(entry["bitsPerSample"]);
+    record.profile = static_cast<AudioAnalysisProfile>(
+        juce::jlimit(0, static_cast<int>(AudioAnalysisProfile::full), static_cast<int>(entry["profile"]))
+    );
+    record.status = AudioAnalysisStatus::analyzed;
+    return record;
+}
+
+/// Returns true when the fingerprint was computed over every byte of the file.
+static bool isFullFingerprint(const juce::String& fingerprint)
+{
+    return FileFingerprint::parseModeName(fingerprint.upToFirstOccurrenceOf(":", false, false))
+        == AudioFingerprintMode::full;
+}
+
+/// Returns true when the local file holds the content the export entry was analyzed from.
+/// Files copied between machines usually get new modification times, so those are matched by fingerprint.
+/// Only a full fingerprint can stand in for the modification time: a fast one skips the middle of the file,
+/// which an edit with the same size, such as a gain change, leaves different.
+static bool matchesExportEntry(const juce::var& entry, const AudioAnalysisRecord& baseline)
+{
+    if (static_cast<juce::int64>(entry["fileSize"]) != baseline.fileSize) {
+        return false;
+    }
+
+    if (static_cast<juce::int64>(entry["modifiedTimeMs"]) == baseline.modifiedTimeMs) {
+        return true;
+    }
+
+    const auto fingerprint = entry["fingerprint"].toString();
+
+    return isFullFingerprint(fingerprint)
+        && FileFingerprint::compute(baseline.file, AudioFingerprintMode::full) == fingerprint;
+}
+
+/// Runs a query returning a single integer, such as a pragma or a count, and returns it, or 0 when it fails.
+static std::int64_t queryInteger(sqlite3* connection, const char* sql)
+{
+    sqlite3_stmt* statement = nullptr;
+    std::int64_t value = 0;
+
+    if (sqlite3_prepare_v2(connection, sql, -1, &statement, nullptr) == SQLITE_OK
+        && sqlite3_step(statement) == SQLITE_ROW)
+    {
+        value = sqlite3_column_int64(statement, 0);
+    }
+
+    sqlite3_finalize(statement);
+    return value;
+}
+
+/// Returns the size of the database in bytes, free pages included.
+static std::int64_t databaseBytes(sqlite3* connection)
+{
+    return queryInteger(connection, "PRAGMA page_count;") * queryInteger(connection, "PRAGMA page_size;");
+}
+
+/// Returns true when the file is gone while its folder is still there.
+/// When the folder is missing too, the file may be on a drive or share that is not mounted right now.
+static bool isMissingFile(const juce::File& file)
+{
+    return !file.existsAsFile() && file.getParentDirectory().isDirectory();
+}
 }  // namespace audiobatch::cache
 
 using namespace audiobatch::cache;
 
-AnalysisCache::AnalysisCache()
+AnalysisCache::AnalysisCache() :
+    AnalysisCache(
+        juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+            .getChildFile(version::APP_NAME)
+            .getChildFile("analysis.db")
+    )
+{ }
+
+AnalysisCache::AnalysisCache(juce::File databaseLocation) : databaseFile(std::move(databaseLocation)) { }
+
+/// Read-only connection owned by one thread, with its own prepared statements.
+/// Opened without SQLite's internal mutex, since no other thread ever uses it.
+struct AnalysisCache::ReadConnection {
+    sqlite3* database = nullptr;
+    std::unordered_map<juce::String, sqlite3_stmt*> preparedStatements;
+
+    ReadConnection() = default;
+
+    ~ReadConnection()
+    {
+        finalizeStatements(preparedStatements);
+        sqlite3_close(database);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE(ReadConnection)
+};
+
+/// Commits queued analysis records in batches, off the analysis worker threads.
+class AnalysisCache::WriteBehindThread final : public juce::Thread
 {
-    const auto appDataDirectory
-        = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory).getChildFile(version::APP_NAME);
-    databaseFile = appDataDirectory.getChildFile("analysis.db");
-}
+public:
+    explicit WriteBehindThread(AnalysisCache& owner) : juce::Thread("Analysis cache writer"), cache(owner) { }
+
+    void run() override
+    {
+        bool retryPending = false;
+
+        while (!threadShouldExit()) {
+            // Sleep until the first record is queued, then give the batch until the interval ends to fill up.
+            // A full batch notifies the thread again, which cuts the second wait short.
+            // Enqueueing only notifies for the first record and for full batches, so records left queued
+            // by a failed commit would wait for the next full batch. They are retried on a timer instead.
+            if (retryPending) {
+                wait(writeRetryIntervalMs);
+            } else {
+                wait(-1);
+
+                if (!threadShouldExit()) {
+                    wait(writeIntervalMs);
+                }
+            }
+
+            const auto committed = cache.flushPendingAnalyses();
+            const juce::ScopedLock lock(cache.pendingLock);
+            retryPending = !committed || !cache.pendingRecords.empty();
+        }
+    }
+
+private:
+    AnalysisCache& cache;
+};
+
+/// Runs one maintenance pass without blocking the thread that asked for it.
+class AnalysisCache::MaintenanceThread final : public juce::Thread
+{
+public:
+    MaintenanceThread(AnalysisCache& owner, const AnalysisCacheMaintenanceOptions& maintenanceOptions) :
+        juce::Thread("Analysis cache maintenance"),
+        cache(owner),
+        options(maintenanceOptions)
+    { }
+
+    void run() override
+    {
+        cache.runMaintenance(options, [this] { return threadShouldExit(); });
+        cache.closeReadConnection();
+    }
+
+private:
+    AnalysisCache& cache;
+    AnalysisCacheMaintenanceOptions options;
+};
 
 AnalysisCache::~AnalysisCache()
 {
+    if (maintenanceThread != nullptr) {
+        maintenanceThread->stopThread(-1);
+    }
+
+    if (writeBehindThread != nullptr) {
+        writeBehindThread->signalThreadShouldExit();
+        writeBehindThread->notify();
+        writeBehindThread->stopThread(-1);
+    }
+
+    // Records queued after the writer's last commit are stored here, so none are lost on shutdown.
+    flushPendingAnalyses();
+
     const juce::ScopedLock lock(mutex);
     closeUnlocked();
 }
@@ -111,6 +482,14 @@ void AnalysisCache::closeUnlocked()
     const auto startedAtMs = juce::Time::getMillisecondCounterHiRes();
     const auto databasePath = databaseFile.getFullPathName();
 
+    schemaReady = false;
+
+    {
+        const juce::ScopedLock readLock(readConnectionsLock);
+        readConnections.clear();
+    }
+
+    finalizeStatements(preparedStatements);
     sqlite3_close(database);
     database = nullptr;
 
@@ -121,6 +500,86 @@ void AnalysisCache::closeUnlocked()
     );
 }
 
+sqlite3_stmt* AnalysisCache::getPreparedStatement(const juce::String& sql)
+{
+    return getCachedStatement(database, preparedStatements, sql);
+}
+
+AnalysisCache::ReadConnection* AnalysisCache::getReadConnection()
+{
+    // The writer creates the database and migrates the schema, so it opens first.
+    if (!schemaReady && !open()) {
+        return nullptr;
+    }
+
+    const auto threadId = juce::Thread::getCurrentThreadId();
+    const juce::ScopedLock lock(readConnectionsLock);
+
+    if (const auto found = readConnections.find(threadId); found != readConnections.end()) {
+        return found->second.get();
+    }
+
+    auto connection = std::make_unique<ReadConnection>();
+    const auto result = sqlite3_open_v2(
+        databaseFile.getFullPathName().toRawUTF8(),
+        &connection->database,
+        SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX,
+        nullptr
+    );
+
+    if (result != SQLITE_OK || connection->database == nullptr) {
+        utils::logError(
+            "Failed to open analysis cache read connection at {}", databaseFile.getFullPathName().quoted()
+        );
+        return nullptr;
+    }
+
+    sqlite3_busy_timeout(connection->database, 2000);
+    utils::logDebug("Opened analysis cache read connection ({} open)", readConnections.size() + 1);
+
+    return readConnections.emplace(threadId, std::move(connection)).first->second.get();
+}
+
+void AnalysisCache::closeReadConnection()
+{
+    const juce::ScopedLock lock(readConnectionsLock);
+    readConnections.erase(juce::Thread::getCurrentThreadId());
+}
+
+std::optional<AudioAnalysisRecord> AnalysisCache::findQueuedAnalysis(const juce::String& path) const
+{
+    const juce::ScopedLock lock(pendingLock);
+
+    // Records queued later replace earlier ones, and the pending queue is newer than the batch being committed.
+    for (const auto* queue : {&pendingRecords, &committingRecords}) {
+        for (auto pending = queue->rbegin(); pending != queue->rend(); ++pending) {
+            if (pending->record.fullPath == path) {
+                return pending->record;
+            }
+        }
+    }
+
+    return std::nullopt;
+}
+
+std::unordered_map<juce::String, AudioAnalysisRecord> AnalysisCache::getQueuedAnalyses(
+    const std::unordered_map<juce::String, size_t>& fileIndices
+) const
+{
+    const juce::ScopedLock lock(pendingLock);
+    std::unordered_map<juce::String, AudioAnalysisRecord> records;
+
+    for (const auto* queue : {&committingRecords, &pendingRecords}) {
+        for (const auto& pending : *queue) {
+            if (fileIndices.contains(pending.record.fullPath)) {
+                records.insert_or_assign(pending.record.fullPath, pending.record);
+            }
+        }
+    }
+
+    return records;
+}
+
 bool AnalysisCache::columnExists(const juce::String& tableName, const juce::String& columnName) const
 {
     const auto sql = utils::format("PRAGMA table_info({});", tableName);
@@ -169,7 +628,7 @@ bool AnalysisCache::openUnlocked()
     const auto result = sqlite3_open_v2(
         databaseFile.getFullPathName().toRawUTF8(),
         &database,
-        SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX,
+        SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX,
         nullptr
     );
 
@@ -190,198 +649,584 @@ bool AnalysisCache::openUnlocked()
     sqlite3_busy_timeout(database, 2000);
 
     utils::logDebug("Analysis cache startup: applying SQLite pragmas");
-    if (!execute("PRAGMA journal_mode=WAL;") || !execute("PRAGMA synchronous=NORMAL;")) {
+    // auto_vacuum only takes effect before the first table is created. Existing databases switch to it
+    // the next time they are vacuumed.
+    if (!execute("PRAGMA auto_vacuum=INCREMENTAL;") || !execute("PRAGMA journal_mode=WAL;")
+        || !execute("PRAGMA synchronous=NORMAL;"))
+    {
         return false;
     }
 
-    utils::logDebug("Analysis cache startup: ensuring schema");
-    if (!execute(R"SQL(
-        CREATE TABLE IF NOT EXISTS file_analysis (
-            file_path TEXT PRIMARY KEY,
-            file_name TEXT NOT NULL,
-            format_name TEXT,
-            file_size INTEGER NOT NULL,
-            modified_time_ms INTEGER NOT NULL,
-            length_in_samples INTEGER NOT NULL,
-            duration_seconds REAL NOT NULL,
-            peak_left REAL NOT NULL,
-            peak_right REAL NOT NULL,
-            overall_peak REAL NOT NULL,
-            true_peak_left REAL NOT NULL DEFAULT 0,
-            true_peak_right REAL NOT NULL DEFAULT 0,
-            overall_true_peak REAL NOT NULL DEFAULT 0,
-            max_short_term_lufs REAL NOT NULL DEFAULT -1000,
-            integrated_lufs REAL NOT NULL DEFAULT -1000,
-            sample_rate INTEGER NOT NULL,
-            channels INTEGER NOT NULL,
-            bits_per_sample INTEGER NOT NULL,
-            custom_gain_db REAL NOT NULL DEFAULT 0,
-            has_custom_gain INTEGER NOT NULL DEFAULT 0,
-            status INTEGER NOT NULL,
-            error_message TEXT,
-            waveform_data BLOB,
-            waveform_version INTEGER NOT NULL DEFAULT 0,
-            analysis_version INTEGER NOT NULL,
-            updated_at_ms INTEGER NOT NULL
+    utils::logDebug("Analysis cache startup: checking schema version");
+    const auto databaseVersion = static_cast<int>(queryInteger(database, "PRAGMA user_version;"));
+
+    if (databaseVersion > schemaVersion) {
+        // Newer versions may move or drop columns, as version 5 did with the waveform data.
+        // Statements that use a column that is gone fail to prepare, so their lookups miss and stores fail,
+        // and the newer rows are left as they are.
+        utils::logWarn(
+            "Analysis cache schema version {} is newer than this build's version {}", databaseVersion, schemaVersion
         );
-    )SQL"))
-    {
+    } else if (databaseVersion < schemaVersion && !migrateSchema(databaseVersion)) {
         return false;
     }
 
-    if (!columnExists("file_analysis", "waveform_data")
-        && !execute("ALTER TABLE file_analysis ADD COLUMN waveform_data BLOB;"))
-    {
-        return false;
-    }
+    schemaReady = true;
+    utils::logDebug("Analysis cache startup: schema ready");
+    utils::logDebug(
+        "Opened analysis cache at {} ({}) in {:.3f} s",
+        databasePath.quoted(),
+        databaseFound ? "existing" : "new",
+        (juce::Time::getMillisecondCounterHiRes() - startedAtMs) / 1000.0
+    );
 
-    if (!columnExists("file_analysis", "waveform_version")
-        && !execute("ALTER TABLE file_analysis ADD COLUMN waveform_version INTEGER NOT NULL DEFAULT 0;"))
-    {
-        return false;
-    }
+    return true;
+}
 
-    if (!columnExists("file_analysis", "true_peak_left")
-        && !execute("ALTER TABLE file_analysis ADD COLUMN true_peak_left REAL NOT NULL DEFAULT 0;"))
-    {
-        return false;
-    }
+bool AnalysisCache::moveWaveformsToPreviewTable()
+{
+    // Dropping the columns rewrites the table once; older SQLite versions only clear them instead.
+    constexpr int dropColumnVersion = 3035000;
+    const auto canDropColumns = sqlite3_libversion_number() >= dropColumnVersion;
 
-    if (!columnExists("file_analysis", "true_peak_right")
-        && !execute("ALTER TABLE file_analysis ADD COLUMN true_peak_right REAL NOT NULL DEFAULT 0;"))
+    if (!execute(R"SQL(
+        INSERT OR IGNORE INTO waveform_preview (
+            file_path, file_size, modified_time_ms, waveform_version, waveform_data, updated_at_ms
+        )
+        SELECT file_path, file_size, modified_time_ms, waveform_version, waveform_data, updated_at_ms
+        FROM file_analysis
+        WHERE length(waveform_data) > 0;
+    )SQL"))
     {
         return false;
     }
 
-    if (!columnExists("file_analysis", "overall_true_peak")
-        && !execute("ALTER TABLE file_analysis ADD COLUMN overall_true_peak REAL NOT NULL DEFAULT 0;"))
-    {
-        return false;
+    if (const auto movedRows = sqlite3_changes(database); movedRows > 0) {
+        utils::logInfo("Moved {} waveform previews out of the analysis table", movedRows);
     }
 
-    if (!columnExists("file_analysis", "max_short_term_lufs")
-        && !execute("ALTER TABLE file_analysis ADD COLUMN max_short_term_lufs REAL NOT NULL DEFAULT -1000;"))
-    {
-        return false;
-    }
+    return canDropColumns
+        ? execute("ALTER TABLE file_analysis DROP COLUMN waveform_data;")
+            && execute("ALTER TABLE file_analysis DROP COLUMN waveform_version;")
+        : execute("UPDATE file_analysis SET waveform_data = NULL WHERE waveform_data IS NOT NULL;");
+}
 
-    if (!columnExists("file_analysis", "integrated_lufs")
-        && !execute("ALTER TABLE file_analysis ADD COLUMN integrated_lufs REAL NOT NULL DEFAULT -1000;"))
-    {
+bool AnalysisCache::addColumnIfMissing(
+    const juce::String& tableName,
+    const juce::String& columnName,
+    const juce::String& definition
+)
+{
+    return columnExists(tableName, columnName)
+        || execute(utils::format("ALTER TABLE {} ADD COLUMN {} {};", tableName, columnName, definition));
+}
+
+bool AnalysisCache::migrateSchema(const int fromVersion)
+{
+    const auto startedAtMs = juce::Time::getMillisecondCounterHiRes();
+
+    if (!execute("BEGIN IMMEDIATE;")) {
         return false;
     }
 
-    if (!columnExists("file_analysis", "custom_gain_db")
-        && !execute("ALTER TABLE file_analysis ADD COLUMN custom_gain_db REAL NOT NULL DEFAULT 0;"))
-    {
-        return false;
+    for (int version = fromVersion + 1; version <= schemaVersion; ++version) {
+        if (!applySchemaMigration(version)) {
+            utils::logError("Analysis cache schema migration to version {} failed", version);
+            execute("ROLLBACK;");
+            return false;
+        }
     }
 
-    if (!columnExists("file_analysis", "has_custom_gain")
-        && !execute("ALTER TABLE file_analysis ADD COLUMN has_custom_gain INTEGER NOT NULL DEFAULT 0;"))
-    {
+    if (!execute(utils::format("PRAGMA user_version = {};", schemaVersion)) || !execute("COMMIT;")) {
+        execute("ROLLBACK;");
         return false;
     }
 
-    utils::logDebug("Analysis cache startup: schema ready");
-    utils::logDebug(
-        "Opened analysis cache at {} ({}) in {:.3f} s",
-        databasePath.quoted(),
-        databaseFound ? "existing" : "new",
+    // Steps that drop columns or move data leave free pages behind. Vacuuming here would hold up the open,
+    // and with it the GUI, for as long as rewriting the file takes, so the next maintenance pass reclaims them.
+
+    utils::logInfo(
+        "Migrated analysis cache schema from version {} to {} in {:.3f} s",
+        fromVersion,
+        schemaVersion,
         (juce::Time::getMillisecondCounterHiRes() - startedAtMs) / 1000.0
     );
 
     return true;
 }
 
-bool AnalysisCache::getAnalysis(const juce::File& file, AudioAnalysisRecord& record)
+bool AnalysisCache::applySchemaMigration(const int version)
 {
-    const juce::ScopedLock lock(mutex);
+    // Databases created before the schema was versioned report version 0 whatever their layout,
+    // so every step checks for what it adds and can run on a table that already has it.
+    switch (version) {
+        case 1:
+            // The original analysis table, with the waveform stored in each row.
+            // Columns added before versioning are added here when the table predates them.
+            return execute(R"SQL(
+                    CREATE TABLE IF NOT EXISTS file_analysis (
+                        file_path TEXT PRIMARY KEY,
+                        file_name TEXT NOT NULL,
+                        format_name TEXT,
+                        file_size INTEGER NOT NULL,
+                        modified_time_ms INTEGER NOT NULL,
+                        length_in_samples INTEGER NOT NULL,
+                        duration_seconds REAL NOT NULL,
+                        peak_left REAL NOT NULL,
+                        peak_right REAL NOT NULL,
+                        overall_peak REAL NOT NULL,
+                        true_peak_left REAL NOT NULL DEFAULT 0,
+                        true_peak_right REAL NOT NULL DEFAULT 0,
+                        overall_true_peak REAL NOT NULL DEFAULT 0,
+                        max_short_term_lufs REAL NOT NULL DEFAULT -1000,
+                        integrated_lufs REAL NOT NULL DEFAULT -1000,
+                        sample_rate INTEGER NOT NULL,
+                        channels INTEGER NOT NULL,
+                        bits_per_sample INTEGER NOT NULL,
+                        custom_gain_db REAL NOT NULL DEFAULT 0,
+                        has_custom_gain INTEGER NOT NULL DEFAULT 0,
+                        status INTEGER NOT NULL,
+                        error_message TEXT,
+                        waveform_data BLOB,
+                        waveform_version INTEGER NOT NULL DEFAULT 0,
+                        analysis_version INTEGER NOT NULL,
+                        updated_at_ms INTEGER NOT NULL
+                    );
+                )SQL")
+                && addColumnIfMissing("file_analysis", "true_peak_left", "REAL NOT NULL DEFAULT 0")
+                && addColumnIfMissing("file_analysis", "true_peak_right", "REAL NOT NULL DEFAULT 0")
+                && addColumnIfMissing("file_analysis", "overall_true_peak", "REAL NOT NULL DEFAULT 0")
+                && addColumnIfMissing("file_analysis", "max_short_term_lufs", "REAL NOT NULL DEFAULT -1000")
+                && addColumnIfMissing("file_analysis", "integrated_lufs", "REAL NOT NULL DEFAULT -1000")
+                && addColumnIfMissing("file_analysis", "custom_gain_db", "REAL NOT NULL DEFAULT 0")
+                && addColumnIfMissing("file_analysis", "has_custom_gain", "INTEGER NOT NULL DEFAULT 0");
+        case 2:
+            // Rows written before profiles existed always came from a full analysis.
+            return addColumnIfMissing("file_analysis", "analysis_profile", "INTEGER NOT NULL DEFAULT 2");
+        case 3:
+            return addColumnIfMissing("file_analysis", "is_complete", "INTEGER NOT NULL DEFAULT 1");
+        case 4:
+            // Rows without a fingerprint are never looked up by one, so they stay out of the index.
+            return addColumnIfMissing("file_analysis", "fingerprint", "TEXT") && execute(R"SQL(
+                    CREATE INDEX IF NOT EXISTS file_analysis_fingerprint
+                    ON file_analysis (fingerprint) WHERE fingerprint IS NOT NULL;
+                )SQL");
+        case 5:
+            // Waveforms live in their own table, so analysis rows stay small and storing an analysis leaves them
+            // alone. Each preview row carries the size and modification time of the file it was drawn from.
+            return execute(R"SQL(
+                    CREATE TABLE IF NOT EXISTS waveform_preview (
+                        file_path TEXT PRIMARY KEY,
+                        file_size INTEGER NOT NULL,
+                        modified_time_ms INTEGER NOT NULL,
+                        waveform_version INTEGER NOT NULL,
+                        waveform_data BLOB NOT NULL,
+                        updated_at_ms INTEGER NOT NULL
+                    );
+                )SQL")
+                && (!columnExists("file_analysis", "waveform_data") || moveWaveformsToPreviewTable());
+        case 6:
+            return addColumnIfMissing("waveform_preview", "last_used_ms", "INTEGER NOT NULL DEFAULT 0");
+        default:
+            return false;
+    }
+}
 
-    if (database == nullptr && !openUnlocked()) {
+bool AnalysisCache::getAnalysis(
+    const juce::File& file,
+    AudioAnalysisRecord& record,
+    const AudioAnalysisProfile minimumProfile,
+    const std::optional<float> stopAtPeakDb
+)
+{
+    const auto path = normalizedPath(file);
+    const auto baseline = AudioAnalysisRecord::fromFile(file);
+
+    if (auto queuedRecord = findQueuedAnalysis(path)) {
+        return acceptCachedRecord(std::move(*queuedRecord), baseline, minimumProfile, stopAtPeakDb, record);
+    }
+
+    auto* connection = getReadConnection();
+    if (connection == nullptr) {
         return false;
     }
 
-    constexpr auto sql = R"SQL(
-        SELECT file_name, format_name, file_size, modified_time_ms, length_in_samples,
-               duration_seconds, peak_left, peak_right, overall_peak, true_peak_left,
-               true_peak_right, overall_true_peak, max_short_term_lufs, integrated_lufs,
-               sample_rate, channels, bits_per_sample, status, error_message, analysis_version,
-               custom_gain_db, has_custom_gain
-        FROM file_analysis
-        WHERE file_path = ?;
-    )SQL";
+    static const auto sql = utils::format("SELECT {} FROM file_analysis WHERE file_path = ?;", analysisColumns);
 
-    sqlite3_stmt* statement = nullptr;
-    if (sqlite3_prepare_v2(database, sql, -1, &statement, nullptr) != SQLITE_OK) {
+    const ScopedStatement statement(getCachedStatement(connection->database, connection->preparedStatements, sql));
+    if (statement == nullptr) {
         return false;
     }
 
-    bindText(statement, 1, normalizedPath(file));
+    bindText(statement, 1, path);
 
-    if (const auto stepResult = sqlite3_step(statement); stepResult != SQLITE_ROW) {
-        sqlite3_finalize(statement);
-        return false;
+    return sqlite3_step(statement) == SQLITE_ROW
+        && readCurrentRecord(statement, baseline, analysisVersion, minimumProfile, stopAtPeakDb, record);
+}
+
+AnalysisCacheLookup AnalysisCache::getAnalyses(
+    const std::vector<AudioFileInfo>& files,
+    const AudioAnalysisProfile minimumProfile,
+    const std::optional<float> stopAtPeakDb
+)
+{
+    AnalysisCacheLookup lookup;
+    auto* connection = files.empty() ? nullptr : getReadConnection();
+
+    if (connection == nullptr) {
+        lookup.misses = files;
+        return lookup;
     }
 
-    const auto cachedFileSize = sqlite3_column_int64(statement, 2);
-    const auto cachedModifiedTime = sqlite3_column_int64(statement, 3);
-    const auto cachedVersion = sqlite3_column_int(statement, 19);
+    static const auto sql = utils::format("SELECT {} FROM file_analysis WHERE file_path = ?;", analysisColumns);
 
-    if (cachedFileSize != file.getSize() || cachedModifiedTime != file.getLastModificationTime().toMilliseconds()
-        || cachedVersion != analysisVersion)
-    {
-        sqlite3_finalize(statement);
-        return false;
+    const ScopedStatement statement(getCachedStatement(connection->database, connection->preparedStatements, sql));
+    if (statement == nullptr) {
+        lookup.misses = files;
+        return lookup;
     }
 
-    record = AudioAnalysisRecord::fromFile(file);
-    record.fileName = columnText(statement, 0);
-    record.formatName = columnText(statement, 1);
-    record.lengthInSamples = sqlite3_column_int64(statement, 4);
-    record.durationSeconds = sqlite3_column_double(statement, 5);
-    record.peakLeft = static_cast<float>(sqlite3_column_double(statement, 6));
-    record.peakRight = static_cast<float>(sqlite3_column_double(statement, 7));
-    record.overallPeak = static_cast<float>(sqlite3_column_double(statement, 8));
-    record.truePeakLeft = sqlite3_column_double(statement, 9);
-    record.truePeakRight = sqlite3_column_double(statement, 10);
-    record.overallTruePeak = sqlite3_column_double(statement, 11);
-    record.maxShortTermLufs = sqlite3_column_double(statement, 12);
-    record.integratedLufs = sqlite3_column_double(statement, 13);
-    record.sampleRate = sqlite3_column_int(statement, 14);
-    record.channels = sqlite3_column_int(statement, 15);
-    record.bitsPerSample = sqlite3_column_int(statement, 16);
-    record.status = static_cast<AudioAnalysisStatus>(sqlite3_column_int(statement, 17));
-    record.errorMessage = columnText(statement, 18);
-    record.customGainDb = static_cast<float>(sqlite3_column_double(statement, 20));
-    record.hasCustomGain = sqlite3_column_int(statement, 21) != 0;
-    record.fromCache = true;
-
-    if (record.status != AudioAnalysisStatus::failed) {
-        record.status = AudioAnalysisStatus::cached;
+    const auto startedAtMs = juce::Time::getMillisecondCounterHiRes();
+    std::vector<juce::String> paths;
+    std::unordered_map<juce::String, size_t> fileIndices;
+    paths.reserve(files.size());
+    fileIndices.reserve(files.size());
+
+    for (size_t index = 0; index < files.size(); ++index) {
+        paths.push_back(normalizedPath(files[index].file));
+        fileIndices.emplace(paths.back(), index);
     }
 
-    sqlite3_finalize(statement);
-    return true;
+    // Taken before the rows are read: a record leaves the queue only once its row is visible,
+    // so every file is found in one place or the other.
+    auto queuedRecords = getQueuedAnalyses(fileIndices);
+
+    // One indexed lookup per file, so a batch costs the same however many rows the rest of the cache holds.
+    // Going through the files in path order keeps consecutive lookups on neighbouring index pages,
+    // and a single read transaction saves taking a snapshot for each of them.
+    std::vector<size_t> lookupOrder(files.size());
+    std::iota(lookupOrder.begin(), lookupOrder.end(), size_t {0});
+    std::ranges::sort(lookupOrder, [&paths](const size_t left, const size_t right) {
+        return paths[left] < paths[right];
+    });
+
+    std::vector<std::optional<AudioAnalysisRecord>> cachedRecords(files.size());
+    const auto inTransaction = sqlite3_exec(connection->database, "BEGIN;", nullptr, nullptr, nullptr) == SQLITE_OK;
+
+    for (const auto index : lookupOrder) {
+        const auto baseline = AudioAnalysisRecord::fromFileInfo(files[index]);
+        AudioAnalysisRecord record;
+
+        if (const auto queued = queuedRecords.find(paths[index]); queued != queuedRecords.end()) {
+            if (acceptCachedRecord(std::move(queued->second), baseline, minimumProfile, stopAtPeakDb, record)) {
+                cachedRecords[index] = std::move(record);
+            }
+
+            continue;
+        }
+
+        bindText(statement, 1, paths[index]);
+
+        if (sqlite3_step(statement) == SQLITE_ROW
+            && readCurrentRecord(statement, baseline, analysisVersion, minimumProfile, stopAtPeakDb, record))
+        {
+            cachedRecords[index] = std::move(record);
+        }
+
+        sqlite3_reset(statement);
+    }
+
+    if (inTransaction) {
+        sqlite3_exec(connection->database, "COMMIT;", nullptr, nullptr, nullptr);
+    }
+
+    for (size_t index = 0; index < files.size(); ++index) {
+        if (auto& cachedRecord = cachedRecords[index]; cachedRecord.has_value()) {
+            lookup.hits.push_back(std::move(*cachedRecord));
+        } else {
+            lookup.misses.push_back(files[index]);
+        }
+    }
+
+    utils::logDebug(
+        "Looked up {} files in the analysis cache: {} hits, {} misses in {:.3f} s",
+        files.size(),
+        lookup.hits.size(),
+        lookup.misses.size(),
+        (juce::Time::getMillisecondCounterHiRes() - startedAtMs) / 1000.0
+    );
+
+    return lookup;
 }
 
-bool AnalysisCache::storeAnalysis(const AudioAnalysisRecord& record)
+bool AnalysisCache::reuseAnalysisByFingerprint(
+    const AudioFileInfo& fileInfo,
+    const juce::String& fingerprint,
+    const AudioAnalysisProfile minimumProfile,
+    const std::optional<float> stopAtPeakDb,
+    AudioAnalysisRecord& record
+)
 {
-    const juce::ScopedLock lock(mutex);
+    if (fingerprint.isEmpty()) {
+        return false;
+    }
 
-    if (database == nullptr && !openUnlocked()) {
+    auto* connection = getReadConnection();
+    if (connection == nullptr) {
         return false;
     }
 
-    constexpr auto sql = R"SQL(
+    // The most recently stored match is tried first, as the likeliest one to still carry a waveform.
+    static const auto sql = utils::format(
+        R"SQL(
+            SELECT {}, file_path FROM file_analysis
+            WHERE fingerprint = ? AND file_size = ?
+            ORDER BY updated_at_ms DESC;
+        )SQL",
+        analysisColumns
+    );
+
+    const ScopedStatement statement(getCachedStatement(connection->database, connection->preparedStatements, sql));
+    if (statement == nullptr) {
+        return false;
+    }
+
+    const auto baseline = AudioAnalysisRecord::fromFileInfo(fileInfo);
+    const auto path = normalizedPath(fileInfo.file);
+    const auto fullFingerprint = isFullFingerprint(fingerprint);
+    bindText(statement, 1, fingerprint);
+    sqlite3_bind_int64(statement, 2, baseline.fileSize);
+
+    constexpr int filePathColumn = 25;
+
+    while (sqlite3_step(statement) == SQLITE_ROW) {
+        const auto sourcePath = columnText(statement, filePathColumn);
+
+        // A fast fingerprint misses an edit in the middle of the file that keeps its length,
+        // so it only stands in for a real move: a row under another path whose file is gone.
+        // A new modification time on the same path, or a second copy, needs a full fingerprint.
+        if (!fullFingerprint && (sourcePath == path || juce::File(sourcePath).existsAsFile())) {
+            continue;
+        }
+
+        // Matching content stands in for the modification time, which a move or sync tool may have changed.
+        auto sourceBaseline = baseline;
+        sourceBaseline.modifiedTimeMs = sqlite3_column_int64(statement, 3);
+
+        if (!readCurrentRecord(statement, sourceBaseline, analysisVersion, minimumProfile, stopAtPeakDb, record)) {
+            continue;
+        }
+
+        record.fileName = baseline.fileName;
+        record.modifiedTimeMs = baseline.modifiedTimeMs;
+
+        utils::logDebug(
+            "Reusing cached analysis of {} for {} with the same content",
+            sourcePath.quoted(),
+            baseline.fullPath.quoted()
+        );
+
+        enqueue({record, sourcePath});
+        return true;
+    }
+
+    return false;
+}
+
+bool AnalysisCache::storeAnalysis(const AudioAnalysisRecord& record)
+{
+    const juce::ScopedLock lock(mutex);
+
+    if (database == nullptr && !openUnlocked()) {
+        return false;
+    }
+
+    commitPendingUnlocked();
+    return storeAnalysisUnlocked(record, {});
+}
+
+void AnalysisCache::enqueueAnalysis(const AudioAnalysisRecord& record)
+{
+    enqueue({record, {}});
+}
+
+void AnalysisCache::enqueue(PendingAnalysis pending)
+{
+    size_t queuedCount = 0;
+
+    {
+        const juce::ScopedLock lock(pendingLock);
+        pendingRecords.push_back(std::move(pending));
+        queuedCount = pendingRecords.size();
+
+        if (writeBehindThread == nullptr) {
+            writeBehindThread = std::make_unique<WriteBehindThread>(*this);
+            writeBehindThread->startThread();
+        }
+    }
+
+    if (queuedCount == 1 || queuedCount >= writeBatchSize) {
+        writeBehindThread->notify();
+    }
+}
+
+bool AnalysisCache::flushPendingAnalyses()
+{
+    const juce::ScopedLock lock(mutex);
+
+    {
+        const juce::ScopedLock pendingScope(pendingLock);
+
+        if (pendingRecords.empty() && waveformViews.empty()) {
+            return true;
+        }
+    }
+
+    if (database == nullptr && !openUnlocked()) {
+        return false;
+    }
+
+    return commitPendingUnlocked();
+}
+
+bool AnalysisCache::commitPendingUnlocked()
+{
+    // The batch stays in committingRecords until the commit is visible to read connections,
+    // so a concurrent lookup finds each record either there or in the database.
+    // Only this method changes committingRecords, and it runs under the mutex,
+    // so the writer reads the batch without holding pendingLock.
+    std::vector<std::pair<juce::String, std::int64_t>> views;
+
+    {
+        const juce::ScopedLock lock(pendingLock);
+        committingRecords.swap(pendingRecords);
+        views.swap(waveformViews);
+    }
+
+    const auto& records = committingRecords;
+
+    if (records.empty() && views.empty()) {
+        return true;
+    }
+
+    const auto startedAtMs = juce::Time::getMillisecondCounterHiRes();
+
+    auto requeue = [this] {
+        const juce::ScopedLock lock(pendingLock);
+        pendingRecords.insert(
+            pendingRecords.begin(),
+            std::make_move_iterator(committingRecords.begin()),
+            std::make_move_iterator(committingRecords.end())
+        );
+        committingRecords.clear();
+    };
+
+    // One transaction per batch: a crash leaves either all of the batch or none of it in the WAL,
+    // and the batch costs a single sync instead of one per file.
+    if (!execute("BEGIN IMMEDIATE;")) {
+        requeue();
+        return false;
+    }
+
+    int failedRecords = 0;
+
+    for (const auto& [record, waveformSourcePath] : records) {
+        if (!storeAnalysisUnlocked(record, waveformSourcePath)) {
+            ++failedRecords;
+        }
+    }
+
+    // View times only order evictions, so they are not requeued when the batch fails.
+    for (const auto& [path, viewedAtMs] : views) {
+        const ScopedStatement statement(
+            getPreparedStatement("UPDATE waveform_preview SET last_used_ms = ? WHERE file_path = ?;")
+        );
+
+        if (statement != nullptr) {
+            sqlite3_bind_int64(statement, 1, viewedAtMs);
+            bindText(statement, 2, path);
+            sqlite3_step(statement);
+        }
+    }
+
+    if (!execute("COMMIT;")) {
+        execute("ROLLBACK;");
+        requeue();
+        return false;
+    }
+
+    const auto committedCount = records.size();
+
+    {
+        const juce::ScopedLock lock(pendingLock);
+        committingRecords.clear();
+    }
+
+    if (failedRecords > 0) {
+        utils::logWarn("Failed to store {} of {} queued analysis records", failedRecords, committedCount);
+    }
+
+    utils::logDebug(
+        "Committed {} queued analysis records in {:.3f} s",
+        committedCount,
+        (juce::Time::getMillisecondCounterHiRes() - startedAtMs) / 1000.0
+    );
+
+    return failedRecords == 0;
+}
+
+bool AnalysisCache::storeAnalysisUnlocked(const AudioAnalysisRecord& record, const juce::String& waveformSourcePath)
+{
+    // The waveform is carried over only while the source row still holds the same content
+    // and the preview was drawn from that content. It is copied before the upsert,
+    // since the source may be the row being replaced.
+    if (waveformSourcePath.isNotEmpty()) {
+        constexpr auto waveformSql = R"SQL(
+            INSERT INTO waveform_preview (
+                file_path, file_size, modified_time_ms, waveform_version, waveform_data, updated_at_ms, last_used_ms
+            )
+            SELECT ?, ?, ?, preview.waveform_version, preview.waveform_data, ?, preview.last_used_ms
+            FROM waveform_preview AS preview
+            JOIN file_analysis AS analysis ON analysis.file_path = preview.file_path
+            WHERE preview.file_path = ?
+              AND analysis.fingerprint = ?
+              AND preview.file_size = analysis.file_size
+              AND preview.modified_time_ms = analysis.modified_time_ms
+            ON CONFLICT(file_path) DO UPDATE SET
+                file_size = excluded.file_size,
+                modified_time_ms = excluded.modified_time_ms,
+                waveform_version = excluded.waveform_version,
+                waveform_data = excluded.waveform_data,
+                updated_at_ms = excluded.updated_at_ms,
+                last_used_ms = excluded.last_used_ms;
+        )SQL";
+
+        const ScopedStatement waveformStatement(getPreparedStatement(waveformSql));
+        if (waveformStatement == nullptr) {
+            return false;
+        }
+
+        bindText(waveformStatement, 1, record.fullPath);
+        sqlite3_bind_int64(waveformStatement, 2, record.fileSize);
+        sqlite3_bind_int64(waveformStatement, 3, record.modifiedTimeMs);
+        sqlite3_bind_int64(waveformStatement, 4, juce::Time::getCurrentTime().toMilliseconds());
+        bindText(waveformStatement, 5, waveformSourcePath);
+        bindText(waveformStatement, 6, record.fingerprint);
+
+        if (sqlite3_step(waveformStatement) != SQLITE_DONE) {
+            return false;
+        }
+    }
+
+    constexpr auto sql = R"SQL(
         INSERT INTO file_analysis (
             file_path, file_name, format_name, file_size, modified_time_ms, length_in_samples,
             duration_seconds, peak_left, peak_right, overall_peak, true_peak_left,
             true_peak_right, overall_true_peak, max_short_term_lufs, integrated_lufs,
             sample_rate, channels, bits_per_sample, status, error_message,
-            waveform_data, waveform_version, analysis_version, updated_at_ms,
-            custom_gain_db, has_custom_gain
-        ) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+            analysis_version, updated_at_ms, custom_gain_db, has_custom_gain,
+            analysis_profile, is_complete, fingerprint
+        ) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
         ON CONFLICT(file_path) DO UPDATE SET
             file_name = excluded.file_name,
             format_name = excluded.format_name,
@@ -402,14 +1247,15 @@ bool AnalysisCache::storeAnalysis(const AudioAnalysisRecord& record)
             bits_per_sample = excluded.bits_per_sample,
             status = excluded.status,
             error_message = excluded.error_message,
-            waveform_data = excluded.waveform_data,
-            waveform_version = excluded.waveform_version,
             analysis_version = excluded.analysis_version,
+            analysis_profile = excluded.analysis_profile,
+            is_complete = excluded.is_complete,
+            fingerprint = excluded.fingerprint,
             updated_at_ms = excluded.updated_at_ms;
     )SQL";
 
-    sqlite3_stmt* statement = nullptr;
-    if (sqlite3_prepare_v2(database, sql, -1, &statement, nullptr) != SQLITE_OK) {
+    const ScopedStatement statement(getPreparedStatement(sql));
+    if (statement == nullptr) {
         return false;
     }
 
@@ -433,15 +1279,20 @@ bool AnalysisCache::storeAnalysis(const AudioAnalysisRecord& record)
     sqlite3_bind_int(statement, 18, record.bitsPerSample);
     sqlite3_bind_int(statement, 19, static_cast<int>(record.status));
     bindText(statement, 20, record.errorMessage);
-    sqlite3_bind_null(statement, 21);
-    sqlite3_bind_int(statement, 22, 0);
-    sqlite3_bind_int(statement, 23, analysisVersion);
-    sqlite3_bind_int64(statement, 24, juce::Time::getCurrentTime().toMilliseconds());
-    sqlite3_bind_double(statement, 25, record.customGainDb);
-    sqlite3_bind_int(statement, 26, record.hasCustomGain ? 1 : 0);
+    sqlite3_bind_int(statement, 21, analysisVersion);
+    sqlite3_bind_int64(statement, 22, juce::Time::getCurrentTime().toMilliseconds());
+    sqlite3_bind_double(statement, 23, record.customGainDb);
+    sqlite3_bind_int(statement, 24, record.hasCustomGain ? 1 : 0);
+    sqlite3_bind_int(statement, 25, static_cast<int>(record.profile));
+    sqlite3_bind_int(statement, 26, record.isComplete ? 1 : 0);
+
+    if (record.fingerprint.isNotEmpty()) {
+        bindText(statement, 27, record.fingerprint);
+    } else {
+        sqlite3_bind_null(statement, 27);
+    }
 
     const auto result = sqlite3_step(statement);
-    sqlite3_finalize(statement);
     return result == SQLITE_DONE;
 }
 
@@ -453,14 +1304,16 @@ bool AnalysisCache::storeCustomGain(const juce::File& file, const float customGa
         return false;
     }
 
+    commitPendingUnlocked();
+
     constexpr auto sql = R"SQL(
         UPDATE file_analysis
         SET custom_gain_db = ?, has_custom_gain = ?, updated_at_ms = ?
         WHERE file_path = ?;
     )SQL";
 
-    sqlite3_stmt* statement = nullptr;
-    if (sqlite3_prepare_v2(database, sql, -1, &statement, nullptr) != SQLITE_OK) {
+    const ScopedStatement statement(getPreparedStatement(sql));
+    if (statement == nullptr) {
         return false;
     }
 
@@ -470,7 +1323,6 @@ bool AnalysisCache::storeCustomGain(const juce::File& file, const float customGa
     bindText(statement, 4, normalizedPath(file));
 
     const auto result = sqlite3_step(statement);
-    sqlite3_finalize(statement);
     return result == SQLITE_DONE;
 }
 
@@ -482,63 +1334,77 @@ bool AnalysisCache::removeAnalysis(const juce::File& file)
         return false;
     }
 
-    constexpr auto sql = "DELETE FROM file_analysis WHERE file_path = ?;";
+    commitPendingUnlocked();
 
-    sqlite3_stmt* statement = nullptr;
-    if (sqlite3_prepare_v2(database, sql, -1, &statement, nullptr) != SQLITE_OK) {
-        return false;
-    }
+    for (const auto* sql :
+         {"DELETE FROM file_analysis WHERE file_path = ?;", "DELETE FROM waveform_preview WHERE file_path = ?;"})
+    {
+        const ScopedStatement statement(getPreparedStatement(sql));
+        if (statement == nullptr) {
+            return false;
+        }
 
-    bindText(statement, 1, normalizedPath(file));
+        bindText(statement, 1, normalizedPath(file));
 
-    const auto result = sqlite3_step(statement);
-    sqlite3_finalize(statement);
-    return result == SQLITE_DONE;
+        if (sqlite3_step(statement) != SQLITE_DONE) {
+            return false;
+        }
+    }
+
+    return true;
 }
 
 bool AnalysisCache::getWaveformData(const juce::File& file, juce::MemoryBlock& waveformData)
 {
-    const juce::ScopedLock lock(mutex);
-
     waveformData.reset();
 
-    if (database == nullptr && !openUnlocked()) {
+    auto* connection = getReadConnection();
+    if (connection == nullptr) {
         return false;
     }
 
     constexpr auto sql = R"SQL(
-        SELECT file_size, modified_time_ms, waveform_data, waveform_version, analysis_version
-        FROM file_analysis
+        SELECT file_size, modified_time_ms, waveform_data, waveform_version
+        FROM waveform_preview
         WHERE file_path = ?;
     )SQL";
 
-    sqlite3_stmt* statement = nullptr;
-    if (sqlite3_prepare_v2(database, sql, -1, &statement, nullptr) != SQLITE_OK) {
+    const ScopedStatement statement(getCachedStatement(connection->database, connection->preparedStatements, sql));
+    if (statement == nullptr) {
         return false;
     }
 
     bindText(statement, 1, normalizedPath(file));
 
     if (sqlite3_step(statement) != SQLITE_ROW) {
-        sqlite3_finalize(statement);
         return false;
     }
 
     const auto cachedFileSize = sqlite3_column_int64(statement, 0);
     const auto cachedModifiedTime = sqlite3_column_int64(statement, 1);
     const auto cachedWaveformVersion = sqlite3_column_int(statement, 3);
-    const auto cachedAnalysisVersion = sqlite3_column_int(statement, 4);
 
     if (cachedFileSize != file.getSize() || cachedModifiedTime != file.getLastModificationTime().toMilliseconds()
-        || cachedWaveformVersion != waveformVersion || cachedAnalysisVersion != analysisVersion)
+        || cachedWaveformVersion != waveformVersion)
     {
-        sqlite3_finalize(statement);
         return false;
     }
 
     waveformData = columnBlob(statement, 2);
-    sqlite3_finalize(statement);
-    return waveformData.getSize() > 0;
+
+    if (waveformData.isEmpty()) {
+        return false;
+    }
+
+    noteWaveformViewed(normalizedPath(file));
+    return true;
+}
+
+void AnalysisCache::noteWaveformViewed(const juce::String& path)
+{
+    // Recorded in memory and stored with the next batch, so viewing a preview never waits for the writer.
+    const juce::ScopedLock lock(pendingLock);
+    waveformViews.emplace_back(path, juce::Time::getCurrentTime().toMilliseconds());
 }
 
 bool AnalysisCache::storeWaveformData(const juce::File& file, const juce::MemoryBlock& waveformData)
@@ -549,32 +1415,504 @@ bool AnalysisCache::storeWaveformData(const juce::File& file, const juce::Memory
         return false;
     }
 
+    commitPendingUnlocked();
+
     constexpr auto sql = R"SQL(
-        UPDATE file_analysis
-        SET waveform_data = ?,
-            waveform_version = ?,
-            updated_at_ms = ?
-        WHERE file_path = ?
-          AND file_size = ?
-          AND modified_time_ms = ?
-          AND analysis_version = ?;
+        INSERT INTO waveform_preview (
+            file_path, file_size, modified_time_ms, waveform_version, waveform_data, updated_at_ms, last_used_ms
+        ) VALUES (?, ?, ?, ?, ?, ?, ?)
+        ON CONFLICT(file_path) DO UPDATE SET
+            file_size = excluded.file_size,
+            modified_time_ms = excluded.modified_time_ms,
+            waveform_version = excluded.waveform_version,
+            waveform_data = excluded.waveform_data,
+            updated_at_ms = excluded.updated_at_ms,
+            last_used_ms = excluded.last_used_ms;
     )SQL";
 
-    sqlite3_stmt* statement = nullptr;
-    if (sqlite3_prepare_v2(database, sql, -1, &statement, nullptr) != SQLITE_OK) {
+    const ScopedStatement statement(getPreparedStatement(sql));
+    if (statement == nullptr) {
         return false;
     }
 
-    bindBlob(statement, 1, waveformData);
-    sqlite3_bind_int(statement, 2, waveformVersion);
-    sqlite3_bind_int64(statement, 3, juce::Time::getCurrentTime().toMilliseconds());
-    bindText(statement, 4, normalizedPath(file));
-    sqlite3_bind_int64(statement, 5, file.getSize());
-    sqlite3_bind_int64(statement, 6, file.getLastModificationTime().toMilliseconds());
-    sqlite3_bind_int(statement, 7, analysisVersion);
+    bindText(statement, 1, normalizedPath(file));
+    sqlite3_bind_int64(statement, 2, file.getSize());
+    sqlite3_bind_int64(statement, 3, file.getLastModificationTime().toMilliseconds());
+    sqlite3_bind_int(statement, 4, waveformVersion);
+    bindBlob(statement, 5, waveformData);
+
+    // A preview is stored right after it was drawn for display, so storing it counts as a view.
+    const auto nowMs = juce::Time::getCurrentTime().toMilliseconds();
+    sqlite3_bind_int64(statement, 6, nowMs);
+    sqlite3_bind_int64(statement, 7, nowMs);
 
     const auto result = sqlite3_step(statement);
-    const auto changedRows = sqlite3_changes(database);
-    sqlite3_finalize(statement);
-    return result == SQLITE_DONE && changedRows > 0;
+    return result == SQLITE_DONE;
+}
+
+AnalysisCacheStats AnalysisCache::getStats()
+{
+    AnalysisCacheStats stats;
+
+    auto* connection = getReadConnection();
+    if (connection == nullptr) {
+        return stats;
+    }
+
+    auto* readDatabase = connection->database;
+    stats.analysisRows = static_cast<int>(queryInteger(readDatabase, "SELECT COUNT(*) FROM file_analysis;"));
+    stats.waveformRows = static_cast<int>(queryInteger(readDatabase, "SELECT COUNT(*) FROM waveform_preview;"));
+    stats.waveformBytes
+        = queryInteger(readDatabase, "SELECT COALESCE(SUM(length(waveform_data)), 0) FROM waveform_preview;");
+    stats.databaseBytes = databaseBytes(readDatabase);
+    stats.freeBytes
+        = queryInteger(readDatabase, "PRAGMA freelist_count;") * queryInteger(readDatabase, "PRAGMA page_size;");
+
+    return stats;
+}
+
+AnalysisCacheMaintenanceResult AnalysisCache::runMaintenance(
+    const AnalysisCacheMaintenanceOptions& options,
+    const std::function<bool()>& shouldStop
+)
+{
+    const auto startedAtMs = juce::Time::getMillisecondCounterHiRes();
+    AnalysisCacheMaintenanceResult result;
+
+    auto finish = [&result, startedAtMs] {
+        result.elapsedSeconds = (juce::Time::getMillisecondCounterHiRes() - startedAtMs) / 1000.0;
+        return result;
+    };
+
+    std::int64_t bytesBefore = 0;
+
+    {
+        const juce::ScopedLock lock(mutex);
+
+        if (database == nullptr && !openUnlocked()) {
+            return finish();
+        }
+
+        commitPendingUnlocked();
+        bytesBefore = databaseBytes(database);
+
+        if (!execute("BEGIN IMMEDIATE;")) {
+            return finish();
+        }
+
+        bool deleted = true;
+
+        // Only older versions are stale. A newer build may share the database, and its rows stay for it.
+        for (const auto& [sql, version] :
+             {std::pair {"DELETE FROM file_analysis WHERE analysis_version < ?;", analysisVersion},
+              std::pair {"DELETE FROM waveform_preview WHERE waveform_version < ?;", waveformVersion}})
+        {
+            const ScopedStatement statement(getPreparedStatement(sql));
+            if (statement == nullptr) {
+                deleted = false;
+                break;
+            }
+
+            sqlite3_bind_int(statement, 1, version);
+
+            if (sqlite3_step(statement) != SQLITE_DONE) {
+                deleted = false;
+                break;
+            }
+
+            result.staleRows += sqlite3_changes(database);
+        }
+
+        if (!deleted || !execute("COMMIT;")) {
+            execute("ROLLBACK;");
+            return finish();
+        }
+    }
+
+    if (options.pruneMissingFiles) {
+        const auto missingFiles = pruneMissingFiles(shouldStop);
+
+        if (!missingFiles.has_value()) {
+            return finish();
+        }
+
+        result.missingFiles = *missingFiles;
+    }
+
+    if (shouldStop != nullptr && shouldStop()) {
+        return finish();
+    }
+
+    const juce::ScopedLock lock(mutex);
+
+    if (database == nullptr) {
+        return finish();
+    }
+
+    const auto evictedWaveforms = evictWaveformsUnlocked(options.waveformBudgetBytes);
+
+    if (!evictedWaveforms.has_value()) {
+        return finish();
+    }
+
+    result.evictedWaveforms = *evictedWaveforms;
+
+    // Incremental vacuum only moves free pages to the end of the file and truncates them,
+    // which is quick enough to run while the app is in use.
+    constexpr int incrementalAutoVacuum = 2;
+
+    if (queryInteger(database, "PRAGMA freelist_count;") > 0) {
+        if (queryInteger(database, "PRAGMA auto_vacuum;") == incrementalAutoVacuum) {
+            execute("PRAGMA incremental_vacuum;");
+        } else if (options.allowFullVacuum && execute("PRAGMA auto_vacuum=INCREMENTAL;")) {
+            execute("VACUUM;");
+        }
+    }
+
+    // Pages freed in WAL mode only leave the database file once the WAL is checkpointed.
+    execute("PRAGMA wal_checkpoint(TRUNCATE);");
+
+    result.reclaimedBytes = juce::jmax(std::int64_t {0}, bytesBefore - databaseBytes(database));
+    result.completed = true;
+    const auto finished = finish();
+
+    utils::logInfo(
+        "Analysis cache maintenance removed {} stale rows, {} missing files, and {} waveform previews, "
+        "reclaiming {} bytes in {:.3f} s",
+        result.staleRows,
+        result.missingFiles,
+        result.evictedWaveforms,
+        result.reclaimedBytes,
+        finished.elapsedSeconds
+    );
+
+    return finished;
+}
+
+std::optional<int> AnalysisCache::pruneMissingFiles(const std::function<bool()>& shouldStop)
+{
+    std::vector<juce::String> paths;
+
+    {
+        auto* connection = getReadConnection();
+        if (connection == nullptr) {
+            return std::nullopt;
+        }
+
+        constexpr auto sql = "SELECT file_path FROM file_analysis UNION SELECT file_path FROM waveform_preview;";
+        const ScopedStatement statement(getCachedStatement(connection->database, connection->preparedStatements, sql));
+        if (statement == nullptr) {
+            return std::nullopt;
+        }
+
+        while (sqlite3_step(statement) == SQLITE_ROW) {
+            paths.push_back(columnText(statement, 0));
+        }
+    }
+
+    std::vector<juce::String> missingPaths;
+
+    for (const auto& path : paths) {
+        if (shouldStop != nullptr && shouldStop()) {
+            return std::nullopt;
+        }
+
+        if (isMissingFile(juce::File(path))) {
+            missingPaths.push_back(path);
+        }
+    }
+
+    if (missingPaths.empty()) {
+        return 0;
+    }
+
+    const juce::ScopedLock lock(mutex);
+
+    if (database == nullptr || !execute("BEGIN IMMEDIATE;")) {
+        return std::nullopt;
+    }
+
+    for (const auto& path : missingPaths) {
+        for (const auto* sql :
+             {"DELETE FROM file_analysis WHERE file_path = ?;", "DELETE FROM waveform_preview WHERE file_path = ?;"})
+        {
+            const ScopedStatement statement(getPreparedStatement(sql));
+
+            if (statement == nullptr) {
+                execute("ROLLBACK;");
+                return std::nullopt;
+            }
+
+            bindText(statement, 1, path);
+
+            if (sqlite3_step(statement) != SQLITE_DONE) {
+                execute("ROLLBACK;");
+                return std::nullopt;
+            }
+        }
+    }
+
+    if (!execute("COMMIT;")) {
+        execute("ROLLBACK;");
+        return std::nullopt;
+    }
+
+    return static_cast<int>(missingPaths.size());
+}
+
+std::optional<int> AnalysisCache::evictWaveformsUnlocked(const std::int64_t budgetBytes)
+{
+    // Walks the previews from the most recently viewed, keeping each one while the running total fits the budget.
+    // length() reads the blob size from the record header, so the blobs themselves are not loaded.
+    constexpr auto sql = R"SQL(
+        DELETE FROM waveform_preview WHERE file_path IN (
+            SELECT file_path FROM (
+                SELECT file_path, SUM(length(waveform_data)) OVER (
+                    ORDER BY last_used_ms DESC, updated_at_ms DESC, file_path
+                    ROWS UNBOUNDED PRECEDING
+                ) AS kept_bytes
+                FROM waveform_preview
+            )
+            WHERE kept_bytes > ?
+        );
+    )SQL";
+
+    const ScopedStatement statement(getPreparedStatement(sql));
+    if (statement == nullptr) {
+        return std::nullopt;
+    }
+
+    sqlite3_bind_int64(statement, 1, budgetBytes);
+
+    if (sqlite3_step(statement) != SQLITE_DONE) {
+        return std::nullopt;
+    }
+
+    return sqlite3_changes(database);
+}
+
+void AnalysisCache::startBackgroundMaintenance(const AnalysisCacheMaintenanceOptions& options)
+{
+    const juce::ScopedLock lock(pendingLock);
+
+    if (maintenanceThread != nullptr && maintenanceThread->isThreadRunning()) {
+        return;
+    }
+
+    maintenanceThread = std::make_unique<MaintenanceThread>(*this, options);
+    maintenanceThread->startThread(juce::Thread::Priority::background);
+}
+
+AnalysisCacheTransferResult AnalysisCache::exportAnalyses(const juce::File& rootDirectory, const juce::File& exportFile)
+{
+    const auto startedAtMs = juce::Time::getMillisecondCounterHiRes();
+    AnalysisCacheTransferResult result;
+
+    auto finish = [&result, startedAtMs] {
+        result.elapsedSeconds = (juce::Time::getMillisecondCounterHiRes() - startedAtMs) / 1000.0;
+        return result;
+    };
+
+    // Queued records are written first, so the export includes everything analyzed so far.
+    flushPendingAnalyses();
+
+    auto* connection = getReadConnection();
+    if (connection == nullptr) {
+        result.errorMessage = "Cannot open the analysis cache";
+        return finish();
+    }
+
+    static const auto rangeSql = utils::format(
+        "SELECT {}, file_path FROM file_analysis WHERE file_path >= ? AND file_path < ?;", analysisColumns
+    );
+
+    const ScopedStatement statement(getCachedStatement(connection->database, connection->preparedStatements, rangeSql));
+    if (statement == nullptr) {
+        result.errorMessage = "Cannot read the analysis cache";
+        return finish();
+    }
+
+    juce::FileOutputStream output(exportFile);
+
+    if (!output.openedOk() || !output.setPosition(0) || output.truncate().failed()) {
+        result.errorMessage = utils::format(
+            "Cannot write {}: {}", exportFile.getFullPathName().quoted(), output.getStatus().getErrorMessage()
+        );
+        return finish();
+    }
+
+    {
+        juce::GZIPCompressorOutputStream compressor(output, exportCompressionLevel);
+
+        auto* header = new juce::DynamicObject();
+        header->setProperty("format", exportFormatName);
+        header->setProperty("formatVersion", exportFormatVersion);
+        header->setProperty("analysisVersion", analysisVersion);
+        header->setProperty("root", rootDirectory.getFullPathName());
+        compressor << juce::JSON::toString(juce::var(header), true) << "\n";
+
+        bindPrefixRange(statement, juce::File::addTrailingSeparator(normalizedPath(rootDirectory)));
+        constexpr int filePathColumn = 25;
+
+        while (sqlite3_step(statement) == SQLITE_ROW) {
+            const juce::File file(columnText(statement, filePathColumn));
+
+            // Only rows that are current for the file as it is now are worth sharing.
+            if (AudioAnalysisRecord record;
+                readCurrentRecord(
+                    statement,
+                    AudioAnalysisRecord::fromFile(file),
+                    analysisVersion,
+                    AudioAnalysisProfile::peakOnly,
+                    std::nullopt,
+                    record
+                )
+                && !record.hasError())
+            {
+                compressor << juce::JSON::toString(toExportEntry(record, file.getRelativePathFrom(rootDirectory)), true)
+                           << "\n";
+                ++result.transferredRows;
+            } else {
+                ++result.skippedRows;
+            }
+        }
+
+        compressor.flush();
+    }
+
+    if (output.getStatus().failed()) {
+        result.errorMessage = utils::format(
+            "Cannot write {}: {}", exportFile.getFullPathName().quoted(), output.getStatus().getErrorMessage()
+        );
+        return finish();
+    }
+
+    utils::logInfo(
+        "Exported {} analyses below {} to {} ({} skipped)",
+        result.transferredRows,
+        rootDirectory.getFullPathName().quoted(),
+        exportFile.getFullPathName().quoted(),
+        result.skippedRows
+    );
+
+    return finish();
+}
+
+AnalysisCacheTransferResult AnalysisCache::importAnalyses(const juce::File& exportFile, const juce::File& rootDirectory)
+{
+    const auto startedAtMs = juce::Time::getMillisecondCounterHiRes();
+    AnalysisCacheTransferResult result;
+
+    auto finish = [&result, startedAtMs] {
+        result.elapsedSeconds = (juce::Time::getMillisecondCounterHiRes() - startedAtMs) / 1000.0;
+        return result;
+    };
+
+    juce::FileInputStream input(exportFile);
+
+    if (!input.openedOk()) {
+        result.errorMessage = utils::format(
+            "Cannot read {}: {}", exportFile.getFullPathName().quoted(), input.getStatus().getErrorMessage()
+        );
+        return finish();
+    }
+
+    juce::GZIPDecompressorInputStream decompressor(input);
+    const auto header = juce::JSON::parse(decompressor.readNextLine());
+
+    if (header["format"].toString() != exportFormatName
+        || static_cast<int>(header["formatVersion"]) != exportFormatVersion)
+    {
+        result.errorMessage
+            = utils::format("{} is not an analysis cache export", exportFile.getFullPathName().quoted());
+        return finish();
+    }
+
+    // Results from another analysis version would only be replaced on first use.
+    if (const auto exportedVersion = static_cast<int>(header["analysisVersion"]); exportedVersion != analysisVersion)
+    {
+        result.errorMessage = utils::format(
+            "{} holds analysis version {}, but this build uses version {}",
+            exportFile.getFullPathName().quoted(),
+            exportedVersion,
+            analysisVersion
+        );
+        return finish();
+    }
+
+    // Files are checked and fingerprinted before taking the mutex, so the writer is only held for the inserts.
+    std::vector<AudioAnalysisRecord> records;
+
+    while (!decompressor.isExhausted()) {
+        const auto line = decompressor.readNextLine();
+
+        if (line.isEmpty()) {
+            continue;
+        }
+
+        const auto entry = juce::JSON::parse(line);
+        const auto relativePath = entry["path"].toString().replaceCharacter('/', juce::File::getSeparatorChar());
+        const auto file = rootDirectory.getChildFile(relativePath);
+
+        // getChildFile resolves ".." and takes absolute paths as they are, so an entry could name any file.
+        if (!file.isAChildOf(rootDirectory)) {
+            utils::logWarn(
+                "Skipping import entry {} outside {}", relativePath.quoted(), rootDirectory.getFullPathName().quoted()
+            );
+            ++result.skippedRows;
+            continue;
+        }
+
+        const auto baseline = AudioAnalysisRecord::fromFile(file);
+        auto record = fromExportEntry(entry, baseline);
+
+        if (AudioAnalysisRecord existing; !baseline.file.existsAsFile()
+            || getAnalysis(baseline.file, existing, record.profile) || !matchesExportEntry(entry, baseline))
+        {
+            ++result.skippedRows;
+            continue;
+        }
+
+        records.push_back(std::move(record));
+    }
+
+    const juce::ScopedLock lock(mutex);
+
+    if (database == nullptr && !openUnlocked()) {
+        result.errorMessage = "Cannot open the analysis cache";
+        return finish();
+    }
+
+    commitPendingUnlocked();
+
+    if (!execute("BEGIN IMMEDIATE;")) {
+        result.errorMessage = "Cannot write to the analysis cache";
+        return finish();
+    }
+
+    for (const auto& record : records) {
+        if (!storeAnalysisUnlocked(record, {})) {
+            execute("ROLLBACK;");
+            result.errorMessage = utils::format("Cannot store the analysis of {}", record.fullPath.quoted());
+            return finish();
+        }
+    }
+
+    if (!execute("COMMIT;")) {
+        execute("ROLLBACK;");
+        result.errorMessage = "Cannot write to the analysis cache";
+        return finish();
+    }
+
+    result.transferredRows = static_cast<int>(records.size());
+
+    utils::logInfo(
+        "Imported {} analyses from {} below {} ({} skipped)",
+        result.transferredRows,
+        exportFile.getFullPathName().quoted(),
+        rootDirectory.getFullPathName().quoted(),
+        result.skippedRows
+    );
+
+    return finish();
 }
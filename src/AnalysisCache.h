@@ -1,7 +1,16 @@
 /// SQLite-backed cache for audio analysis results.
-/// AnalysisCache stores per-file analysis records and waveform preview data
-/// keyed by path, size, and modification time,
-/// so unchanged files are not re-read on later runs.
+/// AnalysisCache stores per-file analysis records, and waveform preview data in a table of its own,
+/// keyed by path, size, and modification time, so unchanged files are not re-read on later runs.
+/// Each record remembers the analysis profile that produced it, so richer profiles can upgrade it later,
+/// and whether a stop-at-peak run decoded it only partially.
+/// An optional content fingerprint lets moved or renamed files reuse their analysis and waveform.
+/// Rows below a directory can be exported to a portable file and imported on another machine
+/// under a different root, so a library analyzed once warms every cache that shares it.
+/// A maintenance pass prunes rows of deleted files and stale versions, keeps waveform previews
+/// under a byte budget, and vacuums the freed pages.
+/// Analysis workers can queue their results for a write-behind thread that commits them in batched transactions.
+/// Writes go through a single writer connection, while lookups run on per-thread read-only connections,
+/// so WAL lets the message thread read while a batch is being committed.
 
 #pragma once
 
@@ -9,7 +18,76 @@
 
 #include <JuceHeader.h>
 
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
 struct sqlite3;
+struct sqlite3_stmt;
+
+/// Outcome of looking up many files in the cache at once.
+struct AnalysisCacheLookup {
+    /// Current cached records, in the order of the requested files.
+    std::vector<AudioAnalysisRecord> hits;
+    /// Files without a usable cached record, in the order they were requested.
+    std::vector<AudioFileInfo> misses;
+};
+
+/// Limits applied by a cache maintenance pass.
+struct AnalysisCacheMaintenanceOptions {
+    static constexpr std::int64_t defaultWaveformBudgetBytes = std::int64_t {256} << 20;
+
+    /// Waveform previews beyond this many bytes are evicted, least recently viewed first.
+    std::int64_t waveformBudgetBytes = defaultWaveformBudgetBytes;
+    /// Removes the rows of files that no longer exist.
+    bool pruneMissingFiles = true;
+    /// Converts a database created without incremental vacuum by rewriting it once.
+    /// Writes wait until the rewrite is done, so only passes the user started should allow it.
+    bool allowFullVacuum = false;
+};
+
+/// Size and row counts of the cache database.
+struct AnalysisCacheStats {
+    int analysisRows = 0;
+    int waveformRows = 0;
+    std::int64_t waveformBytes = 0;
+    /// Size of the database in pages, including free pages.
+    std::int64_t databaseBytes = 0;
+    /// Free pages that a vacuum would return to the file system.
+    std::int64_t freeBytes = 0;
+};
+
+/// What a cache maintenance pass removed and how long it took.
+struct AnalysisCacheMaintenanceResult {
+    /// Rows left by older analysis or waveform versions.
+    int staleRows = 0;
+    /// Files whose rows were removed because the file no longer exists.
+    int missingFiles = 0;
+    int evictedWaveforms = 0;
+    std::int64_t reclaimedBytes = 0;
+    double elapsedSeconds = 0.0;
+    /// False when the pass failed or was stopped before it finished.
+    bool completed = false;
+};
+
+/// Outcome of exporting or importing cached analyses.
+struct AnalysisCacheTransferResult {
+    /// Rows written to the export file, or stored from it.
+    int transferredRows = 0;
+    /// Rows left out: stale, incomplete, or failed rows on export, and on import,
+    /// rows whose file is missing here, holds different content, or already has an equal or richer row.
+    int skippedRows = 0;
+    double elapsedSeconds = 0.0;
+    juce::String errorMessage;
+
+    /// Returns true when the export or import could not complete.
+    [[nodiscard]] bool hasError() const noexcept
+    {
+        return errorMessage.isNotEmpty();
+    }
+};
 
 /// Persistent SQLite-backed cache for file analysis results and waveform previews.
 class AnalysisCache
@@ -18,13 +96,59 @@ public:
     /// Resolves the default cache database location.
     AnalysisCache();
 
-    /// Closes the database if it is currently open.
+    /// Uses the given database file instead of the default location.
+    explicit AnalysisCache(juce::File databaseLocation);
+
+    /// Commits any queued records, then closes the database if it is currently open.
     ~AnalysisCache();
 
+    static constexpr size_t writeBatchSize = 256;
+    static constexpr int writeIntervalMs = 250;
+    /// Delay before the writer tries again after a batch failed to commit.
+    static constexpr int writeRetryIntervalMs = 1000;
+
     /// Loads a cached analysis record for the given file when present and current.
-    bool getAnalysis(const juce::File& file, AudioAnalysisRecord& record);
+    /// Rows produced by a cheaper profile than minimumProfile count as missing,
+    /// so the caller re-analyzes the file and the richer result replaces the row.
+    /// Incomplete rows left by a stop-at-peak run only count when stopAtPeakDb is given
+    /// and their peak reaches it, since only then do they answer the same question.
+    ///
+    /// Runs on the calling thread's read-only connection without waiting for the writer.
+    /// A record still queued by enqueueAnalysis takes precedence over the row it will replace.
+    bool getAnalysis(
+        const juce::File& file,
+        AudioAnalysisRecord& record,
+        AudioAnalysisProfile minimumProfile = AudioAnalysisProfile::peakOnly,
+        std::optional<float> stopAtPeakDb = std::nullopt
+    );
+
+    /// Looks up every file with the same rules as getAnalysis, in one read transaction
+    /// with an indexed lookup per file, so the cost follows the number of files and not the size of the cache.
+    /// Rows are checked against the size and modification time passed in, usually from the directory listing,
+    /// so the lookup does not touch the file system and large rescans spend their time on the files that need analysis.
+    AnalysisCacheLookup getAnalyses(
+        const std::vector<AudioFileInfo>& files,
+        AudioAnalysisProfile minimumProfile = AudioAnalysisProfile::peakOnly,
+        std::optional<float> stopAtPeakDb = std::nullopt
+    );
+
+    /// Looks for a row of the same size whose content fingerprint matches
+    /// and uses it for the file when it is otherwise current, as with getAnalysis.
+    /// A full fingerprint matches rows under any path, which recognizes files that were moved, renamed, copied,
+    /// or only had their modification time changed. A fast fingerprint does not cover the middle of the file,
+    /// so it only matches rows under another path whose file no longer exists, which is a move or rename.
+    /// On success, a copy of the row, waveform included, is queued under the file's path,
+    /// so the next lookup finds it by path again.
+    bool reuseAnalysisByFingerprint(
+        const AudioFileInfo& fileInfo,
+        const juce::String& fingerprint,
+        AudioAnalysisProfile minimumProfile,
+        std::optional<float> stopAtPeakDb,
+        AudioAnalysisRecord& record
+    );
 
     /// Loads cached thumbnail waveform data for the given file when available.
+    /// Like getAnalysis, it reads on the calling thread's read-only connection.
     bool getWaveformData(const juce::File& file, juce::MemoryBlock& waveformData);
 
     /// Returns the on-disk SQLite file used by the cache.
@@ -36,27 +160,148 @@ public:
     /// Stores the completed analysis record for a file.
     bool storeAnalysis(const AudioAnalysisRecord& record);
 
-    /// Stores serialized waveform preview data for a file.
+    /// Queues the completed analysis record for the write-behind thread and returns without touching the database.
+    /// Queued records are committed in one transaction once writeBatchSize of them are waiting,
+    /// or writeIntervalMs after the first of them was queued.
+    /// A batch that fails to commit stays queued and is retried every writeRetryIntervalMs.
+    /// Every other write commits the queue first and reads check it before the database,
+    /// so queued records are never missed or reordered.
+    void enqueueAnalysis(const AudioAnalysisRecord& record);
+
+    /// Commits every queued record now.
+    /// Returns false when the transaction fails, in which case the records stay queued.
+    bool flushPendingAnalyses();
+
+    /// Stores serialized waveform preview data for a file, tagged with the file's current size and modification time.
     bool storeWaveformData(const juce::File& file, const juce::MemoryBlock& waveformData);
 
     /// Updates only the user-controlled gain fields for a file.
     bool storeCustomGain(const juce::File& file, float customGainDb, bool hasCustomGain);
 
-    /// Removes the cached row for a file (if any).
+    /// Removes the cached analysis and waveform preview for a file (if any).
     /// Returns true when the operation completed.
     bool removeAnalysis(const juce::File& file);
 
+    /// Writes the current analyses of every file below rootDirectory to exportFile:
+    /// zlib-compressed JSON lines with paths relative to the root, sizes, modification times, and fingerprints.
+    /// Waveform previews and custom gains stay in the local cache.
+    AnalysisCacheTransferResult exportAnalyses(const juce::File& rootDirectory, const juce::File& exportFile);
+
+    /// Stores the analyses from an export file for the same files below rootDirectory on this machine.
+    /// An entry is used when its file has the same size and modification time here,
+    /// or the same size and full content fingerprint when only the modification time differs,
+    /// which is what copying a library usually does. All entries are stored in one transaction.
+    AnalysisCacheTransferResult importAnalyses(const juce::File& exportFile, const juce::File& rootDirectory);
+
+    /// Returns the current row counts and sizes, read without waiting for the writer.
+    AnalysisCacheStats getStats();
+
+    /// Runs a maintenance pass and returns what it removed:
+    /// drops rows from older analysis and waveform versions and, optionally, rows of files that no longer exist,
+    /// evicts the least recently viewed waveform previews until they fit the budget,
+    /// then vacuums the freed pages.
+    ///
+    /// Files are checked on the calling thread without holding the writer, so lookups and stores continue meanwhile.
+    /// A file only counts as missing while its folder still exists,
+    /// so files on a drive or share that is not mounted keep their rows.
+    /// shouldStop is polled between files, and the pass ends early without deleting anything further
+    /// once it returns true.
+    AnalysisCacheMaintenanceResult runMaintenance(
+        const AnalysisCacheMaintenanceOptions& options = {},
+        const std::function<bool()>& shouldStop = nullptr
+    );
+
+    /// Runs a maintenance pass on a background thread, which the destructor stops if it is still running.
+    /// Does nothing while a previous background pass is still running.
+    void startBackgroundMaintenance(const AnalysisCacheMaintenanceOptions& options = {});
+
 private:
-    static constexpr int analysisVersion = 7;
-    static constexpr int waveformVersion = 1;
+    class WriteBehindThread;
+    class MaintenanceThread;
+    struct ReadConnection;
+
+    /// A record waiting for the write-behind thread.
+    struct PendingAnalysis {
+        AudioAnalysisRecord record;
+        /// Path of the row whose waveform the stored row keeps, or empty to store it without one.
+        juce::String waveformSourcePath;
+    };
+
+    /// Version 8 rows hold the exact maximum of the short-term loudness, measured every 100 ms.
+    static constexpr int analysisVersion = 8;
+    /// Stored in PRAGMA user_version once the database has every step of applySchemaMigration.
+    static constexpr int schemaVersion = 6;
+    /// Version 2 previews are delta-filtered and zlib-compressed by ThumbnailCacheData.
+    static constexpr int waveformVersion = 2;
 
     /// Returns true when the given table already has the named column.
-    /// Used for lightweight schema migrations when opening the database.
+    /// Only schema migrations use it, so opening a current database never probes the tables.
     bool columnExists(const juce::String& tableName, const juce::String& columnName) const;
 
-    /// Closes the database handle if it is open. The caller must hold the mutex.
+    /// Adds the column with the given type and constraints unless the table already has it.
+    bool addColumnIfMissing(
+        const juce::String& tableName,
+        const juce::String& columnName,
+        const juce::String& definition
+    );
+
+    /// Applies every migration step after fromVersion in one transaction and records schemaVersion.
+    /// Pages the steps freed are left to the next maintenance pass. The caller must hold the mutex.
+    bool migrateSchema(int fromVersion);
+
+    /// Applies the step that brings the schema to the given version. Steps are only ever appended.
+    bool applySchemaMigration(int version);
+
+    /// Deletes the rows of files that no longer exist, checking the files before taking the mutex.
+    /// Returns the number of rows removed, or std::nullopt when stopped or when the delete failed.
+    std::optional<int> pruneMissingFiles(const std::function<bool()>& shouldStop);
+
+    /// Evicts the least recently viewed waveform previews until the rest fit the budget.
+    /// The caller must hold the mutex.
+    std::optional<int> evictWaveformsUnlocked(std::int64_t budgetBytes);
+
+    /// Records that a waveform preview was just viewed. The write-behind thread stores the time.
+    void noteWaveformViewed(const juce::String& path);
+
+    /// Adds a record to the write-behind queue and wakes the writer when needed.
+    void enqueue(PendingAnalysis pending);
+
+    /// Moves waveform blobs left in analysis rows by older versions into the waveform_preview table,
+    /// then drops or clears the old columns. Runs inside the migration transaction.
+    bool moveWaveformsToPreviewTable();
+
+    /// Returns the newest record queued or being committed for the path, if any.
+    std::optional<AudioAnalysisRecord> findQueuedAnalysis(const juce::String& path) const;
+
+    /// Returns the newest record queued or being committed for each path that is a key of fileIndices.
+    /// Only the matching records are copied.
+    std::unordered_map<juce::String, AudioAnalysisRecord> getQueuedAnalyses(
+        const std::unordered_map<juce::String, size_t>& fileIndices
+    ) const;
+
+    /// Returns the calling thread's read-only connection, opening it on first use,
+    /// or nullptr when the database cannot be opened.
+    ReadConnection* getReadConnection();
+
+    /// Closes the calling thread's read-only connection, for threads that end before the cache does.
+    void closeReadConnection();
+
+    /// Commits the queued records in one transaction. The caller must hold the mutex.
+    bool commitPendingUnlocked();
+
+    /// Writes one analysis record without a surrounding transaction,
+    /// copying the waveform of the row at waveformSourcePath when given. The caller must hold the mutex.
+    bool storeAnalysisUnlocked(const AudioAnalysisRecord& record, const juce::String& waveformSourcePath);
+
+    /// Finalizes the cached statements and closes the writer and read connections if they are open.
+    /// The caller must hold the mutex.
     void closeUnlocked();
 
+    /// Returns the statement prepared for the SQL text, preparing it on first use,
+    /// or nullptr when it does not compile. Statements stay prepared until the database is closed,
+    /// so repeated lookups and stores only reset and rebind them. The caller must hold the mutex.
+    sqlite3_stmt* getPreparedStatement(const juce::String& sql);
+
     /// Runs a statement that returns no rows, logging any SQLite error.
     bool execute(const juce::String& sql) const;
 
@@ -66,7 +311,23 @@ private:
     /// Returns the canonical path string used as the cache key for a file.
     static juce::String normalizedPath(const juce::File& file);
 
+    /// Guards the writer connection and its statements.
     juce::CriticalSection mutex;
     juce::File databaseFile;
     sqlite3* database = nullptr;
+    std::unordered_map<juce::String, sqlite3_stmt*> preparedStatements;
+    /// Set once the writer has created or migrated the schema, so read connections can open.
+    std::atomic<bool> schemaReady = false;
+    /// Guards readConnections only. Each connection is used by its own thread alone.
+    juce::CriticalSection readConnectionsLock;
+    std::unordered_map<juce::Thread::ThreadID, std::unique_ptr<ReadConnection>> readConnections;
+    /// Guards pendingRecords, committingRecords, waveformViews, and the creation of the background threads.
+    juce::CriticalSection pendingLock;
+    std::vector<PendingAnalysis> pendingRecords;
+    /// The batch inside the writer's open transaction, kept visible to readers until it has committed.
+    std::vector<PendingAnalysis> committingRecords;
+    /// Paths and times of waveform previews viewed since the last commit, for least recently viewed eviction.
+    std::vector<std::pair<juce::String, std::int64_t>> waveformViews;
+    std::unique_ptr<WriteBehindThread> writeBehindThread;
+    std::unique_ptr<MaintenanceThread> maintenanceThread;
 };
@@ -1,17 +1,163 @@
 /// Implementation of AnalysisCoordinator.
-/// Publishes cached records immediately, queues one thread pool job per stale file,
-/// stores fresh results back into the cache,
-/// and guards callback publication with run id checks and a callback lock.
+/// Walks the input paths with DirectoryScanner on a discovery thread and handles each batch of found files as it comes:
+/// publishes cached records that cover the requested profile immediately, found with one batched cache lookup,
+/// and adds the stale files to per-device queues ordered by estimated cost, file size times a per-format decode factor.
+/// The run is a two stage pipeline joined by a ready queue.
+/// Prefetch jobs take the most expensive queued file, longest processing time first,
+/// from a device that is below its adaptive I/O limit, and read it into memory within a byte budget.
+/// WAV and AIFF files on local disks are not copied, since the analysis maps them straight from the page cache.
+/// Analysis jobs take the most expensive ready file and an idle worker's analysis buffers,
+/// try to reuse a cached analysis with the same content fingerprint before decoding the file from memory,
+/// and queue fresh results for the cache's write-behind thread.
+/// Other readers decode on a job of the decode pool that fills a bounded lock-free block queue ahead of the worker.
+/// The jobs wait on condition variables that cancellation also notifies, so nothing polls.
+/// The segments of long files are analyzed by helper jobs on the same pool, so splitting a file never adds threads.
+/// Callback publication is guarded with run id checks and a callback lock.
 /// Also provides the blocking analysis entry point used by the CLI.
 
 #include "AnalysisCoordinator.h"
 
+#include "DirectoryScanner.h"
+#include "FileFingerprint.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
 #include <mutex>
+#include <unordered_map>
+
+#if !JUCE_WINDOWS
+#include <sys/stat.h>
+#endif
+
+#if JUCE_LINUX
+#include <sys/vfs.h>
+#endif
+
+/// Cost estimates and storage device grouping used to schedule analysis jobs.
+namespace audiobatch::coordinator
+{
+/// Files a device finishes before its I/O limit is tuned, at least, and per file it may read at once.
+constexpr int tuningFilesPerSlot = 2;
+/// Shortest throughput measurement window, so a burst of tiny files does not move the limit.
+constexpr double minimumTuningWindowMs = 500.0;
+/// Throughput drop, relative to the previous window, that turns the limit search around.
+constexpr double tuningTolerance = 0.05;
+/// Largest file read ahead into memory. Larger files are streamed from storage while they are analyzed.
+constexpr std::int64_t maximumPrefetchFileBytes = 64 * 1024 * 1024;
+/// Bytes read ahead that may wait in memory at the same time.
+/// A single file above the budget is still read when nothing else is buffered, so the run cannot stall.
+constexpr std::int64_t prefetchBudgetBytes = 256 * 1024 * 1024;
+
+/// Returns a key that is equal for directories on the same storage device or network share.
+/// Uses the device number on POSIX systems, and the drive or UNC share on Windows.
+/// An empty key groups the directory with the others that could not be resolved.
+static juce::String deviceKeyForDirectory(const juce::File& directory)
+{
+    const auto path = directory.getFullPathName();
+
+#if JUCE_WINDOWS
+    if (path.startsWith("\\\\")) {
+        const auto parts = juce::StringArray::fromTokens(path.substring(2), "\\", "");
+        return "\\\\" + parts[0] + "\\" + parts[1];
+    }
+
+    return path.substring(0, 2).toUpperCase();
+#else
+    struct stat info {};
+
+    if (::stat(path.toRawUTF8(), &info) != 0) {
+        return {};
+    }
+
+    return juce::String(static_cast<juce::uint64>(info.st_dev));
+#endif
+}
+
+/// Returns true when the directory is on a local disk rather than a network share or removable media.
+/// Directories whose file system cannot be identified count as local, as in juce::File::isOnHardDisk.
+static bool isLocalDirectory(const juce::File& directory)
+{
+#if JUCE_LINUX
+    // juce::File::isOnHardDisk only knows the older NFS and SMB clients,
+    // so also rule out the CIFS and SMB2 clients that mount Windows shares today, and FUSE mounts like sshfs.
+    constexpr std::array<std::uint32_t, 3> networkFileSystems {0xFF534D42, 0xFE534D42, 0x65735546};
+    struct statfs info {};
+
+    if (::statfs(directory.getFullPathName().toRawUTF8(), &info) == 0
+        && std::ranges::find(networkFileSystems, static_cast<std::uint32_t>(info.f_type)) != networkFileSystems.end())
+    {
+        return false;
+    }
+#endif
+
+    return directory.isOnHardDisk();
+}
+
+/// Returns true when the file is read into memory ahead of the analysis.
+/// Files above the size limit are streamed instead, and WAV and AIFF files on a local disk are mapped,
+/// which reads them from the page cache without a copy.
+static bool readsAhead(const AudioFileInfo& fileInfo, const bool onLocalDisk)
+{
+    if (fileInfo.fileSize > maximumPrefetchFileBytes) {
+        return false;
+    }
+
+    return !(onLocalDisk && fileInfo.file.hasFileExtension("wav;aif;aiff")
+             && AudioAnalysisService::getIoSettings(fileInfo.file).useMemoryMapping);
+}
+
+/// Returns the analysis cost per byte of the file's format, relative to uncompressed PCM.
+/// Analysis time follows the duration of the audio, and compressed formats pack more of it into each byte
+/// on top of the decoding work. Formats without an entry count as PCM.
+static double decodeCostFactor(const juce::File& file)
+{
+    static const std::unordered_map<juce::String, double> factors {
+        {"flac", 2.5},
+        {"ogg", 12.0},
+        {"mp3", 12.0},
+        {"m4a", 12.0},
+        {"aac", 12.0},
+        {"wma", 12.0},
+    };
+
+    const auto extension = file.getFileExtension().trimCharactersAtStart(".").toLowerCase();
+
+    if (const auto found = factors.find(extension); found != factors.end()) {
+        return found->second;
+    }
+
+    return 1.0;
+}
+
+/// Estimates the relative time it takes to analyze the file.
+static double estimateCost(const AudioFileInfo& fileInfo)
+{
+    return static_cast<double>(fileInfo.fileSize) * decodeCostFactor(fileInfo.file);
+}
+}  // namespace audiobatch::coordinator
+
+using namespace audiobatch::coordinator;
 
 AnalysisCoordinator::AnalysisCoordinator(AnalysisCache& analysisCache, const int workerCount) :
     cache(analysisCache),
-    threadPool(juce::jmax(1, workerCount))
-{ }
+    threadPool(juce::jmax(1, workerCount)),
+    prefetchPool(juce::jmax(1, workerCount)),
+    decodePool(juce::jmax(1, workerCount))
+{
+    for (int worker = 0; worker < threadPool.getNumThreads(); ++worker) {
+        auto context = std::make_unique<AudioAnalysisContext>();
+
+        // Segments of long files run on the analysis pool itself, so they only use threads no other file needs.
+        context->setSegmentScheduler(
+            [this](std::function<void()> job) { threadPool.addJob(std::move(job)); }, threadPool.getNumThreads()
+        );
+        context->setDecodeScheduler([this](std::function<void()> job) { decodePool.addJob(std::move(job)); });
+        idleContexts.push_back(std::move(context));
+    }
+}
 
 AnalysisCoordinator::~AnalysisCoordinator()
 {
@@ -36,6 +182,34 @@ void AnalysisCoordinator::setStartingCallback(StartingCallback callback)
     startingCallback = std::move(callback);
 }
 
+void AnalysisCoordinator::setDiscoveryCallback(DiscoveryCallback callback)
+{
+    const juce::ScopedLock lock(callbackLock);
+    discoveryCallback = std::move(callback);
+}
+
+void AnalysisCoordinator::publishDiscovered(
+    const std::vector<AudioFileInfo>& staleFiles,
+    const int foundFiles,
+    const int runId
+) const
+{
+    if (runId != currentRunId.load()) {
+        return;
+    }
+
+    DiscoveryCallback callbackCopy;
+
+    {
+        const juce::ScopedLock lock(callbackLock);
+        callbackCopy = discoveryCallback;
+    }
+
+    if (callbackCopy != nullptr) {
+        callbackCopy(staleFiles, foundFiles);
+    }
+}
+
 void AnalysisCoordinator::publishStarting(const juce::File& file, const int runId) const
 {
     if (runId != currentRunId.load()) {
@@ -93,60 +267,386 @@ void AnalysisCoordinator::publishCompletion(const int totalFiles, const int runI
 void AnalysisCoordinator::cancelAndWait()
 {
     ++currentRunId;
+
+    // Notified under the lock, so a job that has not started waiting yet sees the new run id before it does.
+    {
+        const std::scoped_lock lock(queueLock);
+        slotFreed.notify_all();
+        fileReady.notify_all();
+    }
+
+    // Discovery stops first, so it cannot queue new jobs behind the removal below.
+    // The decode pool goes last, since the running analysis jobs wait for their decode jobs.
+    discoveryPool.removeAllJobs(true, 30000);
+    prefetchPool.removeAllJobs(true, 30000);
     threadPool.removeAllJobs(true, 30000);
+    decodePool.removeAllJobs(true, 30000);
     pendingJobs.store(0);
+    discoveredFiles.store(0);
+
+    const std::scoped_lock lock(queueLock);
+
+    for (auto& [deviceKey, device] : deviceQueues) {
+        device.files.clear();
+        device.activeFiles = 0;
+        device.windowStartedAtMs = 0.0;
+        device.windowBytes = 0;
+        device.windowFiles = 0;
+    }
+
+    readyFiles.clear();
+    prefetchedBytes = 0;
+    runStartedAtMs = juce::Time::getMillisecondCounterHiRes();
+    lastFileStartedAtMs = runStartedAtMs;
+    busyMs = 0.0;
+    analyzedFiles = 0;
 }
 
-int AnalysisCoordinator::start(const AudioAnalysisOptions& options)
+void AnalysisCoordinator::start(const AudioAnalysisOptions& options)
 {
-    return start(options, AudioAnalysisService::collectInputFiles(options.inputPaths, options.recursive));
+    cancelAndWait();
+
+    const auto runId = currentRunId.load();
+    pendingJobs.store(1);
+
+    discoveryPool.addJob([this, options, runId] {
+        DirectoryScanner::scan(
+            options.inputPaths,
+            options.recursive,
+            [this, &options, runId](const std::vector<AudioFileInfo>& files) { queueFiles(files, options, runId); },
+            [this, runId] { return runId != currentRunId.load(); }
+        );
+
+        if (runId == currentRunId.load()) {
+            releasePendingJob(runId);
+        }
+    });
 }
 
-int AnalysisCoordinator::start(const AudioAnalysisOptions& options, const juce::Array<juce::File>& files)
+void AnalysisCoordinator::start(const AudioAnalysisOptions& options, const juce::Array<juce::File>& files)
 {
     cancelAndWait();
 
     const auto runId = currentRunId.load();
-    juce::Array<juce::File> staleFiles;
+    std::vector<AudioFileInfo> fileInfos;
+    fileInfos.reserve(static_cast<size_t>(files.size()));
 
     for (const auto& file : files) {
-        if (AudioAnalysisRecord cachedRecord; !options.refresh && cache.getAnalysis(file, cachedRecord)) {
-            publishResult(cachedRecord, runId);
-        } else {
-            staleFiles.add(file);
+        fileInfos.push_back(AudioFileInfo::fromFile(file));
+    }
+
+    pendingJobs.store(1);
+    queueFiles(fileInfos, options, runId);
+    releasePendingJob(runId);
+}
+
+void AnalysisCoordinator::queueFiles(
+    const std::vector<AudioFileInfo>& files,
+    const AudioAnalysisOptions& options,
+    const int runId
+)
+{
+    AnalysisCacheLookup lookup;
+
+    if (options.refresh) {
+        lookup.misses = files;
+    } else {
+        lookup = cache.getAnalyses(files, options.profile, options.stopAtPeakDb);
+    }
+
+    const auto& staleFiles = lookup.misses;
+
+    // Counted before anything is published, so completion always reports at least the files already shown.
+    const auto foundFiles = static_cast<int>(files.size());
+    discoveredFiles += foundFiles;
+    publishDiscovered(staleFiles, foundFiles, runId);
+
+    for (const auto& cachedRecord : lookup.hits) {
+        publishResult(cachedRecord, runId);
+    }
+
+    if (staleFiles.empty()) {
+        return;
+    }
+
+    // Resolved outside queueLock, since a stat on a slow network share must not hold up the workers.
+    std::vector<const DeviceInfo*> fileDevices;
+    fileDevices.reserve(staleFiles.size());
+
+    for (const auto& fileInfo : staleFiles) {
+        const auto directory = fileInfo.file.getParentDirectory();
+        auto found = deviceKeys.find(directory.getFullPathName());
+
+        if (found == deviceKeys.end()) {
+            const DeviceInfo deviceInfo {deviceKeyForDirectory(directory), isLocalDirectory(directory)};
+            found = deviceKeys.emplace(directory.getFullPathName(), deviceInfo).first;
+        }
+
+        fileDevices.push_back(&found->second);
+    }
+
+    {
+        const std::scoped_lock lock(queueLock);
+
+        for (size_t index = 0; index < staleFiles.size(); ++index) {
+            auto& device = deviceQueues[fileDevices[index]->key];
+
+            if (device.limit == 0) {
+                device.limit = juce::jmax(1, threadPool.getNumThreads() / 2);
+                device.isLocal = fileDevices[index]->isLocal;
+            }
+
+            device.files.push_back({staleFiles[index], estimateCost(staleFiles[index])});
+            std::ranges::push_heap(device.files, std::less {}, &QueuedFile::cost);
         }
     }
 
-    pendingJobs.store(staleFiles.size());
+    slotFreed.notify_all();
+
+    pendingJobs += static_cast<int>(staleFiles.size());
 
-    if (files.isEmpty()) {
-        publishCompletion(0, runId);
-        return 0;
+    for (size_t index = 0; index < staleFiles.size(); ++index) {
+        prefetchPool.addJob([this, runId] { prefetchNextFile(runId); });
+        threadPool.addJob([this, options, runId] { analyzeNextFile(options, runId); });
+    }
+}
+
+void AnalysisCoordinator::prefetchNextFile(const int runId)
+{
+    if (runId != currentRunId.load()) {
+        return;
     }
 
-    for (const auto& file : staleFiles) {
-        threadPool.addJob([this, file, runId, totalFiles = files.size()] {
+    ReadyFile readyFile;
+
+    {
+        std::unique_lock lock(queueLock);
+        DeviceQueue* device = nullptr;
+
+        // Every job is queued together with its file, so a job always finds one once a slot is free.
+        while (device == nullptr) {
             if (runId != currentRunId.load()) {
                 return;
             }
 
-            publishStarting(file, runId);
+            for (auto& [key, candidate] : deviceQueues) {
+                if (!candidate.files.empty() && candidate.activeFiles < candidate.limit
+                    && (device == nullptr || candidate.files.front().cost > device->files.front().cost))
+                {
+                    device = &candidate;
+                    readyFile.deviceKey = key;
+                }
+            }
+
+            // The most expensive file waits for the budget rather than letting smaller ones overtake it.
+            if (device != nullptr) {
+                const auto& fileInfo = device->files.front().fileInfo;
 
-            const auto result = AudioAnalysisService::analyzeFile(file);
-            cache.storeAnalysis(result);
-            publishResult(result, runId);
+                if (readsAhead(fileInfo, device->isLocal) && prefetchedBytes > 0
+                    && prefetchedBytes + fileInfo.fileSize > prefetchBudgetBytes)
+                {
+                    device = nullptr;
+                }
+            }
 
-            if (pendingJobs.fetch_sub(1) == 1) {
-                publishCompletion(totalFiles, runId);
+            if (device == nullptr) {
+                slotFreed.wait(lock);
             }
-        });
+        }
+
+        std::ranges::pop_heap(device->files, std::less {}, &QueuedFile::cost);
+        readyFile.fileInfo = std::move(device->files.back().fileInfo);
+        readyFile.cost = device->files.back().cost;
+        device->files.pop_back();
+        ++device->activeFiles;
+
+        if (device->windowStartedAtMs <= 0.0) {
+            device->windowStartedAtMs = juce::Time::getMillisecondCounterHiRes();
+        }
+
+        readyFile.prefetched = readsAhead(readyFile.fileInfo, device->isLocal);
+
+        if (readyFile.prefetched) {
+            prefetchedBytes += readyFile.fileInfo.fileSize;
+        }
     }
 
-    if (staleFiles.isEmpty()) {
-        publishCompletion(files.size(), runId);
+    if (readyFile.prefetched) {
+        // A failed read leaves the block empty, and the analysis opens the file itself to report why.
+        if (!readyFile.fileInfo.file.loadFileAsData(readyFile.data)) {
+            readyFile.data.reset();
+        }
+
+        const std::scoped_lock lock(queueLock);
+        finishDeviceFile(readyFile.deviceKey, readyFile.fileInfo.fileSize);
     }
 
-    return files.size();
+    slotFreed.notify_all();
+
+    {
+        const std::scoped_lock lock(queueLock);
+        readyFiles.push_back(std::move(readyFile));
+        std::ranges::push_heap(readyFiles, std::less {}, &ReadyFile::cost);
+    }
+
+    fileReady.notify_one();
+}
+
+void AnalysisCoordinator::analyzeNextFile(const AudioAnalysisOptions& options, const int runId)
+{
+    if (runId != currentRunId.load()) {
+        return;
+    }
+
+    ReadyFile readyFile;
+    std::unique_ptr<AudioAnalysisContext> context;
+    double startedAtMs = 0.0;
+
+    {
+        std::unique_lock lock(queueLock);
+
+        // Every job is queued together with a prefetch job, so a file always arrives.
+        fileReady.wait(lock, [this, runId] { return !readyFiles.empty() || runId != currentRunId.load(); });
+
+        if (runId != currentRunId.load()) {
+            return;
+        }
+
+        std::ranges::pop_heap(readyFiles, std::less {}, &ReadyFile::cost);
+        readyFile = std::move(readyFiles.back());
+        readyFiles.pop_back();
+
+        // At most one job per pool thread runs, so a context is always left for it.
+        context = std::move(idleContexts.back());
+        idleContexts.pop_back();
+
+        startedAtMs = juce::Time::getMillisecondCounterHiRes();
+        lastFileStartedAtMs = startedAtMs;
+    }
+
+    const auto& fileInfo = readyFile.fileInfo;
+    const auto& file = fileInfo.file;
+    const auto* fileData = readyFile.prefetched && readyFile.data.getSize() > 0 ? &readyFile.data : nullptr;
+    publishStarting(file, runId);
+
+    // A file whose content is already cached under the path it was moved from reuses that analysis
+    // instead of being decoded again. With a full fingerprint, so do copies and files with only a new timestamp.
+    const auto fingerprint = fileData != nullptr ? FileFingerprint::compute(file, *fileData, options.fingerprintMode)
+                                                 : FileFingerprint::compute(file, options.fingerprintMode);
+    AudioAnalysisRecord result;
+
+    if (options.refresh
+        || !cache.reuseAnalysisByFingerprint(fileInfo, fingerprint, options.profile, options.stopAtPeakDb, result))
+    {
+        result = AudioAnalysisService::analyzeFile(
+            fileInfo,
+            AudioAnalysisService::getIoSettings(file),
+            *context,
+            options.profile,
+            options.stopAtPeakDb,
+            fileData
+        );
+        result.fingerprint = fingerprint;
+        cache.enqueueAnalysis(result);
+    }
+
+    readyFile.data.reset();
+
+    {
+        const std::scoped_lock lock(queueLock);
+        busyMs += juce::Time::getMillisecondCounterHiRes() - startedAtMs;
+        ++analyzedFiles;
+        idleContexts.push_back(std::move(context));
+
+        if (readyFile.prefetched) {
+            prefetchedBytes -= fileInfo.fileSize;
+        } else {
+            finishDeviceFile(readyFile.deviceKey, fileInfo.fileSize);
+        }
+    }
+
+    slotFreed.notify_all();
+    publishResult(result, runId);
+    releasePendingJob(runId);
+}
+
+void AnalysisCoordinator::finishDeviceFile(const juce::String& deviceKey, const std::int64_t fileSize)
+{
+    auto& device = deviceQueues[deviceKey];
+    --device.activeFiles;
+    device.windowBytes += fileSize;
+    ++device.windowFiles;
+
+    const auto nowMs = juce::Time::getMillisecondCounterHiRes();
+    const auto windowMs = nowMs - device.windowStartedAtMs;
+
+    if (device.windowFiles < device.limit * tuningFilesPerSlot || windowMs < minimumTuningWindowMs) {
+        return;
+    }
+
+    const auto throughput = static_cast<double>(device.windowBytes) / windowMs;
+
+    if (device.lastThroughput > 0.0 && throughput < device.lastThroughput * (1.0 - tuningTolerance)) {
+        device.limitStep = -device.limitStep;
+    }
+
+    const auto previousLimit = device.limit;
+    device.limit = juce::jlimit(1, threadPool.getNumThreads(), device.limit + device.limitStep);
+    device.lastThroughput = throughput;
+    device.windowStartedAtMs = nowMs;
+    device.windowBytes = 0;
+    device.windowFiles = 0;
+
+    if (device.limit != previousLimit) {
+        utils::logDebug(
+            "I/O limit of device {} moved from {} to {} files at {:.1f} MB/s",
+            deviceKey.quoted(),
+            previousLimit,
+            device.limit,
+            throughput / 1000.0
+        );
+    }
+}
+
+void AnalysisCoordinator::releasePendingJob(const int runId)
+{
+    if (pendingJobs.fetch_sub(1) == 1) {
+        // The run's results are durable before anyone hears that it finished.
+        cache.flushPendingAnalyses();
+
+        if (runId == currentRunId.load()) {
+            logRunUtilization();
+        }
+
+        publishCompletion(discoveredFiles.load(), runId);
+    }
+}
+
+void AnalysisCoordinator::logRunUtilization() const
+{
+    const std::scoped_lock lock(queueLock);
+
+    if (analyzedFiles == 0) {
+        return;
+    }
+
+    const auto finishedAtMs = juce::Time::getMillisecondCounterHiRes();
+    const auto elapsedMs = juce::jmax(1.0, finishedAtMs - runStartedAtMs);
+    const auto workerCount = threadPool.getNumThreads();
+
+    // The tail is the time after the last file was taken, when workers only ran out of work one by one.
+    utils::logInfo(
+        "Analyzed {} files on {} workers in {:.2f} s: {:.0f}% utilization, {:.2f} s tail after the last file started",
+        analyzedFiles,
+        workerCount,
+        elapsedMs / 1000.0,
+        100.0 * busyMs / (elapsedMs * static_cast<double>(workerCount)),
+        (finishedAtMs - lastFileStartedAtMs) / 1000.0
+    );
+
+    for (const auto& [deviceKey, device] : deviceQueues) {
+        utils::logDebug("Device {} ends the run with an I/O limit of {} files", deviceKey.quoted(), device.limit);
+    }
 }
 
 std::vector<AudioAnalysisRecord> AnalysisCoordinator::analyzeBlocking(const AudioAnalysisOptions& options)
@@ -162,10 +662,7 @@ std::vector<AudioAnalysisRecord> AnalysisCoordinator::analyzeBlocking(const Audi
 
     setCompletionCallback([&finishedEvent](int) { finishedEvent.signal(); });
 
-    if (const auto totalFiles = start(options); totalFiles == 0) {
-        return results;
-    }
-
+    start(options);
     finishedEvent.wait(-1);
     return results;
 }
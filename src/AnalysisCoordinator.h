@@ -1,6 +1,9 @@
 /// Background orchestration for audio analysis runs.
-/// AnalysisCoordinator runs analysis jobs on a thread pool, serves cached results first,
-/// and publishes starting, per-result, and completion callbacks tagged with a run id
+/// AnalysisCoordinator discovers input files in the background, reads them ahead into memory on an I/O pool
+/// within per-device limits, most expensive file first, and analyzes them on a worker pool as the reads complete,
+/// so the next files are read while the current ones decode. Each worker can hand its decoding to a job
+/// on a decode pool that runs ahead of the measurements through a bounded block queue. It serves cached results first,
+/// and publishes discovery, starting, per-result, and completion callbacks tagged with a run id
 /// so results from cancelled runs are ignored.
 
 #pragma once
@@ -11,14 +14,19 @@
 #include <JuceHeader.h>
 
 #include <atomic>
+#include <condition_variable>
 #include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 /// Coordinates background audio analysis jobs and marshals result callbacks to the UI layer.
 class AnalysisCoordinator
 {
 public:
-    /// Called once after a run has published all queued results.
+    /// Called once after a run has published all queued results, with the number of files the run found.
     using CompletionCallback = std::function<void(int totalFiles)>;
 
     /// Called for each analysed file as results become available.
@@ -27,6 +35,10 @@ public:
     /// Called right before a file's analysis begins, from the worker thread.
     using StartingCallback = std::function<void(const juce::File& file)>;
 
+    /// Called for each batch of found files, before any of their results, from the discovery thread.
+    /// Receives the files that need analysis and the number of files found in the batch, cached ones included.
+    using DiscoveryCallback = std::function<void(const std::vector<AudioFileInfo>& staleFiles, int discoveredFiles)>;
+
     /// Creates a coordinator with a thread pool sized for the current machine.
     explicit AnalysisCoordinator(AnalysisCache& analysisCache, int workerCount = juce::SystemStats::getNumCpus());
 
@@ -48,13 +60,93 @@ public:
     /// Sets the callback invoked when a file's analysis is about to start.
     void setStartingCallback(StartingCallback callback);
 
-    /// Starts a background analysis run and returns its monotonically increasing run id.
-    int start(const AudioAnalysisOptions& options);
+    /// Sets the callback invoked for each batch of found files.
+    void setDiscoveryCallback(DiscoveryCallback callback);
+
+    /// Starts a background analysis run over the input paths.
+    /// Files are queued for analysis while the directories are still being listed,
+    /// so results arrive in discovery order rather than sorted.
+    /// The completion callback runs once discovery and analysis have both finished, also when nothing was found.
+    void start(const AudioAnalysisOptions& options);
 
     /// Starts a background analysis run using a precomputed file list.
-    int start(const AudioAnalysisOptions& options, const juce::Array<juce::File>& files);
+    void start(const AudioAnalysisOptions& options, const juce::Array<juce::File>& files);
 
 private:
+    /// A stale file waiting for analysis, with its estimated cost.
+    struct QueuedFile {
+        AudioFileInfo fileInfo;
+        double cost = 0.0;
+    };
+
+    /// A file taken from its device queue, with its bytes once read ahead, waiting for an analysis worker.
+    struct ReadyFile {
+        AudioFileInfo fileInfo;
+        double cost = 0.0;
+        juce::String deviceKey;
+        /// The file's bytes, read ahead when prefetched is set. Empty when the read failed.
+        juce::MemoryBlock data;
+        /// Unset for files too large to read ahead and for PCM files mapped from a local disk,
+        /// which keep their device slot and are read from storage while analyzed.
+        bool prefetched = false;
+    };
+
+    /// Files waiting on one storage device, and the device's adaptive limit on files read at the same time.
+    /// A spinning disk or network share slows down when many decoders seek on it at once,
+    /// while a fast SSD keeps up with every worker, so each device finds its own limit from measured throughput.
+    struct DeviceQueue {
+        /// Max-heap on cost of the device's files that no job has taken yet.
+        std::vector<QueuedFile> files;
+        int activeFiles = 0;
+        /// Starts at half the workers, a middle ground between a disk that wants one reader and an SSD that wants all.
+        int limit = 0;
+        /// Direction of the next limit change, +1 or -1.
+        int limitStep = 1;
+        double windowStartedAtMs = 0.0;
+        std::int64_t windowBytes = 0;
+        int windowFiles = 0;
+        double lastThroughput = 0.0;
+        /// Set for local disks, where PCM files are mapped by the analysis instead of read ahead.
+        bool isLocal = false;
+    };
+
+    /// Storage device of a directory, resolved once per directory.
+    struct DeviceInfo {
+        juce::String key;
+        bool isLocal = false;
+    };
+
+    /// Publishes cached results for the found files, adds the stale ones to the cost queue,
+    /// and starts one prefetch job and one analysis job per stale file.
+    void queueFiles(const std::vector<AudioFileInfo>& files, const AudioAnalysisOptions& options, int runId);
+
+    /// Body of a prefetch job: takes the most expensive queued file on a device below its I/O limit,
+    /// reads it into memory unless it is too large or will be mapped, and hands it to the analysis workers.
+    /// Waits for a free slot when every device with queued files is at its limit,
+    /// and for buffers to be released when the file would exceed the read-ahead budget.
+    /// Jobs are not tied to a file, so a large file found late still starts before the small files queued earlier,
+    /// and the run does not end on one long file started last.
+    void prefetchNextFile(int runId);
+
+    /// Body of an analysis job: takes the most expensive file that was read ahead, or handed over for streaming,
+    /// and analyzes it, waiting for the prefetch jobs when none is ready.
+    void analyzeNextFile(const AudioAnalysisOptions& options, int runId);
+
+    /// Counts a finished read toward the device's throughput and moves its limit by one step
+    /// once enough files finished: on in the same direction while throughput holds, back when it drops.
+    /// Called with queueLock held.
+    void finishDeviceFile(const juce::String& deviceKey, std::int64_t fileSize);
+
+    /// Logs how busy the workers were over the finished run and how long its tail took.
+    void logRunUtilization() const;
+
+    /// Drops one pending job or the discovery hold of the run,
+    /// flushing the cache and publishing completion when it was the last one.
+    void releasePendingJob(int runId);
+
+    /// Invokes the discovery callback when the given run id is still current.
+    void publishDiscovered(const std::vector<AudioFileInfo>& staleFiles, int foundFiles, int runId) const;
+
     /// Invokes the completion callback when the given run id is still current.
     /// The callback is copied under the lock and invoked without it,
     /// so the callback may safely call back into the coordinator.
@@ -72,8 +164,41 @@ private:
     CompletionCallback completionCallback;
     ResultCallback resultCallback;
     StartingCallback startingCallback;
+    DiscoveryCallback discoveryCallback;
     juce::CriticalSection callbackLock;
     juce::ThreadPool threadPool;
+    /// Reads files ahead of the analysis workers. Reads mostly wait on storage, so they get their own threads.
+    juce::ThreadPool prefetchPool;
+    /// Decodes files for the analysis workers, one thread per worker so every worker's decode job starts at once.
+    juce::ThreadPool decodePool;
+    /// Runs the directory walk of the current run, so start returns right away.
+    juce::ThreadPool discoveryPool {1};
     std::atomic<int> currentRunId {0};
+    /// Queued and running analysis jobs, plus one while the run is still discovering files.
     std::atomic<int> pendingJobs {0};
+    std::atomic<int> discoveredFiles {0};
+
+    /// Device of each directory seen so far. Only used by queueFiles, which never runs concurrently with itself.
+    std::unordered_map<juce::String, DeviceInfo> deviceKeys;
+
+    /// Guards deviceQueues, readyFiles, idleContexts, prefetchedBytes, and the run timing below.
+    mutable std::mutex queueLock;
+    /// Notified when files are queued, when a read finishes and frees an I/O slot on its device,
+    /// when a worker releases a buffer, and when the run is cancelled.
+    std::condition_variable slotFreed;
+    /// Queues by device key. Tuned limits are kept from run to run.
+    std::map<juce::String, DeviceQueue> deviceQueues;
+    /// Max-heap on cost of the files handed to the analysis workers and not taken yet.
+    std::vector<ReadyFile> readyFiles;
+    /// Analysis buffers of the workers that are not analyzing a file, one per worker in total.
+    /// A worker takes one with its file and returns it when done, so the buffers outlive every run.
+    std::vector<std::unique_ptr<AudioAnalysisContext>> idleContexts;
+    /// Notified when a file is added to readyFiles and when the run is cancelled.
+    std::condition_variable fileReady;
+    /// Bytes of files being read ahead or waiting in memory, bounded by the read-ahead budget.
+    std::int64_t prefetchedBytes = 0;
+    double runStartedAtMs = 0.0;
+    double lastFileStartedAtMs = 0.0;
+    double busyMs = 0.0;
+    int analyzedFiles = 0;
 };
@@ -1,12 +1,14 @@
 /// Implementation of the AudioAnalysisCli argument parsing and analysis workflow.
-/// Covers option validation, the usage text,
-/// and the console output formatting that prints aligned peak, true peak,
+/// Covers option validation, the usage text, I/O tuning overrides and calibration,
+/// cache statistics, pruning, export and import, and the console output formatting that prints aligned peak, true peak,
 /// and loudness columns for analysis and normalization results.
 
 #include "AudioAnalysisCli.h"
 
 #include "AudioAnalysisService.h"
+#include "AudioIoCalibration.h"
 #include "AudioNormalizationService.h"
+#include "FileFingerprint.h"
 #include "utils.h"
 #include "version.h"
 
@@ -18,23 +20,38 @@ namespace audiobatch::cli
 constexpr int cliPeakColumnWidth = 7;
 constexpr int cliTruePeakColumnWidth = 7;
 constexpr int cliLoudnessColumnWidth = 8;
+/// Stop-at-peak levels must lie above this, since JUCE turns it and anything lower into a gain of zero,
+/// which the first block of every file would reach.
+constexpr float minimumStopAtPeakDb = -100.0f;
+
+/// Returns the prefix marking a peak as a lower bound when decoding stopped early at the stop-at-peak level.
+static juce::String lowerBoundPrefix(const AudioAnalysisRecord& record)
+{
+    return record.isComplete ? juce::String() : juce::String(">=");
+}
 
 /// Formats the sample peak value right-aligned to the fixed dBFS column width.
 static juce::String formattedPeakColumn(const AudioAnalysisRecord& record)
 {
-    return AudioAnalysisService::formatPeakCompact(record.overallPeak).paddedLeft(' ', cliPeakColumnWidth);
+    const auto text = lowerBoundPrefix(record) + AudioAnalysisService::formatPeakCompact(record.overallPeak);
+    return text.paddedLeft(' ', cliPeakColumnWidth);
 }
 
-/// Formats the true peak value right-aligned to the fixed dBTP column width.
+/// Formats the true peak value right-aligned to the fixed dBTP column width, or "-" when it was not measured.
 static juce::String formattedTruePeakColumn(const AudioAnalysisRecord& record)
 {
-    return AudioAnalysisService::formatTruePeakCompact(record.overallTruePeak).paddedLeft(' ', cliTruePeakColumnWidth);
+    const auto text = record.hasTruePeak()
+        ? lowerBoundPrefix(record) + AudioAnalysisService::formatTruePeakCompact(record.overallTruePeak)
+        : juce::String("-");
+    return text.paddedLeft(' ', cliTruePeakColumnWidth);
 }
 
-/// Formats the integrated loudness value right-aligned to the fixed LUFS column width.
+/// Formats the integrated loudness value right-aligned to the fixed LUFS column width,
+/// or "-" when it was not measured.
 static juce::String formattedIntegratedLoudnessColumn(const AudioAnalysisRecord& record)
 {
-    return AudioAnalysisService::formatLoudnessCompact(record.integratedLufs).paddedLeft(' ', cliLoudnessColumnWidth);
+    const auto text = record.hasLoudness() ? AudioAnalysisService::formatLoudnessCompact(record.integratedLufs) : "-";
+    return text.paddedLeft(' ', cliLoudnessColumnWidth);
 }
 
 /// Prints the column header line to stdout, matching the widths used by the result rows.
@@ -69,6 +86,139 @@ static juce::String reportedOutputPath(const AudioAnalysisRecord& record)
     return record.fileName;
 }
 
+/// Applies the I/O overrides given on the command line to the defaults and every per-format override.
+static AudioIoTuning applyIoOverrides(AudioIoTuning tuning, const AudioAnalysisCliOptions& options)
+{
+    auto applyToSettings = [&options](AudioIoSettings& settings) {
+        if (options.analysisBlockSize.has_value()) {
+            settings.analysisBlockSize = *options.analysisBlockSize;
+        }
+
+        if (options.readaheadKilobytes.has_value()) {
+            settings.readaheadBytes = *options.readaheadKilobytes * 1024;
+        }
+
+        if (options.disableMemoryMapping) {
+            settings.useMemoryMapping = false;
+        }
+    };
+
+    applyToSettings(tuning.defaults);
+
+    for (auto& [extension, settings] : tuning.formatOverrides) {
+        applyToSettings(settings);
+    }
+
+    return tuning;
+}
+
+/// Runs I/O calibration over the input files, stores the fastest settings per format,
+/// and prints a summary. Returns the process exit code.
+static int runIoCalibration(
+    const juce::Array<juce::File>& inputPaths,
+    const bool recursive,
+    juce::PropertiesFile& settings,
+    const AudioIoTuning& tuning
+)
+{
+    const auto files = AudioAnalysisService::collectInputFiles(inputPaths, recursive);
+
+    if (files.isEmpty()) {
+        utils::logError("No supported audio files found for I/O calibration");
+        return 1;
+    }
+
+    utils::logInfo("Calibrating I/O settings with {} candidate files", files.size());
+    const auto results = AudioIoCalibration::calibrate(files, tuning);
+
+    if (results.empty()) {
+        utils::logError("I/O calibration could not measure any files");
+        return 2;
+    }
+
+    AudioIoCalibration::saveTuning(settings, AudioIoCalibration::applyResults(tuning, results));
+    std::cout << AudioIoCalibration::formatSummary(results) << juce::newLine;
+    return 0;
+}
+
+/// Formats a byte count in MiB with two decimals.
+static juce::String formatMebibytes(const std::int64_t bytes)
+{
+    return utils::format("{:.2f} MiB", static_cast<double>(bytes) / (1024.0 * 1024.0));
+}
+
+/// Prunes the analysis cache when requested, then prints its statistics. Returns the process exit code.
+static int runCacheMaintenance(const AudioAnalysisCliOptions& options)
+{
+    AnalysisCache cache;
+
+    if (!cache.open()) {
+        utils::logError("Cannot open the analysis cache at {}", cache.getDatabaseFile().getFullPathName().quoted());
+        return 2;
+    }
+
+    if (options.cachePrune) {
+        AnalysisCacheMaintenanceOptions maintenanceOptions;
+        maintenanceOptions.waveformBudgetBytes = options.cacheBudgetBytes;
+        maintenanceOptions.allowFullVacuum = true;
+
+        const auto result = cache.runMaintenance(maintenanceOptions);
+
+        if (!result.completed) {
+            utils::logError("Analysis cache maintenance failed after {:.2f} s", result.elapsedSeconds);
+            return 2;
+        }
+
+        std::cout << "Stale rows removed:      " << result.staleRows << juce::newLine;
+        std::cout << "Missing files removed:   " << result.missingFiles << juce::newLine;
+        std::cout << "Waveforms evicted:       " << result.evictedWaveforms << juce::newLine;
+        std::cout << "Reclaimed:               " << formatMebibytes(result.reclaimedBytes) << juce::newLine;
+        std::cout << "Time:                    " << utils::format("{:.2f} s", result.elapsedSeconds) << juce::newLine;
+    }
+
+    const auto stats = cache.getStats();
+    std::cout << "Database:                " << cache.getDatabaseFile().getFullPathName() << juce::newLine;
+    std::cout << "Analysis rows:           " << stats.analysisRows << juce::newLine;
+    std::cout << "Waveform previews:       " << stats.waveformRows << " ("
+              << formatMebibytes(stats.waveformBytes) << ")" << juce::newLine;
+    std::cout << "Database size:           " << formatMebibytes(stats.databaseBytes) << " ("
+              << formatMebibytes(stats.freeBytes) << " free)" << juce::newLine;
+    return 0;
+}
+
+/// Exports or imports the cached analyses below the root directory and prints a summary.
+/// Returns the process exit code.
+static int runCacheTransfer(const AudioAnalysisCliOptions& options, const juce::Array<juce::File>& inputPaths)
+{
+    if (inputPaths.size() != 1 || !inputPaths.getFirst().isDirectory()) {
+        utils::logError("Cache export and import need exactly one library root directory");
+        return 1;
+    }
+
+    const auto& rootDirectory = inputPaths.getFirst();
+    AnalysisCache cache;
+
+    if (!cache.open()) {
+        utils::logError("Cannot open the analysis cache at {}", cache.getDatabaseFile().getFullPathName().quoted());
+        return 2;
+    }
+
+    const auto exporting = options.cacheExportFile.has_value();
+    const auto result = exporting ? cache.exportAnalyses(rootDirectory, *options.cacheExportFile)
+                                  : cache.importAnalyses(*options.cacheImportFile, rootDirectory);
+
+    if (result.hasError()) {
+        utils::logError("{}", result.errorMessage);
+        return 2;
+    }
+
+    std::cout << (exporting ? "Exported:                " : "Imported:                ") << result.transferredRows
+              << juce::newLine;
+    std::cout << "Skipped:                 " << result.skippedRows << juce::newLine;
+    std::cout << "Time:                    " << utils::format("{:.2f} s", result.elapsedSeconds) << juce::newLine;
+    return 0;
+}
+
 }  // namespace audiobatch::cli
 
 using namespace audiobatch::cli;
@@ -101,6 +251,30 @@ juce::String AudioAnalysisCli::buildUsage(const juce::String& executableName)
     usage += juce::newLine;
     usage += "  -s, --sort <mode>       Sort by peak, lufs, name, or path";
     usage += juce::newLine;
+    usage += "  -p, --profile <name>    Measure peak-only, peak+loudness, or full (default) analysis";
+    usage += juce::newLine;
+    usage += "  --stop-at-peak <dBFS>   Stop reading each file once its sample peak reaches the level";
+    usage += juce::newLine;
+    usage += "  --fingerprint <mode>    Recognize moved files by none, fast (default), or full content hash";
+    usage += juce::newLine;
+    usage += "  --block-size <frames>   Override the analysis block size";
+    usage += juce::newLine;
+    usage += "  --readahead <KiB>       Buffer streamed reads with the given readahead size";
+    usage += juce::newLine;
+    usage += "  --no-mmap               Read uncompressed files as streams instead of memory-mapping them";
+    usage += juce::newLine;
+    usage += "  --calibrate             Measure and store the fastest I/O settings per format, then exit";
+    usage += juce::newLine;
+    usage += "  --cache-stats           Print analysis cache statistics, then exit";
+    usage += juce::newLine;
+    usage += "  --cache-prune           Prune and vacuum the analysis cache, print statistics, then exit";
+    usage += juce::newLine;
+    usage += "  --cache-budget <MiB>    Waveform preview budget kept by --cache-prune (default 256)";
+    usage += juce::newLine;
+    usage += "  --cache-export <file>   Write the cached analyses below the given root to a portable file, then exit";
+    usage += juce::newLine;
+    usage += "  --cache-import <file>   Store the analyses from an export for the same files below the given root";
+    usage += juce::newLine;
     return usage;
 }
 
@@ -113,6 +287,10 @@ std::optional<AudioAnalysisCliOptions> AudioAnalysisCli::parse(juce::ArgumentLis
     options.recursive = arguments.removeOptionIfFound("--recurse|-r");
     options.refresh = arguments.removeOptionIfFound("--refresh|-f");
     options.normalize = arguments.removeOptionIfFound("--normalize|-n");
+    options.calibrateIo = arguments.removeOptionIfFound("--calibrate");
+    options.disableMemoryMapping = arguments.removeOptionIfFound("--no-mmap");
+    options.cacheStats = arguments.removeOptionIfFound("--cache-stats");
+    options.cachePrune = arguments.removeOptionIfFound("--cache-prune");
 
     if (const auto workerCountValue = arguments.removeValueForOption("--jobs|-j"); workerCountValue.isNotEmpty()) {
         options.workerCount = workerCountValue.getIntValue();
@@ -123,6 +301,99 @@ std::optional<AudioAnalysisCliOptions> AudioAnalysisCli::parse(juce::ArgumentLis
         }
     }
 
+    if (const auto blockSizeValue = arguments.removeValueForOption("--block-size"); blockSizeValue.isNotEmpty()) {
+        options.analysisBlockSize = blockSizeValue.getIntValue();
+
+        if (*options.analysisBlockSize < AudioIoSettings::minimumBlockSize
+            || *options.analysisBlockSize > AudioIoSettings::maximumBlockSize)
+        {
+            errorMessage = utils::format(
+                "Block size must be between {} and {} frames",
+                AudioIoSettings::minimumBlockSize,
+                AudioIoSettings::maximumBlockSize
+            );
+            return std::nullopt;
+        }
+    }
+
+    if (const auto readaheadValue = arguments.removeValueForOption("--readahead"); readaheadValue.isNotEmpty()) {
+        constexpr int maximumReadaheadKilobytes = AudioIoSettings::maximumReadaheadBytes / 1024;
+        options.readaheadKilobytes = readaheadValue.getIntValue();
+
+        if (*options.readaheadKilobytes < 0 || *options.readaheadKilobytes > maximumReadaheadKilobytes) {
+            errorMessage = utils::format("Readahead must be between 0 and {} KiB", maximumReadaheadKilobytes);
+            return std::nullopt;
+        }
+    }
+
+    if (const auto exportValue = arguments.removeValueForOption("--cache-export"); exportValue.isNotEmpty()) {
+        options.cacheExportFile = juce::File::getCurrentWorkingDirectory().getChildFile(exportValue);
+    }
+
+    if (const auto importValue = arguments.removeValueForOption("--cache-import"); importValue.isNotEmpty()) {
+        options.cacheImportFile = juce::File::getCurrentWorkingDirectory().getChildFile(importValue);
+
+        if (options.cacheExportFile.has_value()) {
+            errorMessage = "--cache-export cannot be combined with --cache-import";
+            return std::nullopt;
+        }
+    }
+
+    if (const auto budgetValue = arguments.removeValueForOption("--cache-budget"); budgetValue.isNotEmpty()) {
+        const auto budgetMebibytes = budgetValue.getLargeIntValue();
+
+        if (budgetMebibytes < 0 || !budgetValue.trim().containsOnly("0123456789")) {
+            errorMessage = "Cache budget must be a whole number of MiB";
+            return std::nullopt;
+        }
+
+        options.cacheBudgetBytes = budgetMebibytes << 20;
+    }
+
+    if (const auto profileValue = arguments.removeValueForOption("--profile|-p"); profileValue.isNotEmpty()) {
+        const auto profile = AudioAnalysisService::parseProfileName(profileValue);
+
+        if (!profile.has_value()) {
+            errorMessage = "Analysis profile must be one of: peak-only, peak+loudness, full";
+            return std::nullopt;
+        }
+
+        options.profile = *profile;
+    }
+
+    if (const auto stopValue = arguments.removeValueForOption("--stop-at-peak"); stopValue.isNotEmpty()) {
+        if (const auto trimmedValue = stopValue.trim();
+            trimmedValue.containsOnly("+-.0123456789") && trimmedValue.containsAnyOf("0123456789"))
+        {
+            options.stopAtPeakDb = trimmedValue.getFloatValue();
+        } else {
+            errorMessage = "Stop-at-peak level must be a number in dBFS";
+            return std::nullopt;
+        }
+
+        if (*options.stopAtPeakDb <= minimumStopAtPeakDb) {
+            errorMessage = utils::format("Stop-at-peak level must be above {} dBFS", minimumStopAtPeakDb);
+            return std::nullopt;
+        }
+
+        if (options.normalize) {
+            // Normalization gains come from the full-file peak, which a stopped analysis does not measure.
+            errorMessage = "--stop-at-peak cannot be combined with --normalize";
+            return std::nullopt;
+        }
+    }
+
+    if (const auto fingerprintValue = arguments.removeValueForOption("--fingerprint"); fingerprintValue.isNotEmpty()) {
+        const auto fingerprintMode = FileFingerprint::parseModeName(fingerprintValue);
+
+        if (!fingerprintMode.has_value()) {
+            errorMessage = "Fingerprint mode must be one of: none, fast, full";
+            return std::nullopt;
+        }
+
+        options.fingerprintMode = *fingerprintMode;
+    }
+
     if (const auto sortValue = arguments.removeValueForOption("--sort|-s"); sortValue.isNotEmpty()) {
         const auto normalizedSort = sortValue.trim().toLowerCase();
 
@@ -154,6 +425,10 @@ std::optional<AudioAnalysisCliOptions> AudioAnalysisCli::parse(juce::ArgumentLis
 
 int AudioAnalysisCli::run(const AudioAnalysisCliOptions& options)
 {
+    if (options.cacheStats || options.cachePrune) {
+        return runCacheMaintenance(options);
+    }
+
     auto inputPaths = options.inputPaths;
 
     if (inputPaths.isEmpty()) {
@@ -163,6 +438,20 @@ int AudioAnalysisCli::run(const AudioAnalysisCliOptions& options)
         );
     }
 
+    if (options.cacheExportFile.has_value() || options.cacheImportFile.has_value()) {
+        return runCacheTransfer(options, inputPaths);
+    }
+
+    juce::PropertiesFile settings(utils::settingsFileOptions());
+    const auto storedTuning = AudioIoCalibration::loadTuning(settings);
+
+    if (options.calibrateIo) {
+        // Calibrate from the stored tuning, so command-line overrides do not end up saved.
+        return runIoCalibration(inputPaths, options.recursive, settings, storedTuning);
+    }
+
+    AudioAnalysisService::setIoTuning(applyIoOverrides(storedTuning, options));
+
     AnalysisCache cache;
     cache.open();
 
@@ -171,6 +460,9 @@ int AudioAnalysisCli::run(const AudioAnalysisCliOptions& options)
     analysisOptions.inputPaths = inputPaths;
     analysisOptions.recursive = options.recursive;
     analysisOptions.refresh = options.refresh;
+    analysisOptions.profile = options.profile;
+    analysisOptions.stopAtPeakDb = options.stopAtPeakDb;
+    analysisOptions.fingerprintMode = options.fingerprintMode;
 
     const auto analysisStartedAtMs = juce::Time::getMillisecondCounterHiRes();
     auto results = coordinator.analyzeBlocking(analysisOptions);
@@ -16,8 +16,20 @@ struct AudioAnalysisCliOptions {
     bool normalize = false;
     bool showHelp = false;
     bool showVersion = false;
+    bool calibrateIo = false;
+    bool disableMemoryMapping = false;
+    bool cacheStats = false;
+    bool cachePrune = false;
     int workerCount = juce::SystemStats::getNumCpus();
+    std::optional<int> analysisBlockSize;
+    std::optional<int> readaheadKilobytes;
+    std::optional<float> stopAtPeakDb;
+    std::int64_t cacheBudgetBytes = AnalysisCacheMaintenanceOptions::defaultWaveformBudgetBytes;
+    std::optional<juce::File> cacheExportFile;
+    std::optional<juce::File> cacheImportFile;
     AudioAnalysisSortMode sortMode = AudioAnalysisSortMode::peak;
+    AudioAnalysisProfile profile = AudioAnalysisProfile::full;
+    AudioFingerprintMode fingerprintMode = AudioFingerprintMode::fast;
     juce::Array<juce::File> inputPaths;
 };
 
@@ -1,11 +1,16 @@
 /// Implementation of AudioAnalysisService.
-/// Decodes files in blocks through per-thread JUCE format readers
-/// and feeds the samples to a libebur128 analyzer state
-/// to measure sample peak, true peak, and integrated loudness.
+/// Decodes files in blocks through per-thread JUCE format readers,
+/// memory-mapped for uncompressed formats, scans sample peaks, feeds a libebur128 analyzer state for loudness,
+/// and oversamples through TruePeakDetector for true peak, skipping what the requested analysis profile leaves out.
+/// Readers that are not memory-mapped can decode on a separate job that runs ahead through a bounded block queue.
+/// Long PCM files are split into time segments that are analyzed in parallel on the owner's pool and merged.
 /// Also implements supported file discovery, the display and CLI formatting helpers, and record sorting.
 
 #include "AudioAnalysisService.h"
 
+#include "DirectoryScanner.h"
+#include "SamplePeakScanner.h"
+#include "TruePeakDetector.h"
 #include "utils.h"
 
 extern "C" {
@@ -14,10 +19,12 @@ extern "C" {
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cmath>
 #include <cstdint>
+#include <functional>
 #include <memory>
-#include <set>
+#include <unordered_set>
 #include <vector>
 
 /// Internal helpers for peak comparisons and stable record sorting.
@@ -26,8 +33,12 @@ namespace audiobatch::analysis
 constexpr float minimumDisplayDecibels = -100.0f;
 constexpr double kilobitsPerSecondDivisor = 1000.0;
 constexpr int defaultMp3BitsPerSample = 16;
-constexpr int analysisBlockSize = 8192;
 constexpr int maxConsecutiveReadFailures = 3;
+constexpr int minimumSegmentSeconds = 300;
+constexpr int segmentPrimingSteps = 3;
+constexpr int shortTermWindowSteps = 30;
+constexpr unsigned long gatingStepMilliseconds = 100;
+constexpr double loudnessOffset = 0.691;
 
 /// Marks the record as failed with the given message and logs the error.
 /// Takes the record by value so callers can hand over a partially filled record with std::move.
@@ -283,15 +294,756 @@ static bool isEndOfFileReadFailure(
     return !readSucceeded && samplePosition + static_cast<std::int64_t>(framesRead) >= totalFrames;
 }
 
-/// Creates an ebur128 state configured for integrated, short-term, and true peak measurement.
-static EbuR128StatePtr createLoudnessState(const int channelCount, const int sampleRate)
+/// Returns the libebur128 mode that measures what the profile needs, or 0 when it needs no analyzer state.
+/// Short-term loudness is tracked from 100 ms steps by ShortTermLoudnessTracker,
+/// so no mode keeps the 3 s history EBUR128_MODE_S would need,
+/// and true peak is measured by TruePeakDetector instead of EBUR128_MODE_TRUE_PEAK.
+static int loudnessModeForProfile(const AudioAnalysisProfile profile)
+{
+    switch (profile) {
+        case AudioAnalysisProfile::peakOnly:
+            return 0;
+        case AudioAnalysisProfile::peakAndLoudness:
+        case AudioAnalysisProfile::full:
+        default:
+            return EBUR128_MODE_I;
+    }
+}
+
+/// Returns true when the profile measures the oversampled true peak.
+static bool measuresTruePeak(const AudioAnalysisProfile profile)
+{
+    return profile == AudioAnalysisProfile::full;
+}
+
+/// Creates an ebur128 state with the given measurement mode.
+static EbuR128StatePtr createLoudnessState(const int channelCount, const int sampleRate, const int mode)
 {
-    constexpr auto mode = EBUR128_MODE_I | EBUR128_MODE_S | EBUR128_MODE_TRUE_PEAK;
     return EbuR128StatePtr(
         ebur128_init(static_cast<unsigned int>(channelCount), static_cast<unsigned long>(sampleRate), mode)
     );
 }
 
+/// Returns the libebur128 gating step of 100 ms in frames, rounded the same way the library does.
+/// Gating blocks are 400 ms long and start on every step counted from the beginning of the analyzer input.
+static std::int64_t framesPerGatingStep(const int sampleRate)
+{
+    return (static_cast<std::int64_t>(sampleRate) + 5) / 10;
+}
+
+/// Returns the channel-weighted mean square of the most recent 100 ms added to the analyzer state,
+/// or 0 for silence.
+static double readStepEnergy(ebur128_state* state)
+{
+    double loudness = 0.0;
+
+    if (ebur128_loudness_window(state, gatingStepMilliseconds, &loudness) != EBUR128_SUCCESS
+        || !std::isfinite(loudness))
+    {
+        return 0.0;
+    }
+
+    return std::pow(10.0, (loudness + loudnessOffset) / 10.0);
+}
+
+/// Fixed-capacity history of the most recent 100 ms step energies, indexed oldest first.
+/// Unlike a deque, pushing steps through it never allocates.
+class StepWindow
+{
+public:
+    /// Appends a step, dropping the oldest step once the window is full.
+    void push(const double energy)
+    {
+        if (count < shortTermWindowSteps) {
+            steps[static_cast<size_t>((first + count) % shortTermWindowSteps)] = energy;
+            ++count;
+        } else {
+            steps[static_cast<size_t>(first)] = energy;
+            first = (first + 1) % shortTermWindowSteps;
+        }
+    }
+
+    /// Returns the number of steps held.
+    [[nodiscard]] int size() const noexcept
+    {
+        return count;
+    }
+
+    /// Returns the step at the index, counted from the oldest.
+    [[nodiscard]] double operator[](const int index) const
+    {
+        return steps[static_cast<size_t>((first + index) % shortTermWindowSteps)];
+    }
+
+    /// Removes every step.
+    void clear() noexcept
+    {
+        first = 0;
+        count = 0;
+    }
+
+private:
+    std::array<double, shortTermWindowSteps> steps {};
+    int first = 0;
+    int count = 0;
+};
+
+/// Streaming maximum of the EBU R128 short-term loudness, evaluated every 100 ms.
+/// Each 3 s window is the mean of the energies of its 30 steps, so a window costs 30 additions
+/// instead of another pass over 3 s of audio.
+///
+/// A tracker that starts at the beginning of the file also evaluates the windows that end within the first 3 s,
+/// with the missing history counted as silence, as libebur128 does.
+/// Any other tracker only evaluates windows that lie fully inside its range,
+/// and keeps its first steps so append() can evaluate the windows that reach back across the seam.
+class ShortTermLoudnessTracker
+{
+public:
+    explicit ShortTermLoudnessTracker(const bool startsFile) : coversFileStart(startsFile) { }
+
+    /// Forgets every step, keeping the allocated history for the next range.
+    void reset(const bool startsFile)
+    {
+        coversFileStart = startsFile;
+        maxWindowEnergy = 0.0;
+        firstSteps.clear();
+        recentSteps.clear();
+    }
+
+    /// Adds the energy of the next 100 ms step and evaluates the window that ends with it.
+    void addStep(const double energy)
+    {
+        if (std::ssize(firstSteps) < shortTermWindowSteps - 1) {
+            firstSteps.push_back(energy);
+        }
+
+        recentSteps.push(energy);
+
+        if (coversFileStart || recentSteps.size() == shortTermWindowSteps) {
+            evaluateWindow(recentSteps);
+        }
+    }
+
+    /// Extends the tracked range with the range that directly follows it.
+    void append(const ShortTermLoudnessTracker& following)
+    {
+        auto seamSteps = recentSteps;
+
+        // Windows ending in the first 29 steps of the following range reach back into this one.
+        // While this range starts the file and is still shorter than a window, seamSteps holds all of its history.
+        for (const auto energy : following.firstSteps) {
+            seamSteps.push(energy);
+
+            if (coversFileStart || seamSteps.size() == shortTermWindowSteps) {
+                evaluateWindow(seamSteps);
+            }
+        }
+
+        maxWindowEnergy = std::max(maxWindowEnergy, following.maxWindowEnergy);
+
+        for (const auto energy : following.firstSteps) {
+            if (std::ssize(firstSteps) >= shortTermWindowSteps - 1) {
+                break;
+            }
+
+            firstSteps.push_back(energy);
+        }
+
+        for (int index = 0; index < following.recentSteps.size(); ++index) {
+            recentSteps.push(following.recentSteps[index]);
+        }
+    }
+
+    /// Returns the highest short-term loudness evaluated, or the negative infinity sentinel when there was none.
+    [[nodiscard]] double getMaxLoudness() const
+    {
+        if (maxWindowEnergy <= 0.0) {
+            return AudioAnalysisRecord::negativeInfinityLoudness;
+        }
+
+        return normalizeLoudness(10.0 * std::log10(maxWindowEnergy) - loudnessOffset);
+    }
+
+private:
+    /// Updates the maximum with the window made of the given steps.
+    /// The sum is recomputed for every window, so no rounding error builds up over long files.
+    void evaluateWindow(const StepWindow& steps)
+    {
+        double windowEnergy = 0.0;
+
+        for (int index = 0; index < steps.size(); ++index) {
+            windowEnergy += steps[index];
+        }
+
+        maxWindowEnergy = std::max(maxWindowEnergy, windowEnergy / shortTermWindowSteps);
+    }
+
+    bool coversFileStart = true;
+    double maxWindowEnergy = 0.0;
+    std::vector<double> firstSteps;
+    StepWindow recentSteps;
+};
+
+/// Peak and short-term loudness measurements collected over a range of frames.
+struct RangeMeasurement {
+    explicit RangeMeasurement(const int channelCount = 0, const bool startsFile = true) :
+        minSamples(static_cast<size_t>(channelCount), 0.0f),
+        maxSamples(static_cast<size_t>(channelCount), 0.0f),
+        truePeaks(static_cast<size_t>(channelCount), 0.0),
+        shortTerm(startsFile)
+    { }
+
+    /// Clears the measurements for a new range, keeping the allocated storage when the channel count allows.
+    void reset(const int channelCount, const bool startsFile = true)
+    {
+        minSamples.assign(static_cast<size_t>(channelCount), 0.0f);
+        maxSamples.assign(static_cast<size_t>(channelCount), 0.0f);
+        truePeaks.assign(static_cast<size_t>(channelCount), 0.0);
+        shortTerm.reset(startsFile);
+    }
+
+    /// Combines the range that directly follows this one into it.
+    /// Ranges must be merged in file order, since short-term windows span the seams.
+    void merge(const RangeMeasurement& following)
+    {
+        for (size_t channel = 0; channel < minSamples.size(); ++channel) {
+            minSamples[channel] = std::min(minSamples[channel], following.minSamples[channel]);
+            maxSamples[channel] = std::max(maxSamples[channel], following.maxSamples[channel]);
+            truePeaks[channel] = std::max(truePeaks[channel], following.truePeaks[channel]);
+        }
+
+        shortTerm.append(following.shortTerm);
+    }
+
+    std::vector<float> minSamples;
+    std::vector<float> maxSamples;
+    std::vector<double> truePeaks;
+    ShortTermLoudnessTracker shortTerm;
+};
+
+/// Read and interleave buffers and the true peak interpolator reused for every block of one analyzer pass.
+struct BlockFeeder {
+    BlockFeeder() = default;
+
+    BlockFeeder(const int channelCount, const int blockSize, const int sampleRate, const bool measuresTruePeak)
+    {
+        prepare(channelCount, blockSize, sampleRate, measuresTruePeak);
+    }
+
+    /// Sets the feeder up for a new analyzer pass.
+    /// Buffers only grow, so a feeder reused for files with the same or fewer channels and frames does not allocate.
+    void prepare(const int channelCount, const int blockSize, const int sampleRate, const bool measuresTruePeak)
+    {
+        readBuffer.setSize(channelCount, blockSize, false, false, true);
+        interleaved.resize(channelCount > 1 ? static_cast<size_t>(channelCount * blockSize) : 0);
+        gatingStep = framesPerGatingStep(sampleRate);
+
+        if (!measuresTruePeak) {
+            truePeakDetector.reset();
+        } else if (truePeakDetector == nullptr) {
+            truePeakDetector = std::make_unique<TruePeakDetector>(channelCount, sampleRate);
+        } else {
+            truePeakDetector->prepare(channelCount, sampleRate);
+        }
+    }
+
+    /// Returns the number of frames read per block.
+    [[nodiscard]] int getBlockSize() const noexcept
+    {
+        return readBuffer.getNumSamples();
+    }
+
+    /// Scans the sample extremes of the first frames in the read buffer, raises the interpolated true peaks,
+    /// and adds the frames to the analyzer state.
+    /// Without a state only the peaks are measured.
+    /// A mono block already has the frame layout libebur128 expects, so it is fed straight from the read buffer.
+    /// Other layouts are interleaved in the same pass that scans the sample peaks.
+    ///
+    /// The frames are added in chunks that end on the 100 ms grid of the file,
+    /// so the energy of every completed step can be read for the short-term tracker.
+    bool addBlock(
+        ebur128_state* state,
+        const std::int64_t startFrame,
+        const int numFrames,
+        RangeMeasurement& measurement
+    )
+    {
+        return addBlock(readBuffer, state, startFrame, numFrames, measurement);
+    }
+
+    /// Same as above for frames decoded into another buffer, such as a slot of a DecodedBlockQueue.
+    bool addBlock(
+        const juce::AudioBuffer<float>& block,
+        ebur128_state* state,
+        const std::int64_t startFrame,
+        const int numFrames,
+        RangeMeasurement& measurement
+    )
+    {
+        const auto channelCount = block.getNumChannels();
+        const float* loudnessFrames = block.getReadPointer(0);
+
+        if (truePeakDetector != nullptr) {
+            truePeakDetector->process(block.getArrayOfReadPointers(), numFrames, measurement.truePeaks.data());
+        }
+
+        if (state == nullptr) {
+            for (int channel = 0; channel < channelCount; ++channel) {
+                SamplePeakScanner::updateExtrema(
+                    block.getReadPointer(channel),
+                    numFrames,
+                    measurement.minSamples[static_cast<size_t>(channel)],
+                    measurement.maxSamples[static_cast<size_t>(channel)]
+                );
+            }
+
+            return true;
+        }
+
+        if (channelCount == 1) {
+            SamplePeakScanner::updateExtrema(
+                loudnessFrames, numFrames, measurement.minSamples.front(), measurement.maxSamples.front()
+            );
+        } else {
+            SamplePeakScanner::interleaveWithExtrema(
+                block.getArrayOfReadPointers(),
+                channelCount,
+                numFrames,
+                interleaved.data(),
+                measurement.minSamples.data(),
+                measurement.maxSamples.data()
+            );
+            loudnessFrames = interleaved.data();
+        }
+
+        const auto endFrame = startFrame + numFrames;
+
+        for (auto chunkStart = startFrame; chunkStart < endFrame;) {
+            const auto chunkEnd = std::min(endFrame, (chunkStart / gatingStep + 1) * gatingStep);
+            const auto* chunkFrames = loudnessFrames + (chunkStart - startFrame) * channelCount;
+
+            if (ebur128_add_frames_float(state, chunkFrames, static_cast<size_t>(chunkEnd - chunkStart))
+                != EBUR128_SUCCESS)
+            {
+                return false;
+            }
+
+            if (chunkEnd % gatingStep == 0) {
+                measurement.shortTerm.addStep(readStepEnergy(state));
+            }
+
+            chunkStart = chunkEnd;
+        }
+
+        return true;
+    }
+
+    juce::AudioBuffer<float> readBuffer;
+    std::vector<float> interleaved;
+    std::unique_ptr<TruePeakDetector> truePeakDetector;
+    std::int64_t gatingStep = 0;
+};
+
+/// Bounded queue of decoded blocks between a decode job and the analyzing thread, with one producer and one consumer.
+/// The slots are preallocated and reused for every file, and each side only waits on and notifies an atomic counter,
+/// so handing a block over takes no lock and no allocation.
+/// The counters start at zero for every file and cannot reach the closed bit, which would take 2^31 blocks.
+class DecodedBlockQueue
+{
+public:
+    /// Blocks the decode job may run ahead of the analysis.
+    static constexpr std::uint32_t capacity = 4;
+
+    /// A decoded block and its place in the file.
+    struct Block {
+        juce::AudioBuffer<float> buffer;
+        std::int64_t startFrame = 0;
+        int numFrames = 0;
+        bool readSucceeded = false;
+    };
+
+    /// Sizes the slots for a new file and empties the queue. Must not be called while a decode job runs.
+    void prepare(const int channelCount, const int blockSize)
+    {
+        for (auto& block : blocks) {
+            block.buffer.setSize(channelCount, blockSize, false, false, true);
+        }
+
+        writeCount.store(0);
+        readCount.store(0);
+    }
+
+    /// Producer side. Returns the next free slot, waiting while the queue is full,
+    /// or nullptr once the consumer has closed the queue.
+    Block* beginWrite()
+    {
+        const auto written = writeCount.load(std::memory_order_relaxed);
+
+        for (;;) {
+            const auto read = readCount.load(std::memory_order_acquire);
+
+            if ((read & closedBit) != 0) {
+                return nullptr;
+            }
+
+            if (written - read < capacity) {
+                return &blocks[written % capacity];
+            }
+
+            readCount.wait(read, std::memory_order_acquire);
+        }
+    }
+
+    /// Producer side. Hands the slot returned by beginWrite to the consumer.
+    void endWrite()
+    {
+        writeCount.fetch_add(1, std::memory_order_release);
+        writeCount.notify_one();
+    }
+
+    /// Producer side. Marks the end of the decoded blocks.
+    /// Afterwards the producer must not touch the reader or the slots, since the consumer may release them.
+    void finish()
+    {
+        writeCount.fetch_or(closedBit, std::memory_order_release);
+        writeCount.notify_one();
+    }
+
+    /// Consumer side. Returns the oldest decoded block, waiting while the queue is empty,
+    /// or nullptr once the producer has finished and every block was read.
+    const Block* beginRead() const
+    {
+        const auto read = readCount.load(std::memory_order_relaxed);
+
+        for (;;) {
+            const auto written = writeCount.load(std::memory_order_acquire);
+
+            if ((written & ~closedBit) != read) {
+                return &blocks[read % capacity];
+            }
+
+            if ((written & closedBit) != 0) {
+                return nullptr;
+            }
+
+            writeCount.wait(written, std::memory_order_acquire);
+        }
+    }
+
+    /// Consumer side. Returns the block from beginRead to the producer.
+    void endRead()
+    {
+        readCount.fetch_add(1, std::memory_order_release);
+        readCount.notify_one();
+    }
+
+    /// Consumer side. Stops the producer before the end of the file and waits until it has finished.
+    void close()
+    {
+        readCount.fetch_or(closedBit, std::memory_order_release);
+        readCount.notify_one();
+
+        for (auto written = writeCount.load(std::memory_order_acquire); (written & closedBit) == 0;
+             written = writeCount.load(std::memory_order_acquire))
+        {
+            writeCount.wait(written, std::memory_order_acquire);
+        }
+    }
+
+private:
+    static constexpr std::uint32_t closedBit = 1u << 31;
+
+    std::array<Block, capacity> blocks;
+    /// Blocks decoded, with closedBit set once the producer has finished.
+    std::atomic<std::uint32_t> writeCount {0};
+    /// Blocks analyzed, with closedBit set once the consumer has stopped early.
+    std::atomic<std::uint32_t> readCount {0};
+};
+
+/// Body of a decode job: decodes the file block by block into the queue,
+/// until the end of the file or until the analyzing thread closes the queue.
+static void decodeIntoQueue(juce::AudioFormatReader& reader, DecodedBlockQueue& queue, const int blockSize)
+{
+    for (std::int64_t samplePosition = 0; samplePosition < reader.lengthInSamples; samplePosition += blockSize) {
+        auto* block = queue.beginWrite();
+
+        if (block == nullptr) {
+            break;
+        }
+
+        block->startFrame = samplePosition;
+        block->numFrames
+            = static_cast<int>(std::min<std::int64_t>(blockSize, reader.lengthInSamples - samplePosition));
+        block->buffer.clear();
+        block->readSucceeded = reader.read(&block->buffer, 0, block->numFrames, samplePosition, true, true);
+        queue.endWrite();
+    }
+
+    queue.finish();
+}
+
+/// Frame range of a file analyzed on its own analyzer state.
+struct AnalysisSegment {
+    std::int64_t startFrame = 0;
+    std::int64_t endFrame = 0;
+};
+
+/// Decodes frames [startFrame, endFrame) and adds them to the analyzer state.
+/// Unlike the sequential pass, any read failure fails the range.
+static bool feedRange(
+    juce::AudioFormatReader& reader,
+    ebur128_state* state,
+    BlockFeeder& feeder,
+    const std::int64_t startFrame,
+    const std::int64_t endFrame,
+    RangeMeasurement& measurement
+)
+{
+    for (auto samplePosition = startFrame; samplePosition < endFrame;) {
+        const auto framesThisBlock
+            = static_cast<int>(std::min<std::int64_t>(feeder.getBlockSize(), endFrame - samplePosition));
+
+        if (!reader.read(&feeder.readBuffer, 0, framesThisBlock, samplePosition, true, true)
+            || !feeder.addBlock(state, samplePosition, framesThisBlock, measurement))
+        {
+            return false;
+        }
+
+        samplePosition += framesThisBlock;
+    }
+
+    return true;
+}
+
+/// Returns true for formats whose readers seek sample-accurately and cheaply,
+/// which segmented analysis relies on. Compressed lossy formats stay on the sequential path.
+static bool supportsSegmentedAnalysis(const juce::File& file)
+{
+    const auto extension = normalizedExtension(file);
+    return extension == "wav" || extension == "aif" || extension == "aiff" || extension == "flac";
+}
+
+/// Splits a long file into segments of at least minimumSegmentSeconds, and at most maximumSegments of them.
+/// Boundaries fall on the 100 ms gating grid so the merged gating blocks line up with the sequential ones.
+/// Returns a single segment covering the whole file when splitting is not worthwhile.
+static std::vector<AnalysisSegment> planSegments(
+    const juce::File& file,
+    const std::int64_t totalFrames,
+    const int sampleRate,
+    const int maximumSegments
+)
+{
+    const auto minimumSegmentFrames = static_cast<std::int64_t>(sampleRate) * minimumSegmentSeconds;
+    const auto segmentCount
+        = std::min<std::int64_t>(maximumSegments, totalFrames / std::max<std::int64_t>(1, minimumSegmentFrames));
+
+    if (!supportsSegmentedAnalysis(file) || segmentCount < 2) {
+        return {{0, totalFrames}};
+    }
+
+    const auto gatingStep = framesPerGatingStep(sampleRate);
+    std::vector<AnalysisSegment> segments;
+    std::int64_t startFrame = 0;
+
+    for (std::int64_t index = 1; index < segmentCount; ++index) {
+        const auto boundary = totalFrames * index / segmentCount / gatingStep * gatingStep;
+        segments.push_back({startFrame, boundary});
+        startFrame = boundary;
+    }
+
+    segments.push_back({startFrame, totalFrames});
+    return segments;
+}
+
+/// Returns true when the sample peak of any channel in the measurement reaches the linear level.
+static bool reachesPeakLevel(const RangeMeasurement& measurement, const float levelGain)
+{
+    for (size_t channel = 0; channel < measurement.minSamples.size(); ++channel) {
+        if (-measurement.minSamples[channel] >= levelGain || measurement.maxSamples[channel] >= levelGain) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/// Analyzer state and measurements for one segment,
+/// kept alive until every segment is done so the gating blocks can be merged.
+struct SegmentAnalysis {
+    SegmentAnalysis(const int channelCount, const bool startsFile) : measurement(channelCount, startsFile) { }
+
+    RangeMeasurement measurement;
+    EbuR128StatePtr loudnessState;
+    bool succeeded = false;
+};
+
+/// Segments of one file shared by the analyzing thread and the helper jobs it schedules.
+/// Each segment is claimed once, by whichever thread gets to it first.
+/// Helpers hold the claims through a shared_ptr, so a helper that starts after the file is done
+/// finds every segment claimed and never calls runSegment, whose captures have gone out of scope by then.
+class SegmentClaims
+{
+public:
+    SegmentClaims(std::function<void(size_t)> segmentRunner, const size_t numSegments) :
+        runSegment(std::move(segmentRunner)),
+        segmentCount(numSegments)
+    { }
+
+    /// Claims and runs segments until none are left unclaimed.
+    void runUnclaimed()
+    {
+        for (auto index = nextSegment.fetch_add(1); index < segmentCount; index = nextSegment.fetch_add(1)) {
+            runSegment(index);
+            finishedSegments.fetch_add(1);
+            finishedSegments.notify_all();
+        }
+    }
+
+    /// Blocks until every segment, including those claimed by helpers, has finished.
+    void waitUntilFinished() const
+    {
+        for (auto finished = finishedSegments.load(); finished < segmentCount; finished = finishedSegments.load()) {
+            finishedSegments.wait(finished);
+        }
+    }
+
+private:
+    std::function<void(size_t)> runSegment;
+    const size_t segmentCount;
+    std::atomic<size_t> nextSegment {0};
+    std::atomic<size_t> finishedSegments {0};
+};
+
+/// Analyzes one segment on its own reader and analyzer state.
+///
+/// A segment after the first is primed with the 300 ms before its start,
+/// so its first 400 ms gating block covers the same frames as in the sequential analysis
+/// and every gating block of the file is measured by exactly one segment.
+/// The priming also fills the true peak interpolator history, and its measurements are not counted.
+/// Short-term windows that reach back across the start are evaluated when the segments are merged.
+static void analyzeSegment(
+    juce::AudioFormatReader& reader,
+    const AnalysisSegment segment,
+    const int sampleRate,
+    const int blockSize,
+    const AudioAnalysisProfile profile,
+    SegmentAnalysis& analysis
+)
+{
+    const auto channelCount = static_cast<int>(reader.numChannels);
+    const auto loudnessMode = loudnessModeForProfile(profile);
+    BlockFeeder feeder(channelCount, blockSize, sampleRate, measuresTruePeak(profile));
+
+    if (loudnessMode != 0) {
+        analysis.loudnessState = createLoudnessState(channelCount, sampleRate, loudnessMode);
+
+        if (analysis.loudnessState == nullptr) {
+            return;
+        }
+    }
+
+    if (segment.startFrame > 0 && (analysis.loudnessState != nullptr || feeder.truePeakDetector != nullptr)) {
+        const auto primingStart
+            = std::max<std::int64_t>(0, segment.startFrame - framesPerGatingStep(sampleRate) * segmentPrimingSteps);
+        RangeMeasurement discardedMeasurement(channelCount, false);
+
+        if (!feedRange(
+                reader,
+                analysis.loudnessState.get(),
+                feeder,
+                primingStart,
+                segment.startFrame,
+                discardedMeasurement
+            ))
+        {
+            return;
+        }
+    }
+
+    analysis.succeeded = feedRange(
+        reader, analysis.loudnessState.get(), feeder, segment.startFrame, segment.endFrame, analysis.measurement
+    );
+}
+
+/// Analyzes the segments in parallel and merges them into one measurement and integrated loudness.
+/// One helper job per extra segment goes to the scheduler, then the calling thread analyzes every segment
+/// no helper has claimed yet. Only pool threads that are otherwise idle pick the helpers up in time,
+/// so a busy pool is never oversubscribed and the file simply ends up analyzed by the calling thread.
+///
+/// The merged sample peak and true peak are exact.
+/// Integrated loudness merges the gating blocks of all segments, so the gating itself is exact,
+/// but each seam's first gating block is filtered from a cold K-weighting state.
+/// The filters settle within a few milliseconds, so the result matches the sequential analysis
+/// to well within 0.01 LU, and the 100 ms steps behind the maximum short-term loudness match as closely.
+/// Without loudness in the profile integratedLoudness is left unchanged.
+/// Returns false when any segment fails, so the caller can fall back to the tolerant sequential path.
+static bool analyzeSegmented(
+    const std::function<std::unique_ptr<juce::AudioFormatReader>()>& createReader,
+    const std::vector<AnalysisSegment>& segments,
+    const AudioAnalysisContext::JobScheduler& scheduler,
+    const int channelCount,
+    const int sampleRate,
+    const int blockSize,
+    const AudioAnalysisProfile profile,
+    RangeMeasurement& measurement,
+    double& integratedLoudness
+)
+{
+    std::vector<SegmentAnalysis> analyses;
+    analyses.reserve(segments.size());
+
+    for (const auto& segment : segments) {
+        analyses.emplace_back(channelCount, segment.startFrame == 0);
+    }
+
+    const auto claims = std::make_shared<SegmentClaims>(
+        [&](const size_t index) {
+            if (const auto reader = createReader(); reader != nullptr) {
+                analyzeSegment(*reader, segments[index], sampleRate, blockSize, profile, analyses[index]);
+            }
+        },
+        segments.size()
+    );
+
+    for (size_t index = 1; index < segments.size(); ++index) {
+        scheduler([claims] { claims->runUnclaimed(); });
+    }
+
+    claims->runUnclaimed();
+    claims->waitUntilFinished();
+
+    std::vector<ebur128_state*> states;
+
+    for (const auto& analysis : analyses) {
+        if (!analysis.succeeded) {
+            return false;
+        }
+
+        measurement.merge(analysis.measurement);
+
+        if (analysis.loudnessState != nullptr) {
+            states.push_back(analysis.loudnessState.get());
+        }
+    }
+
+    return states.empty()
+        || ebur128_loudness_global_multiple(states.data(), states.size(), &integratedLoudness) == EBUR128_SUCCESS;
+}
+
+/// Returns the process-wide I/O tuning. Guarded by getIoTuningLock().
+static AudioIoTuning& getIoTuningStorage()
+{
+    static AudioIoTuning tuning;
+    return tuning;
+}
+
+/// Returns the lock guarding the process-wide I/O tuning.
+static juce::CriticalSection& getIoTuningLock()
+{
+    static juce::CriticalSection lock;
+    return lock;
+}
+
 /// Orders failed records after successful ones, regardless of the requested sort key.
 static int compareAnalysisState(const AudioAnalysisRecord& lhs, const AudioAnalysisRecord& rhs)
 {
@@ -307,10 +1059,57 @@ static int compareText(const juce::String& lhs, const juce::String& rhs)
 {
     return lhs.compareNatural(rhs);
 }
+
+/// Returns the extensions of the basic JUCE formats, lowercase and without the leading dot.
+/// Built once, so checking a directory entry is one hash lookup instead of a scan over the registered formats.
+static const std::unordered_set<juce::String>& getSupportedExtensions()
+{
+    static const auto extensions = [] {
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+        std::unordered_set<juce::String> result;
+
+        for (int index = 0; index < formatManager.getNumKnownFormats(); ++index) {
+            for (const auto& extension : formatManager.getKnownFormat(index)->getFileExtensions()) {
+                result.insert(extension.trimCharactersAtStart(".").toLowerCase());
+            }
+        }
+
+        return result;
+    }();
+
+    return extensions;
+}
 }  // namespace audiobatch::analysis
 
 using namespace audiobatch::analysis;
 
+/// Buffers and measurements for analyzing one file at a time.
+/// Once they have grown to fit, a worker analyzing many short files allocates none of them again.
+/// libebur128 has no way to reset a state, so the analyzer state is still created per file.
+struct AudioAnalysisContext::Buffers {
+    BlockFeeder feeder;
+    RangeMeasurement measurement;
+    DecodedBlockQueue decodeQueue;
+};
+
+AudioAnalysisContext::AudioAnalysisContext() :
+    buffers(std::make_unique<Buffers>())
+{ }
+
+AudioAnalysisContext::~AudioAnalysisContext() = default;
+
+void AudioAnalysisContext::setSegmentScheduler(JobScheduler scheduler, const int maximumSegments)
+{
+    segmentScheduler = std::move(scheduler);
+    segmentLimit = segmentScheduler != nullptr ? juce::jmax(1, maximumSegments) : 1;
+}
+
+void AudioAnalysisContext::setDecodeScheduler(JobScheduler scheduler)
+{
+    decodeScheduler = std::move(scheduler);
+}
+
 juce::AudioFormatManager& AudioAnalysisService::getThreadLocalFormatManager()
 {
     thread_local juce::AudioFormatManager formatManager;
@@ -325,18 +1124,76 @@ juce::AudioFormatManager& AudioAnalysisService::getThreadLocalFormatManager()
 
 bool AudioAnalysisService::isSupportedAudioFile(const juce::File& file)
 {
-    if (!file.existsAsFile()) {
-        return false;
+    return file.existsAsFile() && hasSupportedExtension(file);
+}
+
+bool AudioAnalysisService::hasSupportedExtension(const juce::File& file)
+{
+    return getSupportedExtensions().contains(normalizedExtension(file));
+}
+
+std::unique_ptr<juce::AudioFormatReader> AudioAnalysisService::createReader(
+    juce::AudioFormatManager& formatManager,
+    const juce::File& file,
+    const AudioIoSettings& settings
+)
+{
+    if (auto* format = formatManager.findFormatForFileExtension(normalizedExtension(file));
+        format != nullptr && settings.useMemoryMapping)
+    {
+        // Mapped PCM data is decoded straight from the page cache,
+        // skipping the buffered stream reads and copies of a streamed reader.
+        if (std::unique_ptr<juce::MemoryMappedAudioFormatReader> mappedReader(format->createMemoryMappedReader(file));
+            mappedReader != nullptr && mappedReader->mapEntireFile())
+        {
+            return mappedReader;
+        }
     }
 
-    const auto& formatManager = getThreadLocalFormatManager();
-    auto extension = file.getFileExtension();
+    if (settings.readaheadBytes > 0) {
+        if (auto input = file.createInputStream(); input != nullptr) {
+            return std::unique_ptr<juce::AudioFormatReader>(formatManager.createReaderFor(
+                std::make_unique<juce::BufferedInputStream>(input.release(), settings.readaheadBytes, true)
+            ));
+        }
+    }
 
-    if (extension.startsWithChar('.')) {
-        extension = extension.substring(1);
+    return std::unique_ptr<juce::AudioFormatReader>(formatManager.createReaderFor(file));
+}
+
+std::unique_ptr<juce::AudioFormatReader> AudioAnalysisService::createReader(
+    juce::AudioFormatManager& formatManager,
+    const juce::MemoryBlock& fileData
+)
+{
+    return std::unique_ptr<juce::AudioFormatReader>(
+        formatManager.createReaderFor(std::make_unique<juce::MemoryInputStream>(fileData, false))
+    );
+}
+
+void AudioAnalysisService::setIoTuning(const AudioIoTuning& tuning)
+{
+    auto sanitizedTuning = tuning;
+    sanitizedTuning.defaults = tuning.defaults.sanitized();
+
+    for (auto& [extension, settings] : sanitizedTuning.formatOverrides) {
+        settings = settings.sanitized();
     }
 
-    return extension.isNotEmpty() && formatManager.findFormatForFileExtension(extension) != nullptr;
+    const juce::ScopedLock lock(getIoTuningLock());
+    getIoTuningStorage() = std::move(sanitizedTuning);
+}
+
+AudioIoTuning AudioAnalysisService::getIoTuning()
+{
+    const juce::ScopedLock lock(getIoTuningLock());
+    return getIoTuningStorage();
+}
+
+AudioIoSettings AudioAnalysisService::getIoSettings(const juce::File& file)
+{
+    const juce::ScopedLock lock(getIoTuningLock());
+    return getIoTuningStorage().forFile(file);
 }
 
 juce::Array<juce::File> AudioAnalysisService::collectInputFiles(
@@ -345,51 +1202,62 @@ juce::Array<juce::File> AudioAnalysisService::collectInputFiles(
 )
 {
     juce::Array<juce::File> files;
-    std::set<juce::String> seenPaths;
-
-    auto addFile = [&](const juce::File& file) {
-        if (!isSupportedAudioFile(file)) {
-            return;
-        }
-
-        if (const auto normalizedPath = file.getFullPathName(); seenPaths.insert(normalizedPath).second) {
-            files.add(file);
-        }
-    };
-
-    for (const auto& inputPath : inputPaths) {
-        if (inputPath.isDirectory()) {
-            juce::Array<juce::File> discoveredFiles;
-            inputPath.findChildFiles(discoveredFiles, juce::File::findFiles, recursive, "*");
-
-            for (const auto& file : discoveredFiles) {
-                addFile(file);
-            }
-        } else {
-            addFile(inputPath);
+    DirectoryScanner::scan(inputPaths, recursive, [&files](const std::vector<AudioFileInfo>& batch) {
+        for (const auto& fileInfo : batch) {
+            files.add(fileInfo.file);
         }
-    }
-
-    std::ranges::sort(files, [](const juce::File& lhs, const juce::File& rhs) {
-        return lhs.getFullPathName().compareNatural(rhs.getFullPathName()) < 0;
     });
-
     return files;
 }
 
-AudioAnalysisRecord AudioAnalysisService::analyzeFile(const juce::File& file)
+AudioAnalysisRecord AudioAnalysisService::analyzeFile(
+    const juce::File& file,
+    const AudioAnalysisProfile profile,
+    const std::optional<float> stopAtPeakDb
+)
 {
-    auto record = AudioAnalysisRecord::fromFile(file);
+    return analyzeFile(file, getIoSettings(file), profile, stopAtPeakDb);
+}
 
-    if (!file.existsAsFile()) {
-        return failAnalysis(std::move(record), "File does not exist");
-    }
+AudioAnalysisRecord AudioAnalysisService::analyzeFile(
+    const juce::File& file,
+    const AudioIoSettings& ioSettings,
+    const AudioAnalysisProfile profile,
+    const std::optional<float> stopAtPeakDb
+)
+{
+    AudioAnalysisContext context;
+    return analyzeFile(AudioFileInfo::fromFile(file), ioSettings, context, profile, stopAtPeakDb);
+}
+
+AudioAnalysisRecord AudioAnalysisService::analyzeFile(
+    const AudioFileInfo& fileInfo,
+    const AudioIoSettings& requestedIoSettings,
+    AudioAnalysisContext& context,
+    const AudioAnalysisProfile profile,
+    const std::optional<float> stopAtPeakDb,
+    const juce::MemoryBlock* fileData
+)
+{
+    const auto& file = fileInfo.file;
+    const auto ioSettings = requestedIoSettings.sanitized();
+    const auto loudnessMode = loudnessModeForProfile(profile);
+    auto record = AudioAnalysisRecord::fromFileInfo(fileInfo);
+    record.profile = profile;
+
+    // Segment readers are opened on the segment threads, so the format manager is looked up on each call.
+    const auto openReader = [&file, &ioSettings, fileData] {
+        return fileData != nullptr ? createReader(getThreadLocalFormatManager(), *fileData)
+                                   : createReader(getThreadLocalFormatManager(), file, ioSettings);
+    };
 
-    auto& formatManager = getThreadLocalFormatManager();
-    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+    const auto reader = openReader();
 
     if (reader == nullptr) {
-        return failAnalysis(std::move(record), "Unsupported or unreadable audio file");
+        // Only a failed open looks at the file system, to tell a vanished file from an unreadable one.
+        return failAnalysis(
+            std::move(record), file.existsAsFile() ? "Unsupported or unreadable audio file" : "File does not exist"
+        );
     }
 
     const auto channelCount = static_cast<int>(reader->numChannels);
@@ -399,116 +1267,184 @@ AudioAnalysisRecord AudioAnalysisService::analyzeFile(const juce::File& file)
         return failAnalysis(std::move(record), "Unsupported audio stream parameters");
     }
 
-    auto loudnessState = createLoudnessState(channelCount, sampleRate);
-
-    if (loudnessState == nullptr) {
-        return failAnalysis(std::move(record), "Could not initialize loudness analyzer");
+    auto& measurement = context.buffers->measurement;
+    measurement.reset(channelCount);
+    double integratedLoudness = AudioAnalysisRecord::negativeInfinityLoudness;
+    bool analyzedInSegments = false;
+
+    // Stopping at a peak level only saves work when the file is read from the start, so such runs are never split.
+    const auto segments = stopAtPeakDb.has_value()
+        ? std::vector<AnalysisSegment> {{0, reader->lengthInSamples}}
+        : planSegments(file, reader->lengthInSamples, sampleRate, context.segmentLimit);
+
+    if (segments.size() > 1) {
+        utils::logDebug("Analyzing {} in {} segments", record.fullPath.quoted(), segments.size());
+
+        analyzedInSegments = analyzeSegmented(
+            openReader,
+            segments,
+            context.segmentScheduler,
+            channelCount,
+            sampleRate,
+            ioSettings.analysisBlockSize,
+            profile,
+            measurement,
+            integratedLoudness
+        );
+
+        if (!analyzedInSegments) {
+            utils::logWarn("Segmented analysis failed for {}, analyzing sequentially", record.fullPath.quoted());
+            measurement.reset(channelCount);
+        }
     }
 
-    std::vector minSamples(static_cast<size_t>(channelCount), 0.0f);
-    std::vector maxSamples(static_cast<size_t>(channelCount), 0.0f);
-    juce::AudioBuffer<float> readBuffer(channelCount, analysisBlockSize);
-    std::vector interleaved(static_cast<size_t>(channelCount * analysisBlockSize), 0.0f);
-    double maxShortTermLoudness = AudioAnalysisRecord::negativeInfinityLoudness;
-    std::int64_t framesDecoded = 0;
-    int consecutiveReadFailures = 0;
-    bool reportedPartialDecode = false;
-
-    for (std::int64_t samplePosition = 0; samplePosition < reader->lengthInSamples; samplePosition += analysisBlockSize)
-    {
-        const auto remainingFrames = reader->lengthInSamples - samplePosition;
-        const auto framesThisBlock = static_cast<int>(juce::jmin<std::int64_t>(analysisBlockSize, remainingFrames));
+    if (!analyzedInSegments) {
+        EbuR128StatePtr loudnessState;
 
-        readBuffer.clear();
+        if (loudnessMode != 0) {
+            loudnessState = createLoudnessState(channelCount, sampleRate, loudnessMode);
 
-        if (const auto readSucceeded = reader->read(&readBuffer, 0, framesThisBlock, samplePosition, true, true);
-            readSucceeded)
-        {
-            consecutiveReadFailures = 0;
-            framesDecoded += framesThisBlock;
-        } else if (!isEndOfFileReadFailure(readSucceeded, samplePosition, framesThisBlock, reader->lengthInSamples)) {
-            // JUCE's built-in MP3 decoder can fail mid-stream (frame sync errors, overestimated stream length)
-            // on files that other decoders handle fine.
-            // A failed block still holds the samples decoded before the error with the remainder zeroed,
-            // so keep analyzing instead of discarding the whole file.
-            ++consecutiveReadFailures;
-
-            if (!reportedPartialDecode) {
-                utils::logWarn(
-                    "Audio decode failed at sample {} / {} for {}, continuing analysis with decoded audio",
-                    samplePosition,
-                    reader->lengthInSamples,
-                    record.fullPath.quoted()
-                );
-                reportedPartialDecode = true;
+            if (loudnessState == nullptr) {
+                return failAnalysis(std::move(record), "Could not initialize loudness analyzer");
             }
         }
 
-        for (int frame = 0; frame < framesThisBlock; ++frame) {
-            for (int channel = 0; channel < channelCount; ++channel) {
-                const auto sample = readBuffer.getSample(channel, frame);
-                minSamples[static_cast<size_t>(channel)] = std::min(minSamples[static_cast<size_t>(channel)], sample);
-                maxSamples[static_cast<size_t>(channel)] = std::max(maxSamples[static_cast<size_t>(channel)], sample);
-                interleaved[static_cast<size_t>(frame * channelCount + channel)] = sample;
+        const auto blockSize = ioSettings.analysisBlockSize;
+        auto& feeder = context.buffers->feeder;
+        feeder.prepare(channelCount, blockSize, sampleRate, measuresTruePeak(profile));
+        const auto stopAtPeakGain = stopAtPeakDb.transform([](const float levelDb) {
+            return juce::Decibels::decibelsToGain(levelDb);
+        });
+        std::int64_t framesDecoded = 0;
+        int consecutiveReadFailures = 0;
+        bool reportedPartialDecode = false;
+        bool loudnessFailed = false;
+
+        // Measures one decoded block, and returns false once the rest of the file is not to be analyzed.
+        const auto analyzeBlock = [&](const juce::AudioBuffer<float>& block,
+                                      const std::int64_t samplePosition,
+                                      const int framesThisBlock,
+                                      const bool readSucceeded) {
+            if (readSucceeded) {
+                consecutiveReadFailures = 0;
+                framesDecoded += framesThisBlock;
+            } else if (!isEndOfFileReadFailure(
+                           readSucceeded, samplePosition, framesThisBlock, reader->lengthInSamples
+                       ))
+            {
+                // JUCE's built-in MP3 decoder can fail mid-stream (frame sync errors, overestimated stream length)
+                // on files that other decoders handle fine.
+                // A failed block still holds the samples decoded before the error with the remainder zeroed,
+                // so keep analyzing instead of discarding the whole file.
+                ++consecutiveReadFailures;
+
+                if (!reportedPartialDecode) {
+                    utils::logWarn(
+                        "Audio decode failed at sample {} / {} for {}, continuing analysis with decoded audio",
+                        samplePosition,
+                        reader->lengthInSamples,
+                        record.fullPath.quoted()
+                    );
+                    reportedPartialDecode = true;
+                }
             }
-        }
 
-        if (ebur128_add_frames_float(loudnessState.get(), interleaved.data(), static_cast<size_t>(framesThisBlock))
-            != EBUR128_SUCCESS)
+            if (!feeder.addBlock(block, loudnessState.get(), samplePosition, framesThisBlock, measurement)) {
+                loudnessFailed = true;
+                return false;
+            }
+
+            if (consecutiveReadFailures >= maxConsecutiveReadFailures) {
+                // Repeated failures mean the rest of the stream is undecodable,
+                // so finish the analysis with the audio decoded so far.
+                return false;
+            }
+
+            if (stopAtPeakGain.has_value() && reachesPeakLevel(measurement, *stopAtPeakGain)) {
+                record.isComplete = samplePosition + framesThisBlock >= reader->lengthInSamples;
+                return false;
+            }
+
+            return true;
+        };
+
+        // Mapped PCM is converted straight from the page cache, where a second thread would only add a copy.
+        // Other readers decode or wait on storage, so a decode job runs ahead of the analysis when one can be started.
+        if (context.decodeScheduler != nullptr
+            && dynamic_cast<juce::MemoryMappedAudioFormatReader*>(reader.get()) == nullptr)
         {
-            return failAnalysis(std::move(record), "Loudness analysis failed while processing audio");
+            auto& queue = context.buffers->decodeQueue;
+            queue.prepare(channelCount, blockSize);
+            context.decodeScheduler([&decodedReader = *reader, &queue, blockSize] {
+                decodeIntoQueue(decodedReader, queue, blockSize);
+            });
+
+            while (const auto* block = queue.beginRead()) {
+                const auto keepAnalyzing
+                    = analyzeBlock(block->buffer, block->startFrame, block->numFrames, block->readSucceeded);
+                queue.endRead();
+
+                if (!keepAnalyzing) {
+                    queue.close();
+                    break;
+                }
+            }
+        } else {
+            for (std::int64_t samplePosition = 0; samplePosition < reader->lengthInSamples;
+                 samplePosition += blockSize)
+            {
+                const auto remainingFrames = reader->lengthInSamples - samplePosition;
+                const auto framesThisBlock = static_cast<int>(juce::jmin<std::int64_t>(blockSize, remainingFrames));
+
+                feeder.readBuffer.clear();
+                const auto readSucceeded
+                    = reader->read(&feeder.readBuffer, 0, framesThisBlock, samplePosition, true, true);
+
+                if (!analyzeBlock(feeder.readBuffer, samplePosition, framesThisBlock, readSucceeded)) {
+                    break;
+                }
+            }
         }
 
-        double shortTermLoudness = AudioAnalysisRecord::negativeInfinityLoudness;
-
-        if (ebur128_loudness_shortterm(loudnessState.get(), &shortTermLoudness) == EBUR128_SUCCESS) {
-            maxShortTermLoudness = std::max(maxShortTermLoudness, normalizeLoudness(shortTermLoudness));
+        if (loudnessFailed) {
+            return failAnalysis(std::move(record), "Loudness analysis failed while processing audio");
         }
 
-        if (consecutiveReadFailures >= maxConsecutiveReadFailures) {
-            // Repeated failures mean the rest of the stream is undecodable,
-            // so finish the analysis with the audio decoded so far.
-            break;
+        if (reportedPartialDecode && framesDecoded == 0) {
+            return failAnalysis(std::move(record), "Audio decode failed during analysis");
         }
-    }
 
-    if (reportedPartialDecode && framesDecoded == 0) {
-        return failAnalysis(std::move(record), "Audio decode failed during analysis");
+        if (loudnessState != nullptr && record.isComplete
+            && ebur128_loudness_global(loudnessState.get(), &integratedLoudness) != EBUR128_SUCCESS)
+        {
+            return failAnalysis(std::move(record), "Integrated loudness analysis failed");
+        }
     }
 
-    std::vector signedPeaks(static_cast<size_t>(channelCount), 0.0f);
-
-    for (int channel = 0; channel < channelCount; ++channel) {
-        signedPeaks[static_cast<size_t>(channel)]
-            = signedPeakFromExtrema(minSamples[static_cast<size_t>(channel)], maxSamples[static_cast<size_t>(channel)]);
-    }
+    const auto signedPeak = [&measurement](const int channel) {
+        return signedPeakFromExtrema(
+            measurement.minSamples[static_cast<size_t>(channel)], measurement.maxSamples[static_cast<size_t>(channel)]
+        );
+    };
 
-    const auto leftPeak = signedPeaks.front();
-    const auto rightPeak = channelCount > 1 ? signedPeaks[1] : leftPeak;
+    const auto leftPeak = signedPeak(0);
+    const auto rightPeak = channelCount > 1 ? signedPeak(1) : leftPeak;
     auto overallPeak = leftPeak;
 
     for (int channel = 1; channel < channelCount; ++channel) {
-        overallPeak = dominantPeak(overallPeak, signedPeaks[static_cast<size_t>(channel)]);
+        overallPeak = dominantPeak(overallPeak, signedPeak(channel));
     }
 
-    std::vector truePeaks(static_cast<size_t>(channelCount), 0.0);
+    auto& truePeaks = measurement.truePeaks;
 
-    for (int channel = 0; channel < channelCount; ++channel) {
-        if (ebur128_true_peak(
-                loudnessState.get(), static_cast<unsigned int>(channel), &truePeaks[static_cast<size_t>(channel)]
-            )
-            != EBUR128_SUCCESS)
-        {
-            return failAnalysis(std::move(record), "True peak analysis failed");
+    if (measuresTruePeak(profile)) {
+        // The interpolated output lags the input, so fold in the sample peak like libebur128 does.
+        for (int channel = 0; channel < channelCount; ++channel) {
+            const auto samplePeak = static_cast<double>(peakMagnitude(signedPeak(channel)));
+            truePeaks[static_cast<size_t>(channel)] = std::max(truePeaks[static_cast<size_t>(channel)], samplePeak);
         }
     }
 
-    double integratedLoudness = AudioAnalysisRecord::negativeInfinityLoudness;
-
-    if (ebur128_loudness_global(loudnessState.get(), &integratedLoudness) != EBUR128_SUCCESS) {
-        return failAnalysis(std::move(record), "Integrated loudness analysis failed");
-    }
-
     const auto truePeakLeft = truePeaks.front();
     const auto truePeakRight = channelCount > 1 ? truePeaks[1] : truePeakLeft;
     auto overallTruePeak = truePeakLeft;
@@ -530,13 +1466,45 @@ AudioAnalysisRecord AudioAnalysisService::analyzeFile(const juce::File& file)
     record.truePeakLeft = truePeakLeft;
     record.truePeakRight = truePeakRight;
     record.overallTruePeak = overallTruePeak;
-    record.maxShortTermLufs = maxShortTermLoudness;
-    record.integratedLufs = normalizeLoudness(integratedLoudness);
+
+    if (record.isComplete) {
+        record.maxShortTermLufs = measurement.shortTerm.getMaxLoudness();
+        record.integratedLufs = normalizeLoudness(integratedLoudness);
+    }
+
     record.status = AudioAnalysisStatus::analyzed;
     record.fromCache = false;
     return record;
 }
 
+juce::String AudioAnalysisService::getProfileName(const AudioAnalysisProfile profile)
+{
+    switch (profile) {
+        case AudioAnalysisProfile::peakOnly:
+            return "peak-only";
+        case AudioAnalysisProfile::peakAndLoudness:
+            return "peak+loudness";
+        case AudioAnalysisProfile::full:
+        default:
+            return "full";
+    }
+}
+
+std::optional<AudioAnalysisProfile> AudioAnalysisService::parseProfileName(const juce::String& name)
+{
+    const auto normalizedName = name.trim().toLowerCase();
+
+    for (const auto profile :
+         {AudioAnalysisProfile::peakOnly, AudioAnalysisProfile::peakAndLoudness, AudioAnalysisProfile::full})
+    {
+        if (normalizedName == getProfileName(profile)) {
+            return profile;
+        }
+    }
+
+    return std::nullopt;
+}
+
 juce::String AudioAnalysisService::formatPeakDisplay(const float peak)
 {
     return formatAmplitudeDisplay(peakMagnitude(peak), " dBFS");
@@ -7,18 +7,132 @@
 
 #include "AudioAnalysisTypes.h"
 
+#include <functional>
+#include <memory>
+#include <optional>
 #include <vector>
 
+/// Buffers that one worker reuses for every file it analyzes, so they are allocated once per worker
+/// instead of once per file. The owner, such as an AnalysisCoordinator worker, passes it to analyzeFile,
+/// and only one analysis may use it at a time.
+class AudioAnalysisContext
+{
+public:
+    /// Runs a job later on another thread, such as a thread of the owner's pool.
+    using JobScheduler = std::function<void(std::function<void()>)>;
+
+    AudioAnalysisContext();
+    ~AudioAnalysisContext();
+
+    /// Lets analyses split long files into at most maximumSegments segments.
+    /// The analyzing thread hands a helper job per extra segment to the scheduler and then claims segments itself,
+    /// so a helper only analyzes a segment when a pool thread picks it up before the analyzing thread gets there.
+    /// A helper that starts late finds every segment claimed and returns at once.
+    /// Without a scheduler, which is the default, every file is analyzed sequentially.
+    void setSegmentScheduler(JobScheduler scheduler, int maximumSegments);
+
+    /// Lets analyses decode on a separate job that runs a few blocks ahead of the measurements,
+    /// so waiting on storage and decoding compressed audio overlap with the analysis.
+    /// Memory-mapped readers are always read on the analyzing thread.
+    /// The analysis waits for the job, so the scheduler must start every job it is given without waiting
+    /// for other analyses, for example on a pool with a thread for each context that uses it.
+    /// A job may still be returning when the analysis does, so the context must be destroyed only after
+    /// the scheduler's jobs have finished.
+    void setDecodeScheduler(JobScheduler scheduler);
+
+private:
+    friend class AudioAnalysisService;
+
+    /// Read, interleave, and measurement buffers, defined with the analysis code.
+    struct Buffers;
+    std::unique_ptr<Buffers> buffers;
+    JobScheduler segmentScheduler;
+    int segmentLimit = 1;
+    JobScheduler decodeScheduler;
+
+    JUCE_DECLARE_NON_COPYABLE(AudioAnalysisContext)
+};
+
 /// Stateless helpers for file discovery, audio analysis, and result formatting.
 class AudioAnalysisService
 {
 public:
     /// Analyzes a single supported audio file and returns the populated result record.
-    static AudioAnalysisRecord analyzeFile(const juce::File& file);
-
-    /// Expands the input paths into a de-duplicated list of supported files.
+    /// Uses the current I/O settings for the file's format and buffers allocated for this call.
+    /// Values the profile does not measure keep their defaults.
+    ///
+    /// With stopAtPeakDb set, the file is read sequentially and decoding stops after the first block
+    /// whose sample peak reaches that level. The record is then marked incomplete:
+    /// its peaks cover only the decoded audio and its loudness is left unmeasured.
+    static AudioAnalysisRecord analyzeFile(
+        const juce::File& file,
+        AudioAnalysisProfile profile = AudioAnalysisProfile::full,
+        std::optional<float> stopAtPeakDb = std::nullopt
+    );
+
+    /// Analyzes a single supported audio file with explicit I/O settings.
+    static AudioAnalysisRecord analyzeFile(
+        const juce::File& file,
+        const AudioIoSettings& ioSettings,
+        AudioAnalysisProfile profile = AudioAnalysisProfile::full,
+        std::optional<float> stopAtPeakDb = std::nullopt
+    );
+
+    /// Analyzes a file found by directory discovery with explicit I/O settings and the caller's buffers.
+    /// The record takes its size and modification time from the listing instead of reading them again.
+    /// When fileData holds the file's bytes, read ahead by the caller, the file is decoded from memory
+    /// and not opened again.
+    ///
+    /// Once the context's buffers have grown to fit, the analysis itself does not allocate per block,
+    /// so the allocations per file do not depend on the file's length.
+    /// What remains per file is opening the reader, the record's strings, and the libebur128 state,
+    /// which has no way to be reset and adds a node to its gating history for every 100 ms of audio.
+    static AudioAnalysisRecord analyzeFile(
+        const AudioFileInfo& fileInfo,
+        const AudioIoSettings& ioSettings,
+        AudioAnalysisContext& context,
+        AudioAnalysisProfile profile = AudioAnalysisProfile::full,
+        std::optional<float> stopAtPeakDb = std::nullopt,
+        const juce::MemoryBlock* fileData = nullptr
+    );
+
+    /// Opens a reader for the file with the given format manager.
+    /// Uses a memory-mapped reader when enabled and the file's format supports one, as WAV and AIFF do,
+    /// and falls back to a streamed reader, buffered by the readahead setting,
+    /// for other formats or when the file cannot be mapped.
+    static std::unique_ptr<juce::AudioFormatReader> createReader(
+        juce::AudioFormatManager& formatManager,
+        const juce::File& file,
+        const AudioIoSettings& settings = {}
+    );
+
+    /// Opens a reader over the file's bytes already read into memory.
+    /// The reader refers to fileData, which must outlive it.
+    static std::unique_ptr<juce::AudioFormatReader> createReader(
+        juce::AudioFormatManager& formatManager,
+        const juce::MemoryBlock& fileData
+    );
+
+    /// Replaces the process-wide I/O tuning used by the analysis, normalization, and plugin processing services.
+    /// Out of range values are clamped.
+    static void setIoTuning(const AudioIoTuning& tuning);
+
+    /// Returns a copy of the current process-wide I/O tuning.
+    static AudioIoTuning getIoTuning();
+
+    /// Returns the current I/O settings for the given file's format.
+    static AudioIoSettings getIoSettings(const juce::File& file);
+
+    /// Expands the input paths into a de-duplicated list of supported files, in discovery order.
+    /// Directories are listed in parallel, so callers that show or report the files sort them first.
     static juce::Array<juce::File> collectInputFiles(const juce::Array<juce::File>& inputPaths, bool recursive);
 
+    /// Returns the name used for the profile on the command line and in the settings file.
+    static juce::String getProfileName(AudioAnalysisProfile profile);
+
+    /// Parses a profile name as returned by getProfileName, ignoring case and surrounding whitespace.
+    static std::optional<AudioAnalysisProfile> parseProfileName(const juce::String& name);
+
     /// Formats a peak value for display in the GUI and CLI.
     static juce::String formatPeakDisplay(float peak);
 
@@ -55,6 +169,10 @@ public:
     /// Returns true when the path is a supported audio file for analysis.
     static bool isSupportedAudioFile(const juce::File& file);
 
+    /// Returns true when the file name has an extension of a supported audio format.
+    /// Looks at the name only, so directory listings can filter entries without touching the file system.
+    static bool hasSupportedExtension(const juce::File& file);
+
     /// Sorts records by the requested field and direction.
     static void sortRecords(std::vector<AudioAnalysisRecord>& records, AudioAnalysisSortMode sortMode, bool ascending);
 
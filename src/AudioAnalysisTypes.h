@@ -1,12 +1,16 @@
 /// Shared data types for the audio analysis pipeline.
 /// Defines AudioAnalysisRecord, which carries per-file peak, true peak, and loudness results,
-/// along with the AudioAnalysisStatus and AudioAnalysisSortMode enums
-/// and the AudioAnalysisOptions input parameters used by both the GUI and CLI flows.
+/// along with the AudioAnalysisStatus, AudioAnalysisSortMode, AudioAnalysisProfile, and AudioFingerprintMode enums,
+/// the AudioAnalysisOptions input parameters used by both the GUI and CLI flows,
+/// and the AudioIoSettings block size and readahead tuning shared by the file services.
 
 #pragma once
 
 #include <JuceHeader.h>
 
+#include <map>
+#include <optional>
+
 /// Lifecycle states for a file analysis record.
 enum class AudioAnalysisStatus {
     pending = 0,
@@ -23,11 +27,108 @@ enum class AudioAnalysisSortMode {
     loudness,
 };
 
+/// Measurements to run for each file, ordered from the cheapest to the most complete.
+/// The values are stored in the analysis cache, so existing values must not change.
+enum class AudioAnalysisProfile {
+    /// Sample peak only.
+    peakOnly = 0,
+    /// Sample peak plus integrated and maximum short-term loudness.
+    peakAndLoudness = 1,
+    /// Everything, including the oversampled true peak.
+    full = 2,
+};
+
+/// How much of a file's contents AnalysisCache fingerprints to recognize it after a move or rename.
+enum class AudioFingerprintMode {
+    /// No fingerprint; cached results are found by path only.
+    none,
+    /// The file size plus the first and last 64 KiB.
+    /// Blind to edits in the middle of a file, so it only recognizes files whose previous path is gone.
+    fast,
+    /// Every byte of the file. Also recognizes copies and files with only a new modification time.
+    full,
+};
+
 /// Input parameters shared by the GUI and CLI analysis flows.
 struct AudioAnalysisOptions {
     juce::Array<juce::File> inputPaths;
     bool recursive = false;
     bool refresh = false;
+    AudioAnalysisProfile profile = AudioAnalysisProfile::full;
+    /// When set, decoding of a file stops at the first block whose sample peak reaches this level in dBFS,
+    /// which answers "does it reach the level?" without reading the rest of the file.
+    std::optional<float> stopAtPeakDb;
+    /// Fingerprint stored with each analyzed file and used to find files moved or renamed since.
+    AudioFingerprintMode fingerprintMode = AudioFingerprintMode::fast;
+};
+
+/// Block sizes and readahead used when reading audio files.
+/// Compressed and PCM formats favour different settings, especially on network storage,
+/// so these can be tuned per format through AudioIoTuning.
+struct AudioIoSettings {
+    static constexpr int defaultAnalysisBlockSize = 8192;
+    static constexpr int defaultNormalizationBlockSize = 32768;
+    static constexpr int defaultProcessingBlockSize = 1024;
+    static constexpr int minimumBlockSize = 256;
+    static constexpr int maximumBlockSize = 1 << 20;
+    static constexpr int maximumReadaheadBytes = 64 << 20;
+
+    /// Frames decoded per block by AudioAnalysisService.
+    int analysisBlockSize = defaultAnalysisBlockSize;
+    /// Frames read and written per block by AudioNormalizationService.
+    int normalizationBlockSize = defaultNormalizationBlockSize;
+    /// Frames per block passed through the plugin chain by PluginProcessingService.
+    int processingBlockSize = defaultProcessingBlockSize;
+    /// Size of the buffer placed in front of streamed readers, or 0 to read the file stream directly.
+    int readaheadBytes = 0;
+    /// Reads uncompressed formats through memory-mapped readers when true.
+    bool useMemoryMapping = true;
+
+    bool operator==(const AudioIoSettings&) const = default;
+
+    /// Returns a copy with every value clamped to its supported range.
+    [[nodiscard]] AudioIoSettings sanitized() const
+    {
+        auto settings = *this;
+        settings.analysisBlockSize = juce::jlimit(minimumBlockSize, maximumBlockSize, analysisBlockSize);
+        settings.normalizationBlockSize = juce::jlimit(minimumBlockSize, maximumBlockSize, normalizationBlockSize);
+        settings.processingBlockSize = juce::jlimit(minimumBlockSize, maximumBlockSize, processingBlockSize);
+        settings.readaheadBytes = juce::jlimit(0, maximumReadaheadBytes, readaheadBytes);
+        return settings;
+    }
+};
+
+/// Default I/O settings with optional overrides keyed by lowercase file extension without the dot.
+struct AudioIoTuning {
+    AudioIoSettings defaults;
+    std::map<juce::String, AudioIoSettings> formatOverrides;
+
+    /// Returns the settings that apply to the given file.
+    [[nodiscard]] const AudioIoSettings& forFile(const juce::File& file) const
+    {
+        const auto extension = file.getFileExtension().trimCharactersAtStart(".").toLowerCase();
+
+        if (const auto found = formatOverrides.find(extension); found != formatOverrides.end()) {
+            return found->second;
+        }
+
+        return defaults;
+    }
+};
+
+/// An audio file with the size and modification time its directory listing reported.
+/// File discovery passes these on to the cache lookup and to analysis, so later stages do not stat the file again.
+struct AudioFileInfo {
+    juce::File file;
+    std::int64_t fileSize = 0;
+    std::int64_t modifiedTimeMs = 0;
+
+    /// Reads the metadata of a file that did not come from a directory listing.
+    /// A missing file gets zero size and modification time.
+    static AudioFileInfo fromFile(const juce::File& file)
+    {
+        return {file, file.getSize(), file.getLastModificationTime().toMilliseconds()};
+    }
 };
 
 /// Analysis metadata and derived peak information for a single audio file.
@@ -39,6 +140,8 @@ struct AudioAnalysisRecord {
     juce::String fullPath;
     juce::String formatName;
     juce::String errorMessage;
+    /// Content fingerprint from FileFingerprint, or empty when none was computed.
+    juce::String fingerprint;
     std::int64_t fileSize = 0;
     std::int64_t modifiedTimeMs = 0;
     std::int64_t lengthInSamples = 0;
@@ -57,6 +160,10 @@ struct AudioAnalysisRecord {
     float customGainDb = 0.0f;
     bool hasCustomGain = false;
     AudioAnalysisStatus status = AudioAnalysisStatus::pending;
+    AudioAnalysisProfile profile = AudioAnalysisProfile::full;
+    /// False when decoding stopped at the stop-at-peak level before the end of the file.
+    /// The peaks of an incomplete record are lower bounds, and its loudness was not measured.
+    bool isComplete = true;
     bool fromCache = false;
 
     /// Returns true when the record represents a failed analysis attempt.
@@ -71,15 +178,45 @@ struct AudioAnalysisRecord {
         return status == AudioAnalysisStatus::cached || status == AudioAnalysisStatus::analyzed;
     }
 
+    /// Returns true when the profile that produced the record measured loudness over the whole file.
+    [[nodiscard]] bool hasLoudness() const noexcept
+    {
+        return isComplete && profile != AudioAnalysisProfile::peakOnly;
+    }
+
+    /// Returns true when the profile that produced the record measured true peak.
+    [[nodiscard]] bool hasTruePeak() const noexcept
+    {
+        return profile == AudioAnalysisProfile::full;
+    }
+
+    /// Returns true when the record holds everything the requested profile measures.
+    [[nodiscard]] bool coversProfile(const AudioAnalysisProfile requested) const noexcept
+    {
+        return static_cast<int>(profile) >= static_cast<int>(requested);
+    }
+
+    /// Returns true when the sample peak reaches the level in dBFS.
+    [[nodiscard]] bool reachesPeakLevel(const float levelDb) const
+    {
+        return std::abs(overallPeak) >= juce::Decibels::decibelsToGain(levelDb);
+    }
+
     /// Builds a baseline record from filesystem metadata before analysis begins.
     static AudioAnalysisRecord fromFile(const juce::File& file)
+    {
+        return fromFileInfo(AudioFileInfo::fromFile(file));
+    }
+
+    /// Builds a baseline record from metadata that is already known, without touching the file system.
+    static AudioAnalysisRecord fromFileInfo(const AudioFileInfo& fileInfo)
     {
         AudioAnalysisRecord record;
-        record.file = file;
-        record.fileName = file.getFileName();
-        record.fullPath = file.getFullPathName();
-        record.fileSize = file.exists() ? file.getSize() : 0;
-        record.modifiedTimeMs = file.exists() ? file.getLastModificationTime().toMilliseconds() : 0;
+        record.file = fileInfo.file;
+        record.fileName = fileInfo.file.getFileName();
+        record.fullPath = fileInfo.file.getFullPathName();
+        record.fileSize = fileInfo.fileSize;
+        record.modifiedTimeMs = fileInfo.modifiedTimeMs;
         return record;
     }
 };
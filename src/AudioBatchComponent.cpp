@@ -7,6 +7,7 @@
 #include "AudioBatchComponent.h"
 
 #include "AudioAnalysisService.h"
+#include "AudioIoCalibration.h"
 #include "CustomLookAndFeel.h"
 #include "PluginProcessingService.h"
 #include "utils.h"
@@ -139,6 +140,8 @@ namespace audiobatch::gui
 {
 constexpr auto supportedAudioFilePatterns = "*.wav;*.aif;*.aiff;*.flac;*.mp3";
 constexpr int activityIndicatorTimerHz = 24;
+constexpr auto analysisProfileSettingsKey = "analysisProfile";
+constexpr auto waveformCacheBudgetSettingsKey = "waveformCacheBudgetMiB";
 constexpr int nameColumnMinimumWidth = AudioFileTableModel::minimumColumnWidth(AudioFileTableModel::columnName);
 constexpr int pathColumnMinimumWidth = AudioFileTableModel::minimumColumnWidth(AudioFileTableModel::columnPath);
 
@@ -155,6 +158,7 @@ enum FileMenuItemId {
     moveToTrashMenuItemId,
     removeFromListMenuItemId,
     reanalyzeMenuItemId,
+    calibrateIoMenuItemId,
 };
 
 /// Formats a bounded list of normalization failures for an alert dialog,
@@ -527,14 +531,12 @@ AudioBatchComponent::AudioBatchComponent() :
 
     audioInfo->setPreferredHeightChangedCallback([this] { resized(); });
 
-    {
-        juce::PropertiesFile::Options options;
-        options.applicationName = "AudioBatch";
-        options.filenameSuffix = ".settings";
-        options.osxLibrarySubFolder = "Application Support";
-        options.folderName = "AudioBatch";
-        options.storageFormat = juce::PropertiesFile::storeAsXML;
-        pluginAppProperties.setStorageParameters(options);
+    pluginAppProperties.setStorageParameters(utils::settingsFileOptions());
+
+    if (const auto* settings = pluginAppProperties.getUserSettings(); settings != nullptr) {
+        AudioAnalysisService::setIoTuning(AudioIoCalibration::loadTuning(*settings));
+        analysisProfile = AudioAnalysisService::parseProfileName(settings->getValue(analysisProfileSettingsKey))
+                              .value_or(AudioAnalysisProfile::full);
     }
 
     pluginChain = std::make_unique<PluginChain>(pluginAppProperties);
@@ -600,6 +602,19 @@ AudioBatchComponent::AudioBatchComponent() :
     const auto analysisCacheOpened = analysisCache.open();
     if (analysisCacheOpened) {
         logStartupCheckpoint("analysis cache opened");
+
+        // Pruning and eviction run at low priority alongside the startup analysis.
+        AnalysisCacheMaintenanceOptions maintenanceOptions;
+
+        if (const auto* settings = pluginAppProperties.getUserSettings(); settings != nullptr) {
+            const auto budgetMebibytes = settings->getIntValue(
+                waveformCacheBudgetSettingsKey,
+                static_cast<int>(AnalysisCacheMaintenanceOptions::defaultWaveformBudgetBytes >> 20)
+            );
+            maintenanceOptions.waveformBudgetBytes = static_cast<std::int64_t>(juce::jmax(0, budgetMebibytes)) << 20;
+        }
+
+        analysisCache.startBackgroundMaintenance(maintenanceOptions);
     } else {
         utils::logError("AudioBatchComponent startup: analysis cache open failed");
     }
@@ -619,6 +634,15 @@ AudioBatchComponent::AudioBatchComponent() :
             }
         });
     });
+    analysisCoordinator.setDiscoveryCallback(
+        [safeThis](const std::vector<AudioFileInfo>& staleFiles, int discoveredFiles) {
+            juce::MessageManager::callAsync([safeThis, staleFiles, discoveredFiles] {
+                if (safeThis != nullptr) {
+                    safeThis->handleFilesDiscovered(staleFiles, discoveredFiles);
+                }
+            });
+        }
+    );
     analysisCoordinator.setStartingCallback([safeThis](const juce::File& file) {
         juce::MessageManager::callAsync([safeThis, file] {
             if (safeThis != nullptr) {
@@ -1019,6 +1043,27 @@ void AudioBatchComponent::reanalyzeSelectedRecords()
     startAnalysis(selectedFiles, false, true, false);
 }
 
+void AudioBatchComponent::setAnalysisProfile(const AudioAnalysisProfile profile)
+{
+    if (profile == analysisProfile) {
+        return;
+    }
+
+    const auto isUpgrade = static_cast<int>(profile) > static_cast<int>(analysisProfile);
+    analysisProfile = profile;
+    utils::logInfo("Analysis profile set to {}", AudioAnalysisService::getProfileName(profile));
+
+    if (auto* settings = pluginAppProperties.getUserSettings(); settings != nullptr) {
+        settings->setValue(analysisProfileSettingsKey, AudioAnalysisService::getProfileName(profile));
+        settings->saveIfNeeded();
+    }
+
+    // Cached rows that already cover the new profile are reused, so only the cheaper rows are re-read.
+    if (isUpgrade && hasAnyRecords() && !isAnalysisInProgress() && !normalizeInProgress) {
+        refreshAnalysis(false);
+    }
+}
+
 void AudioBatchComponent::showAudioSettingsWindow()
 {
     openDialogWindow(settingsWindow, &audioSetupComp, "Audio Settings");
@@ -1038,6 +1083,58 @@ void AudioBatchComponent::showSupportedNormalizationFormats()
     );
 }
 
+void AudioBatchComponent::calibrateIoSettingsForSelection()
+{
+    if (ioCalibrationInProgress || isAnalysisInProgress() || normalizeInProgress) {
+        return;
+    }
+
+    const auto selectedFiles = getSelectedRecordFiles();
+
+    if (selectedFiles.isEmpty()) {
+        return;
+    }
+
+    ioCalibrationInProgress = true;
+    statusLabel.setText("Calibrating I/O settings...", juce::dontSendNotification);
+
+    const SafePointer safeThis(this);
+    const auto currentTuning = AudioAnalysisService::getIoTuning();
+
+    juce::Thread::launch([safeThis, selectedFiles, currentTuning] {
+        const auto results = AudioIoCalibration::calibrate(selectedFiles, currentTuning);
+
+        juce::MessageManager::callAsync([safeThis, results, currentTuning] {
+            if (safeThis == nullptr) {
+                return;
+            }
+
+            safeThis->ioCalibrationInProgress = false;
+            safeThis->statusLabel.setText("I/O calibration complete", juce::dontSendNotification);
+
+            if (!results.empty()) {
+                const auto calibratedTuning = AudioIoCalibration::applyResults(currentTuning, results);
+                AudioAnalysisService::setIoTuning(calibratedTuning);
+
+                if (auto* settings = safeThis->pluginAppProperties.getUserSettings(); settings != nullptr) {
+                    AudioIoCalibration::saveTuning(*settings, calibratedTuning);
+                }
+            }
+
+            juce::AlertWindow::showAsync(
+                juce::MessageBoxOptions::makeOptionsOk(
+                    juce::MessageBoxIconType::InfoIcon,
+                    "I/O Calibration",
+                    AudioIoCalibration::formatSummary(results),
+                    "OK",
+                    safeThis.getComponent()
+                ),
+                nullptr
+            );
+        });
+    });
+}
+
 juce::File AudioBatchComponent::getDefaultBrowseDirectory()
 {
     const auto homeDirectory = juce::File::getSpecialLocation(juce::File::userHomeDirectory);
@@ -1150,6 +1247,11 @@ void AudioBatchComponent::showFileContextMenu(int row, const juce::Point<int> sc
     menu.addItem(reanalyzeMenuItemId, "Re-analyze Selected", !isAnalysisInProgress() && !normalizeInProgress);
     menu.addItem(normalizeMenuItemId, "Normalize to 0 dBFS", canNormalize);
     menu.addItem(normalizeSupportMenuItemId, "Normalization Format Support...");
+    menu.addItem(
+        calibrateIoMenuItemId,
+        "Calibrate I/O Settings on Selected Files",
+        !ioCalibrationInProgress && !isAnalysisInProgress() && !normalizeInProgress
+    );
     menu.addSeparator();
     const bool canProcess = !pluginProcessingInProgress && !isAnalysisInProgress() && !normalizeInProgress
         && pluginChain != nullptr && pluginChain->getNumEnabledValidSlots() > 0;
@@ -1185,6 +1287,9 @@ void AudioBatchComponent::showFileContextMenu(int row, const juce::Point<int> sc
                 case normalizeSupportMenuItemId:
                     safeThis->showSupportedNormalizationFormats();
                     break;
+                case calibrateIoMenuItemId:
+                    safeThis->calibrateIoSettingsForSelection();
+                    break;
                 case moveToTrashMenuItemId:
                     safeThis->moveSelectedRecordsToTrash(true);
                     break;
@@ -1468,7 +1573,7 @@ void AudioBatchComponent::reconcilePendingAnalysisResults()
 
         AudioAnalysisRecord refreshedRecord;
 
-        if (analysisCache.getAnalysis(record.file, refreshedRecord)) {
+        if (analysisCache.getAnalysis(record.file, refreshedRecord, analysisProfile)) {
             record = std::move(refreshedRecord);
             resultsChanged = true;
             continue;
@@ -1482,7 +1587,7 @@ void AudioBatchComponent::reconcilePendingAnalysisResults()
             continue;
         }
 
-        auto analyzedRecord = AudioAnalysisService::analyzeFile(record.file);
+        auto analyzedRecord = AudioAnalysisService::analyzeFile(record.file, analysisProfile);
         analysisCache.storeAnalysis(analyzedRecord);
         record = std::move(analyzedRecord);
         resultsChanged = true;
@@ -1594,6 +1699,38 @@ void AudioBatchComponent::removeRecordsByPath(const juce::StringArray& removedPa
     updateProcessButtonState();
 }
 
+void AudioBatchComponent::handleFilesDiscovered(const std::vector<AudioFileInfo>& staleFiles, const int discoveredFiles)
+{
+    expectedResults += discoveredFiles;
+    analyzedFilesThisRun += static_cast<int>(staleFiles.size());
+
+    if (!staleFiles.empty()) {
+        const auto selectedPaths = getSelectedRecordPaths();
+        juce::Array<juce::File> waitingFiles;
+
+        for (const auto& fileInfo : staleFiles) {
+            waitingFiles.add(fileInfo.file);
+
+            if (findRecordIndex(fileInfo.file.getFullPathName()) >= 0) {
+                continue;
+            }
+
+            auto placeholder = AudioAnalysisRecord::fromFileInfo(fileInfo);
+            placeholder.status = AudioAnalysisStatus::pending;
+            analysisResults.push_back(std::move(placeholder));
+        }
+
+        sortResults();
+        resultsTable.updateContent();
+        updateResultsTableColumnWidths();
+        restoreSelectionByPaths(selectedPaths);
+        markFilesProcessing(waitingFiles, "Waiting");
+    }
+
+    updateStatusLabel();
+    updateProcessButtonState();
+}
+
 void AudioBatchComponent::handleAnalysisResult(const AudioAnalysisRecord& record)
 {
     ++completedResults;
@@ -1715,10 +1852,15 @@ void AudioBatchComponent::handleNormalizeComplete(const int totalFiles)
 
 void AudioBatchComponent::handleAnalysisComplete(const int totalFiles)
 {
+    discoveringFiles = false;
     expectedResults = totalFiles;
     reconcilePendingAnalysisResults();
     updateStatusLabel();
 
+    if (totalFiles == 0 && analysisAddsToResults) {
+        statusLabel.setText("No supported dropped files", juce::dontSendNotification);
+    }
+
     const auto elapsedMs = juce::Time::getMillisecondCounterHiRes() - analysisStartedAtMs;
     const auto cachedFileCount = juce::jmax(0, totalFiles - analyzedFilesThisRun);
     const auto failedFileCount
@@ -1765,6 +1907,13 @@ void AudioBatchComponent::updateStatusLabel()
         return;
     }
 
+    if (discoveringFiles) {
+        statusLabel.setText(
+            utils::format("Scanning, analyzing {}/{}", completedResults, expectedResults), juce::dontSendNotification
+        );
+        return;
+    }
+
     if (expectedResults <= 0) {
         statusLabel.setText("No supported audio files found", juce::dontSendNotification);
         return;
@@ -1907,48 +2056,15 @@ void AudioBatchComponent::startAnalysis(
     options.inputPaths = inputPaths;
     options.recursive = recursive;
     options.refresh = forceRefresh;
+    options.profile = analysisProfile;
 
     analysisStartedAtMs = juce::Time::getMillisecondCounterHiRes();
     completedResults = 0;
-    const auto files = AudioAnalysisService::collectInputFiles(options.inputPaths, options.recursive);
-    expectedResults = files.size();
-    utils::logInfo("Found {} audio files", expectedResults);
-
-    if (expectedResults == 0) {
-        statusLabel.setText(
-            clearResults ? "No supported audio files found" : "No supported dropped files", juce::dontSendNotification
-        );
-        return;
-    }
-
-    juce::Array<juce::File> staleFiles;
-
-    for (const auto& file : files) {
-        AudioAnalysisRecord cachedRecord;
-
-        if (!forceRefresh && analysisCache.getAnalysis(file, cachedRecord)) {
-            continue;
-        }
-
-        staleFiles.add(file);
-
-        if (findRecordIndex(file.getFullPathName()) >= 0) {
-            continue;
-        }
-
-        auto placeholder = AudioAnalysisRecord::fromFile(file);
-        placeholder.status = AudioAnalysisStatus::pending;
-        analysisResults.push_back(std::move(placeholder));
-    }
-
-    analyzedFilesThisRun = staleFiles.size();
-
-    sortResults();
-    resultsTable.updateContent();
-    updateResultsTableColumnWidths();
-    markFilesProcessing(staleFiles, "Waiting");
-
-    statusLabel.setText(utils::format("Analyzing 0/{}", expectedResults), juce::dontSendNotification);
+    expectedResults = 0;
+    analyzedFilesThisRun = 0;
+    analysisAddsToResults = !clearResults;
+    discoveringFiles = true;
+    updateStatusLabel();
 
     if (clearResults && currentRoot.isDirectory()) {
         currentRootLabel.setText(currentRoot.getFullPathName(), juce::dontSendNotification);
@@ -1958,7 +2074,8 @@ void AudioBatchComponent::startAnalysis(
         currentRootLabel.setTooltip("");
     }
 
-    analysisCoordinator.start(options, files);
+    // Rows, counts, and the status label fill in from the discovery and result callbacks as files are found.
+    analysisCoordinator.start(options);
     updateProcessButtonState();
 }
 
@@ -1980,7 +2097,7 @@ float AudioBatchComponent::getActivityPhase()
 
 bool AudioBatchComponent::isAnalysisInProgress() const
 {
-    return completedResults < expectedResults;
+    return discoveringFiles || completedResults < expectedResults;
 }
 
 bool AudioBatchComponent::isAnyFileProcessing() const
@@ -2156,9 +2273,18 @@ void AudioBatchComponent::updateAudioInfo(const AudioAnalysisRecord& record)
     rows.emplace_back("Peak Max", AudioAnalysisService::formatPeakDisplay(record.overallPeak));
     rows.emplace_back("Peak L", AudioAnalysisService::formatPeakDisplay(record.peakLeft));
     rows.emplace_back("Peak R", AudioAnalysisService::formatPeakDisplay(record.peakRight));
-    rows.emplace_back("True Peak Max", AudioAnalysisService::formatTruePeakDisplay(record.overallTruePeak));
-    rows.emplace_back("Max Short-term", AudioAnalysisService::formatLoudnessDisplay(record.maxShortTermLufs));
-    rows.emplace_back("Integrated Loudness", AudioAnalysisService::formatLoudnessDisplay(record.integratedLufs));
+    rows.emplace_back(
+        "True Peak Max",
+        record.hasTruePeak() ? AudioAnalysisService::formatTruePeakDisplay(record.overallTruePeak) : "-"
+    );
+    rows.emplace_back(
+        "Max Short-term",
+        record.hasLoudness() ? AudioAnalysisService::formatLoudnessDisplay(record.maxShortTermLufs) : "-"
+    );
+    rows.emplace_back(
+        "Integrated Loudness",
+        record.hasLoudness() ? AudioAnalysisService::formatLoudnessDisplay(record.integratedLufs) : "-"
+    );
     rows.emplace_back("Status", AudioAnalysisService::formatStatus(record));
 
     audioInfo->setRows(std::move(rows));
@@ -60,9 +60,23 @@ public:
     /// Shows which file types can be normalized in the current build.
     void showSupportedNormalizationFormats();
 
+    /// Times analysis of the selected files with different I/O settings on a background thread,
+    /// then stores and applies the fastest settings per format.
+    void calibrateIoSettingsForSelection();
+
     /// Runs the configured plugin (if any) over the currently-selected files.
     void processSelectedRecords();
 
+    /// Returns the profile used for new analysis runs.
+    [[nodiscard]] AudioAnalysisProfile getAnalysisProfile() const noexcept
+    {
+        return analysisProfile;
+    }
+
+    /// Switches the analysis profile and stores it in the settings file.
+    /// Switching to a richer profile re-analyzes the listed files whose cached rows lack the new measurements.
+    void setAnalysisProfile(AudioAnalysisProfile profile);
+
     /// Returns the plugin selection controller, or nullptr before the component finishes constructing.
     [[nodiscard]] PluginChain* getPluginChain() const noexcept
     {
@@ -129,6 +143,10 @@ private:
     /// Selects the clicked row and opens the per-file action menu.
     void handleFileContextMenuRequested(int row, int columnId, const juce::MouseEvent& event);
 
+    /// Adds waiting rows for newly found files that need analysis and grows the expected result count,
+    /// so the table fills in while the directories are still being listed.
+    void handleFilesDiscovered(const std::vector<AudioFileInfo>& staleFiles, int discoveredFiles);
+
     /// Merges one analysis result into the table on the message thread,
     /// preserving any custom gain already set for the file and keeping selection and preview in sync.
     void handleAnalysisResult(const AudioAnalysisRecord& record);
@@ -346,8 +364,12 @@ private:
     int secondarySortColumnId = 0;
     bool secondarySortForwards = true;
     bool currentWaveformLoadedFromCache = false;
+    bool analysisAddsToResults = false;
+    bool discoveringFiles = false;
     bool normalizeInProgress = false;
     bool pluginProcessingInProgress = false;
+    bool ioCalibrationInProgress = false;
+    AudioAnalysisProfile analysisProfile = AudioAnalysisProfile::full;
     int processedResultsCompleted = 0;
     int processedResultsExpected = 0;
 
@@ -289,15 +289,15 @@ void AudioFileTableModel::paintCell(
             justification = juce::Justification::centredRight;
             break;
         case columnOverallTruePeak:
-            text = AudioAnalysisService::formatTruePeakDisplay(record.overallTruePeak);
+            text = record.hasTruePeak() ? AudioAnalysisService::formatTruePeakDisplay(record.overallTruePeak) : "-";
             justification = juce::Justification::centredRight;
             break;
         case columnMaxShortTermLufs:
-            text = AudioAnalysisService::formatLoudnessDisplay(record.maxShortTermLufs);
+            text = record.hasLoudness() ? AudioAnalysisService::formatLoudnessDisplay(record.maxShortTermLufs) : "-";
             justification = juce::Justification::centredRight;
             break;
         case columnIntegratedLufs:
-            text = AudioAnalysisService::formatLoudnessDisplay(record.integratedLufs);
+            text = record.hasLoudness() ? AudioAnalysisService::formatLoudnessDisplay(record.integratedLufs) : "-";
             justification = juce::Justification::centredRight;
             break;
         case columnCustomGain:
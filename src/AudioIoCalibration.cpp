@@ -0,0 +1,304 @@
+/// Implementation of AudioIoCalibration.
+/// Groups the sample files by extension, times AudioAnalysisService::analyzeFile
+/// with each candidate block size and reader setup, and keeps the fastest candidate per format.
+/// The tuning is stored as an XML value in the shared settings file.
+
+#include "AudioIoCalibration.h"
+
+#include "AudioAnalysisService.h"
+#include "utils.h"
+
+#include <array>
+#include <map>
+#include <memory>
+
+/// Candidate lists and XML serialization helpers for the I/O tuning.
+namespace audiobatch::io_calibration
+{
+constexpr auto tuningSettingsKey = "audioIoTuning";
+constexpr auto tuningElementName = "AudioIoTuning";
+constexpr auto defaultsElementName = "Defaults";
+constexpr auto formatElementName = "Format";
+constexpr auto extensionAttribute = "extension";
+constexpr std::array candidateBlockSizes {2048, 8192, 32768, 131072};
+constexpr std::array candidateReadaheadBytes {0, 1 << 20, 8 << 20};
+constexpr double bytesPerMegabyte = 1000.0 * 1000.0;
+
+/// Returns the file extension in lowercase without the leading dot.
+static juce::String normalizedExtension(const juce::File& file)
+{
+    return file.getFileExtension().trimCharactersAtStart(".").toLowerCase();
+}
+
+/// Picks up to count files spread evenly over the list,
+/// so the sample is not dominated by a single folder of similar recordings.
+static juce::Array<juce::File> pickSample(const juce::Array<juce::File>& files, const int count)
+{
+    if (files.size() <= count) {
+        return files;
+    }
+
+    juce::Array<juce::File> sample;
+
+    for (int index = 0; index < count; ++index) {
+        sample.add(files[index * files.size() / count]);
+    }
+
+    return sample;
+}
+
+/// Returns true when the file's format can be read through a memory-mapped reader.
+static bool supportsMemoryMapping(juce::AudioFormatManager& formatManager, const juce::File& file)
+{
+    auto* format = formatManager.findFormatForFileExtension(normalizedExtension(file));
+
+    if (format == nullptr) {
+        return false;
+    }
+
+    const std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader(format->createMemoryMappedReader(file));
+    return reader != nullptr;
+}
+
+/// Builds the candidate settings for one format.
+/// Only the analysis block size and the reader setup vary,
+/// and readahead is only tried with streamed readers since mapped reads bypass the stream.
+static std::vector<AudioIoSettings> buildCandidates(const AudioIoSettings& baseSettings, const bool canMemoryMap)
+{
+    std::vector<AudioIoSettings> candidates;
+
+    for (const auto blockSize : candidateBlockSizes) {
+        auto candidate = baseSettings;
+        candidate.analysisBlockSize = blockSize;
+
+        if (canMemoryMap) {
+            candidate.useMemoryMapping = true;
+            candidate.readaheadBytes = 0;
+            candidates.push_back(candidate);
+        }
+
+        candidate.useMemoryMapping = false;
+
+        for (const auto readaheadBytes : candidateReadaheadBytes) {
+            candidate.readaheadBytes = readaheadBytes;
+            candidates.push_back(candidate);
+        }
+    }
+
+    return candidates;
+}
+
+/// Analyzes every file with the settings and returns the elapsed seconds,
+/// or a negative value when any of the analyses fails.
+static double timeAnalysis(const juce::Array<juce::File>& files, const AudioIoSettings& settings)
+{
+    const auto startedAtMs = juce::Time::getMillisecondCounterHiRes();
+
+    for (const auto& file : files) {
+        if (AudioAnalysisService::analyzeFile(file, settings).hasError()) {
+            return -1.0;
+        }
+    }
+
+    return (juce::Time::getMillisecondCounterHiRes() - startedAtMs) / 1000.0;
+}
+
+/// Formats the settings as a short human-readable description.
+static juce::String describeSettings(const AudioIoSettings& settings)
+{
+    if (settings.useMemoryMapping) {
+        return utils::format("block {}, memory-mapped", settings.analysisBlockSize);
+    }
+
+    if (settings.readaheadBytes > 0) {
+        return utils::format("block {}, {} KiB readahead", settings.analysisBlockSize, settings.readaheadBytes / 1024);
+    }
+
+    return utils::format("block {}, streamed", settings.analysisBlockSize);
+}
+
+/// Returns the throughput in MB/s, or 0 when nothing was timed.
+static double throughputMegabytesPerSecond(const std::int64_t bytes, const double seconds)
+{
+    return seconds > 0.0 ? static_cast<double>(bytes) / seconds / bytesPerMegabyte : 0.0;
+}
+
+/// Creates an XML element holding the settings under the given tag name.
+static std::unique_ptr<juce::XmlElement> createSettingsElement(
+    const juce::String& tagName,
+    const AudioIoSettings& settings
+)
+{
+    auto element = std::make_unique<juce::XmlElement>(tagName);
+    element->setAttribute("analysisBlockSize", settings.analysisBlockSize);
+    element->setAttribute("normalizationBlockSize", settings.normalizationBlockSize);
+    element->setAttribute("processingBlockSize", settings.processingBlockSize);
+    element->setAttribute("readaheadBytes", settings.readaheadBytes);
+    element->setAttribute("memoryMapping", settings.useMemoryMapping);
+    return element;
+}
+
+/// Reads settings from an XML element, using the defaults for missing attributes.
+static AudioIoSettings readSettingsElement(const juce::XmlElement& element)
+{
+    const AudioIoSettings defaults;
+    AudioIoSettings settings;
+    settings.analysisBlockSize = element.getIntAttribute("analysisBlockSize", defaults.analysisBlockSize);
+    settings.normalizationBlockSize
+        = element.getIntAttribute("normalizationBlockSize", defaults.normalizationBlockSize);
+    settings.processingBlockSize = element.getIntAttribute("processingBlockSize", defaults.processingBlockSize);
+    settings.readaheadBytes = element.getIntAttribute("readaheadBytes", defaults.readaheadBytes);
+    settings.useMemoryMapping = element.getBoolAttribute("memoryMapping", defaults.useMemoryMapping);
+    return settings.sanitized();
+}
+}  // namespace audiobatch::io_calibration
+
+using namespace audiobatch::io_calibration;
+
+std::vector<AudioIoCalibrationResult> AudioIoCalibration::calibrate(
+    const juce::Array<juce::File>& files,
+    const AudioIoTuning& currentTuning,
+    const int filesPerFormat
+)
+{
+    std::map<juce::String, juce::Array<juce::File>> filesByFormat;
+
+    for (const auto& file : files) {
+        if (AudioAnalysisService::isSupportedAudioFile(file)) {
+            filesByFormat[normalizedExtension(file)].add(file);
+        }
+    }
+
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+    std::vector<AudioIoCalibrationResult> results;
+
+    for (const auto& [extension, formatFiles] : filesByFormat) {
+        const auto& baseSettings = currentTuning.forFile(formatFiles.getFirst());
+        juce::Array<juce::File> sample;
+        std::int64_t sampleBytes = 0;
+
+        // Warm-up pass: every candidate then reads the files from the same page cache state.
+        for (const auto& file : pickSample(formatFiles, juce::jmax(1, filesPerFormat))) {
+            if (!AudioAnalysisService::analyzeFile(file, baseSettings).hasError()) {
+                sample.add(file);
+                sampleBytes += file.getSize();
+            }
+        }
+
+        if (sample.isEmpty()) {
+            utils::logWarn("Skipping I/O calibration for {} files: no sample file could be analyzed", extension);
+            continue;
+        }
+
+        AudioIoCalibrationResult result;
+        result.extension = extension;
+        result.settings = baseSettings;
+        result.filesMeasured = sample.size();
+        result.bytesMeasured = sampleBytes;
+        result.baselineSeconds = timeAnalysis(sample, baseSettings);
+        result.fastestSeconds = result.baselineSeconds;
+
+        if (result.baselineSeconds < 0.0) {
+            utils::logWarn("Skipping I/O calibration for {} files: analysis failed during timing", extension);
+            continue;
+        }
+
+        for (const auto& candidate : buildCandidates(baseSettings, supportsMemoryMapping(formatManager, sample[0]))) {
+            if (candidate == baseSettings) {
+                continue;
+            }
+
+            if (const auto seconds = timeAnalysis(sample, candidate); seconds >= 0.0 && seconds < result.fastestSeconds)
+            {
+                result.fastestSeconds = seconds;
+                result.settings = candidate;
+            }
+        }
+
+        utils::logInfo(
+            "I/O calibration for {}: {} at {:.1f} MB/s",
+            extension,
+            describeSettings(result.settings),
+            throughputMegabytesPerSecond(result.bytesMeasured, result.fastestSeconds)
+        );
+        results.push_back(result);
+    }
+
+    return results;
+}
+
+AudioIoTuning AudioIoCalibration::applyResults(
+    const AudioIoTuning& tuning,
+    const std::vector<AudioIoCalibrationResult>& results
+)
+{
+    auto calibratedTuning = tuning;
+
+    for (const auto& result : results) {
+        calibratedTuning.formatOverrides[result.extension] = result.settings;
+    }
+
+    return calibratedTuning;
+}
+
+juce::String AudioIoCalibration::formatSummary(const std::vector<AudioIoCalibrationResult>& results)
+{
+    if (results.empty()) {
+        return "No supported files could be calibrated.";
+    }
+
+    juce::StringArray lines;
+
+    for (const auto& result : results) {
+        lines.add(utils::format(
+            "{}: {} ({:.1f} MB/s, previously {:.1f} MB/s, {} files)",
+            result.extension,
+            describeSettings(result.settings),
+            throughputMegabytesPerSecond(result.bytesMeasured, result.fastestSeconds),
+            throughputMegabytesPerSecond(result.bytesMeasured, result.baselineSeconds),
+            result.filesMeasured
+        ));
+    }
+
+    return lines.joinIntoString(juce::newLine);
+}
+
+AudioIoTuning AudioIoCalibration::loadTuning(const juce::PropertiesFile& settings)
+{
+    AudioIoTuning tuning;
+    const auto tuningElement = settings.getXmlValue(tuningSettingsKey);
+
+    if (tuningElement == nullptr || !tuningElement->hasTagName(tuningElementName)) {
+        return tuning;
+    }
+
+    if (const auto* defaultsElement = tuningElement->getChildByName(defaultsElementName); defaultsElement != nullptr) {
+        tuning.defaults = readSettingsElement(*defaultsElement);
+    }
+
+    for (const auto* formatElement : tuningElement->getChildWithTagNameIterator(formatElementName)) {
+        if (const auto extension = formatElement->getStringAttribute(extensionAttribute).toLowerCase();
+            extension.isNotEmpty())
+        {
+            tuning.formatOverrides[extension] = readSettingsElement(*formatElement);
+        }
+    }
+
+    return tuning;
+}
+
+void AudioIoCalibration::saveTuning(juce::PropertiesFile& settings, const AudioIoTuning& tuning)
+{
+    juce::XmlElement tuningElement(tuningElementName);
+    tuningElement.addChildElement(createSettingsElement(defaultsElementName, tuning.defaults).release());
+
+    for (const auto& [extension, formatSettings] : tuning.formatOverrides) {
+        auto formatElement = createSettingsElement(formatElementName, formatSettings);
+        formatElement->setAttribute(extensionAttribute, extension);
+        tuningElement.addChildElement(formatElement.release());
+    }
+
+    settings.setValue(tuningSettingsKey, &tuningElement);
+    settings.saveIfNeeded();
+}
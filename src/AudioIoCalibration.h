@@ -0,0 +1,52 @@
+/// I/O tuning persistence and calibration.
+/// AudioIoCalibration stores the AudioIoTuning in the settings file shared by the GUI and CLI,
+/// and times analysis over a sample of files to pick the fastest block size,
+/// readahead, and memory mapping settings for each file format.
+
+#pragma once
+
+#include "AudioAnalysisTypes.h"
+
+#include <JuceHeader.h>
+
+#include <vector>
+
+/// Outcome of calibrating one file format.
+struct AudioIoCalibrationResult {
+    juce::String extension;
+    AudioIoSettings settings;
+    int filesMeasured = 0;
+    std::int64_t bytesMeasured = 0;
+    double fastestSeconds = 0.0;
+    double baselineSeconds = 0.0;
+};
+
+/// Stateless helpers for measuring and persisting the per-format I/O tuning.
+class AudioIoCalibration
+{
+public:
+    static constexpr int defaultFilesPerFormat = 3;
+
+    /// Times analysis of up to filesPerFormat files of each format with every candidate setting.
+    /// Each sample file is analyzed once up front so every candidate starts from the same page cache state,
+    /// and files that fail to analyze are left out of the measurement.
+    /// Blocks until done, so call it off the message thread.
+    static std::vector<AudioIoCalibrationResult> calibrate(
+        const juce::Array<juce::File>& files,
+        const AudioIoTuning& currentTuning,
+        int filesPerFormat = defaultFilesPerFormat
+    );
+
+    /// Returns the tuning with each calibrated format's fastest settings stored as an override.
+    static AudioIoTuning
+    applyResults(const AudioIoTuning& tuning, const std::vector<AudioIoCalibrationResult>& results);
+
+    /// Formats one line per calibrated format for the CLI output and the GUI alert.
+    static juce::String formatSummary(const std::vector<AudioIoCalibrationResult>& results);
+
+    /// Reads the stored tuning from the settings file, or returns the defaults when none is stored.
+    static AudioIoTuning loadTuning(const juce::PropertiesFile& settings);
+
+    /// Writes the tuning to the settings file.
+    static void saveTuning(juce::PropertiesFile& settings, const AudioIoTuning& tuning);
+};
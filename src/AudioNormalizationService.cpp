@@ -25,7 +25,6 @@ static AudioNormalizationResult failNormalization(const juce::File& file, const
     return AudioNormalizationResult::failure(file, message);
 }
 
-constexpr int normalizationBlockSize = 32768;
 constexpr auto normalizedAiffOutputExtension = ".aif";
 constexpr int defaultMp3BitsPerSample = 16;
 
@@ -525,7 +524,8 @@ AudioNormalizationResult AudioNormalizationService::normalizeFile(const AudioAna
         return failNormalization(file, "Unsupported audio format");
     }
 
-    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+    const auto ioSettings = AudioAnalysisService::getIoSettings(file);
+    auto reader = AudioAnalysisService::createReader(formatManager, file, ioSettings);
 
     if (reader == nullptr) {
         return failNormalization(file, "Unsupported or unreadable audio file");
@@ -581,19 +581,17 @@ AudioNormalizationResult AudioNormalizationService::normalizeFile(const AudioAna
         return failNormalization(file, getNormalizationSupportMessage(file));
     }
 
-    juce::AudioBuffer<float> buffer(static_cast<int>(reader->numChannels), normalizationBlockSize);
+    const auto blockSize = ioSettings.normalizationBlockSize;
+    juce::AudioBuffer<float> buffer(static_cast<int>(reader->numChannels), blockSize);
     std::vector<float*> channelPointers(reader->numChannels);
 
     for (int channel = 0; channel < buffer.getNumChannels(); ++channel) {
         channelPointers[static_cast<std::size_t>(channel)] = buffer.getWritePointer(channel);
     }
 
-    for (juce::int64 samplePosition = 0; samplePosition < reader->lengthInSamples;
-         samplePosition += normalizationBlockSize)
-    {
-        const auto samplesThisBlock = static_cast<int>(
-            juce::jmin<juce::int64>(normalizationBlockSize, reader->lengthInSamples - samplePosition)
-        );
+    for (juce::int64 samplePosition = 0; samplePosition < reader->lengthInSamples; samplePosition += blockSize) {
+        const auto samplesThisBlock
+            = static_cast<int>(juce::jmin<juce::int64>(blockSize, reader->lengthInSamples - samplePosition));
 
         if (!reader->read(channelPointers.data(), buffer.getNumChannels(), samplePosition, samplesThisBlock)
             && !canAcceptReadFailureForNormalization(*reader, file, samplePosition, samplesThisBlock))
@@ -609,6 +607,8 @@ AudioNormalizationResult AudioNormalizationService::normalizeFile(const AudioAna
     }
 
     writer.reset();
+    // Release the source before the output replaces it, since a memory-mapped reader keeps the file mapped.
+    reader.reset();
 
     if (!preserveOutputMetadata(file, temporaryFile.getFile())) {
         return failNormalization(file, "Could not preserve metadata while writing normalized audio");
@@ -0,0 +1,187 @@
+/// Implementation of DirectoryScanner.
+/// Directory jobs list one directory each and queue a new job per subdirectory.
+/// Found files collect in a shared list that the calling thread drains between short waits,
+/// so the callback always runs on the caller's thread and never concurrently with itself.
+
+#include "DirectoryScanner.h"
+
+#include "AudioAnalysisService.h"
+#include "utils.h"
+
+#include <atomic>
+#include <unordered_set>
+
+/// Shared state and jobs of one directory walk.
+namespace audiobatch::scanner
+{
+/// Files found in one directory are published at least this often, so huge directories stream too.
+constexpr size_t publishBatchSize = 256;
+/// Longest time the calling thread sleeps before checking for found files and stop requests.
+constexpr int drainIntervalMs = 20;
+
+/// State shared by the directory jobs of one scan and the thread draining their results.
+struct ScanState {
+    juce::ThreadPool* pool = nullptr;
+    bool recursive = false;
+    std::function<bool()> shouldStop;
+
+    /// Guards foundFiles, seenFiles, and seenDirectories.
+    juce::CriticalSection lock;
+    std::vector<AudioFileInfo> foundFiles;
+    std::unordered_set<juce::String> seenFiles;
+    std::unordered_set<juce::String> seenDirectories;
+
+    /// Directories queued or being listed. The walk is done once it drops to zero.
+    std::atomic<int> pendingDirectories {0};
+    juce::WaitableEvent filesFound;
+
+    [[nodiscard]] bool stopRequested() const
+    {
+        return shouldStop != nullptr && shouldStop();
+    }
+};
+
+/// Adds files not seen before to the found list and wakes the draining thread.
+/// Overlapping input paths are the only source of duplicates, since each directory is listed once.
+static void publishFiles(ScanState& state, const std::vector<AudioFileInfo>& files)
+{
+    if (files.empty()) {
+        return;
+    }
+
+    {
+        const juce::ScopedLock lock(state.lock);
+
+        for (const auto& fileInfo : files) {
+            if (state.seenFiles.insert(fileInfo.file.getFullPathName()).second) {
+                state.foundFiles.push_back(fileInfo);
+            }
+        }
+    }
+
+    state.filesFound.signal();
+}
+
+static void queueDirectory(ScanState& state, const juce::File& directory);
+
+/// Lists one directory, publishing its supported files and queueing its subdirectories when recursive.
+/// The entry already carries the file's type, size, and modification time, so files are not stat'ed again.
+static void scanDirectory(ScanState& state, const juce::File& directory)
+{
+    std::vector<AudioFileInfo> files;
+
+    for (const auto& entry : juce::RangedDirectoryIterator(
+             directory, false, "*", juce::File::findFilesAndDirectories, juce::File::FollowSymlinks::no
+         ))
+    {
+        if (state.stopRequested()) {
+            break;
+        }
+
+        const auto& file = entry.getFile();
+
+        if (entry.isDirectory()) {
+            if (state.recursive) {
+                queueDirectory(state, file);
+            }
+        } else if (AudioAnalysisService::hasSupportedExtension(file)) {
+            files.push_back({file, entry.getFileSize(), entry.getModificationTime().toMilliseconds()});
+
+            if (files.size() >= publishBatchSize) {
+                publishFiles(state, files);
+                files.clear();
+            }
+        }
+    }
+
+    publishFiles(state, files);
+
+    if (--state.pendingDirectories == 0) {
+        state.filesFound.signal();
+    }
+}
+
+/// Queues a directory job unless the directory, or the directory a link points to, was already queued.
+static void queueDirectory(ScanState& state, const juce::File& directory)
+{
+    const auto target = directory.isSymbolicLink() ? directory.getLinkedTarget() : directory;
+
+    {
+        const juce::ScopedLock lock(state.lock);
+
+        if (!state.seenDirectories.insert(target.getFullPathName()).second) {
+            return;
+        }
+    }
+
+    ++state.pendingDirectories;
+    state.pool->addJob([&state, directory] { scanDirectory(state, directory); });
+}
+}  // namespace audiobatch::scanner
+
+using namespace audiobatch::scanner;
+
+int DirectoryScanner::scan(
+    const juce::Array<juce::File>& inputPaths,
+    const bool recursive,
+    const BatchCallback& onBatch,
+    const std::function<bool()>& shouldStop,
+    const int threadCount
+)
+{
+    const auto startedAtMs = juce::Time::getMillisecondCounterHiRes();
+
+    // The pool is declared after the state, so it finishes its jobs before the state goes away.
+    ScanState state;
+    juce::ThreadPool pool(juce::jmax(1, threadCount));
+    state.pool = &pool;
+    state.recursive = recursive;
+    state.shouldStop = shouldStop;
+
+    std::vector<AudioFileInfo> inputFiles;
+
+    for (const auto& inputPath : inputPaths) {
+        if (inputPath.isDirectory()) {
+            queueDirectory(state, inputPath);
+        } else if (AudioAnalysisService::isSupportedAudioFile(inputPath)) {
+            inputFiles.push_back(AudioFileInfo::fromFile(inputPath));
+        }
+    }
+
+    publishFiles(state, inputFiles);
+
+    int reportedFiles = 0;
+
+    while (!state.stopRequested()) {
+        // Checked before draining: once no directory is pending, every file they found is already in the list.
+        const auto walkFinished = state.pendingDirectories.load() == 0;
+        std::vector<AudioFileInfo> batch;
+
+        {
+            const juce::ScopedLock lock(state.lock);
+            batch.swap(state.foundFiles);
+        }
+
+        if (!batch.empty()) {
+            reportedFiles += static_cast<int>(batch.size());
+            onBatch(batch);
+        }
+
+        if (walkFinished) {
+            break;
+        }
+
+        state.filesFound.wait(drainIntervalMs);
+    }
+
+    pool.removeAllJobs(true, -1);
+
+    utils::logDebug(
+        "Scanned {} directories and found {} audio files in {:.3f} s",
+        state.seenDirectories.size(),
+        reportedFiles,
+        (juce::Time::getMillisecondCounterHiRes() - startedAtMs) / 1000.0
+    );
+
+    return reportedFiles;
+}
@@ -0,0 +1,41 @@
+/// Parallel discovery of audio files below the input paths.
+/// DirectoryScanner lists directories on a small thread pool, one job per directory,
+/// and hands supported files to the caller in batches while the walk is still running,
+/// so analysis can start on the first files before a large or remote library has been fully listed.
+
+#pragma once
+
+#include "AudioAnalysisTypes.h"
+
+#include <JuceHeader.h>
+
+#include <functional>
+#include <vector>
+
+/// Stateless streaming directory walker.
+class DirectoryScanner
+{
+public:
+    /// Receives each batch of newly discovered files on the thread that called scan,
+    /// with the size and modification time from the directory listing.
+    using BatchCallback = std::function<void(const std::vector<AudioFileInfo>& files)>;
+
+    /// Directories listed at the same time. Listing mostly waits on the file system,
+    /// so more directories in flight than cores pays off on network shares.
+    static constexpr int defaultThreadCount = 8;
+
+    /// Finds the supported audio files among the input paths and, when recursive is set, below the directories,
+    /// and passes them to onBatch as they are found. Each file is reported once, in discovery order.
+    /// Files given directly must exist and are stat'ed once, while files found in directories are matched
+    /// by extension only and take their metadata from the listing.
+    /// Symbolic links to directories are followed once each.
+    ///
+    /// Blocks until the walk is done, or until shouldStop returns true, and returns the number of files reported.
+    static int scan(
+        const juce::Array<juce::File>& inputPaths,
+        bool recursive,
+        const BatchCallback& onBatch,
+        const std::function<bool()>& shouldStop = nullptr,
+        int threadCount = defaultThreadCount
+    );
+};
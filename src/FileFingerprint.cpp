@@ -0,0 +1,298 @@
+/// Implementation of FileFingerprint.
+/// Contains a streaming XXH64 hasher following the reference specification,
+/// so whole files hash in fixed-size chunks without loading them into memory,
+/// and the readers that feed it either the sampled head and tail or the entire file,
+/// from disk or from a copy of the file already read into memory.
+
+#include "FileFingerprint.h"
+
+#include "utils.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <vector>
+
+/// Streaming XXH64 and the stream reader that feeds it.
+namespace audiobatch::fingerprint
+{
+constexpr juce::uint64 prime1 = 0x9E3779B185EBCA87ULL;
+constexpr juce::uint64 prime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr juce::uint64 prime3 = 0x165667B19E3779F9ULL;
+constexpr juce::uint64 prime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr juce::uint64 prime5 = 0x27D4EB2F165667C5ULL;
+
+/// Chunk size used when hashing a whole file.
+constexpr int readChunkBytes = 1 << 20;
+
+/// Reads a little-endian 64-bit value from unaligned memory.
+static juce::uint64 readLittleEndian64(const juce::uint8* data)
+{
+    juce::uint64 value = 0;
+    std::memcpy(&value, data, sizeof(value));
+    return juce::ByteOrder::swapIfBigEndian(value);
+}
+
+/// Reads a little-endian 32-bit value from unaligned memory.
+static juce::uint32 readLittleEndian32(const juce::uint8* data)
+{
+    juce::uint32 value = 0;
+    std::memcpy(&value, data, sizeof(value));
+    return juce::ByteOrder::swapIfBigEndian(value);
+}
+
+/// Mixes one 8-byte lane into an accumulator.
+static juce::uint64 round(juce::uint64 accumulator, const juce::uint64 input)
+{
+    accumulator += input * prime2;
+    accumulator = std::rotl(accumulator, 31);
+    return accumulator * prime1;
+}
+
+/// Folds a lane accumulator into the converged hash.
+static juce::uint64 mergeRound(juce::uint64 hash, const juce::uint64 accumulator)
+{
+    hash ^= round(0, accumulator);
+    return hash * prime1 + prime4;
+}
+
+/// Incremental XXH64: update with consecutive pieces, then read the digest of everything seen so far.
+class XxHash64
+{
+public:
+    explicit XxHash64(const juce::uint64 initialSeed = 0) :
+        lanes {initialSeed + prime1 + prime2, initialSeed + prime2, initialSeed, initialSeed - prime1},
+        seed(initialSeed)
+    { }
+
+    void update(const void* data, size_t numBytes)
+    {
+        const auto* input = static_cast<const juce::uint8*>(data);
+        totalBytes += numBytes;
+
+        if (bufferedBytes > 0) {
+            const auto toCopy = std::min(numBytes, stripeBytes - bufferedBytes);
+            std::memcpy(buffer.data() + bufferedBytes, input, toCopy);
+            bufferedBytes += toCopy;
+            input += toCopy;
+            numBytes -= toCopy;
+
+            if (bufferedBytes < stripeBytes) {
+                return;
+            }
+
+            consumeStripe(buffer.data());
+            bufferedBytes = 0;
+        }
+
+        while (numBytes >= stripeBytes) {
+            consumeStripe(input);
+            input += stripeBytes;
+            numBytes -= stripeBytes;
+        }
+
+        std::memcpy(buffer.data(), input, numBytes);
+        bufferedBytes = numBytes;
+    }
+
+    /// Adds a 64-bit value to the hashed stream in little-endian byte order.
+    void update(const juce::uint64 value)
+    {
+        const auto littleEndian = juce::ByteOrder::swapIfBigEndian(value);
+        update(&littleEndian, sizeof(littleEndian));
+    }
+
+    [[nodiscard]] juce::uint64 digest() const
+    {
+        juce::uint64 hash = 0;
+
+        if (totalBytes >= stripeBytes) {
+            hash = std::rotl(lanes[0], 1) + std::rotl(lanes[1], 7) + std::rotl(lanes[2], 12) + std::rotl(lanes[3], 18);
+
+            for (const auto lane : lanes) {
+                hash = mergeRound(hash, lane);
+            }
+        } else {
+            hash = seed + prime5;
+        }
+
+        hash += totalBytes;
+
+        const auto* input = buffer.data();
+        auto remaining = bufferedBytes;
+
+        for (; remaining >= 8; input += 8, remaining -= 8) {
+            hash ^= round(0, readLittleEndian64(input));
+            hash = std::rotl(hash, 27) * prime1 + prime4;
+        }
+
+        if (remaining >= 4) {
+            hash ^= static_cast<juce::uint64>(readLittleEndian32(input)) * prime1;
+            hash = std::rotl(hash, 23) * prime2 + prime3;
+            input += 4;
+            remaining -= 4;
+        }
+
+        for (; remaining > 0; ++input, --remaining) {
+            hash ^= *input * prime5;
+            hash = std::rotl(hash, 11) * prime1;
+        }
+
+        hash ^= hash >> 33;
+        hash *= prime2;
+        hash ^= hash >> 29;
+        hash *= prime3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+private:
+    static constexpr size_t stripeBytes = 32;
+
+    void consumeStripe(const juce::uint8* stripe)
+    {
+        for (size_t lane = 0; lane < lanes.size(); ++lane) {
+            lanes[lane] = round(lanes[lane], readLittleEndian64(stripe + lane * 8));
+        }
+    }
+
+    std::array<juce::uint64, 4> lanes;
+    std::array<juce::uint8, stripeBytes> buffer {};
+    juce::uint64 seed = 0;
+    juce::uint64 totalBytes = 0;
+    size_t bufferedBytes = 0;
+};
+
+/// Hashes size bytes read from the stream at its current position.
+/// Returns false when the stream ends early.
+static bool hashStreamBytes(juce::InputStream& stream, juce::int64 size, std::vector<char>& chunk, XxHash64& hasher)
+{
+    while (size > 0) {
+        const auto toRead = static_cast<int>(std::min<juce::int64>(size, static_cast<juce::int64>(chunk.size())));
+
+        if (stream.read(chunk.data(), toRead) != toRead) {
+            return false;
+        }
+
+        hasher.update(chunk.data(), static_cast<size_t>(toRead));
+        size -= toRead;
+    }
+
+    return true;
+}
+
+/// Fingerprints the stream from its start in the given mode, naming the source in log messages.
+static juce::String hashStream(
+    juce::InputStream& stream,
+    const AudioFingerprintMode mode,
+    const juce::String& sourceName
+)
+{
+    const auto fileSize = stream.getTotalLength();
+    XxHash64 hasher;
+    hasher.update(static_cast<juce::uint64>(fileSize));
+
+    bool readOk = false;
+
+    switch (mode) {
+        case AudioFingerprintMode::fast: {
+            std::vector<char> chunk(static_cast<size_t>(FileFingerprint::sampledBytes));
+
+            // Files shorter than both samples together are hashed once, in full.
+            if (fileSize <= 2 * FileFingerprint::sampledBytes) {
+                readOk = hashStreamBytes(stream, fileSize, chunk, hasher);
+            } else {
+                readOk = hashStreamBytes(stream, FileFingerprint::sampledBytes, chunk, hasher)
+                    && stream.setPosition(fileSize - FileFingerprint::sampledBytes)
+                    && hashStreamBytes(stream, FileFingerprint::sampledBytes, chunk, hasher);
+            }
+
+            break;
+        }
+        case AudioFingerprintMode::full: {
+            std::vector<char> chunk(static_cast<size_t>(readChunkBytes));
+            readOk = hashStreamBytes(stream, fileSize, chunk, hasher);
+            break;
+        }
+        case AudioFingerprintMode::none:
+        default:
+            return {};
+    }
+
+    if (!readOk) {
+        utils::logDebug("Cannot fingerprint {}: the file ended early", sourceName.quoted());
+        return {};
+    }
+
+    return utils::format("{}:{:016x}", FileFingerprint::getModeName(mode), hasher.digest());
+}
+}  // namespace audiobatch::fingerprint
+
+using namespace audiobatch::fingerprint;
+
+juce::String FileFingerprint::compute(const juce::File& file, const AudioFingerprintMode mode)
+{
+    if (mode == AudioFingerprintMode::none) {
+        return {};
+    }
+
+    juce::FileInputStream stream(file);
+
+    if (!stream.openedOk()) {
+        utils::logDebug(
+            "Cannot fingerprint {}: {}", file.getFullPathName().quoted(), stream.getStatus().getErrorMessage()
+        );
+        return {};
+    }
+
+    return hashStream(stream, mode, file.getFullPathName());
+}
+
+juce::String FileFingerprint::compute(
+    const juce::File& file,
+    const juce::MemoryBlock& fileData,
+    const AudioFingerprintMode mode
+)
+{
+    if (mode == AudioFingerprintMode::none) {
+        return {};
+    }
+
+    juce::MemoryInputStream stream(fileData, false);
+    return hashStream(stream, mode, file.getFullPathName());
+}
+
+juce::uint64 FileFingerprint::hash(const void* data, const size_t numBytes, const juce::uint64 seed)
+{
+    XxHash64 hasher(seed);
+    hasher.update(data, numBytes);
+    return hasher.digest();
+}
+
+juce::String FileFingerprint::getModeName(const AudioFingerprintMode mode)
+{
+    switch (mode) {
+        case AudioFingerprintMode::none:
+            return "none";
+        case AudioFingerprintMode::fast:
+            return "fast";
+        case AudioFingerprintMode::full:
+        default:
+            return "full";
+    }
+}
+
+std::optional<AudioFingerprintMode> FileFingerprint::parseModeName(const juce::String& name)
+{
+    const auto normalizedName = name.trim().toLowerCase();
+
+    for (const auto mode : {AudioFingerprintMode::none, AudioFingerprintMode::fast, AudioFingerprintMode::full}) {
+        if (normalizedName == getModeName(mode)) {
+            return mode;
+        }
+    }
+
+    return std::nullopt;
+}
+
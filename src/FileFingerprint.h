@@ -0,0 +1,39 @@
+/// Content fingerprints for recognizing audio files after they move, are renamed, or get new timestamps.
+/// FileFingerprint hashes file contents with XXH64, either sampled from the head and tail of the file
+/// or over every byte, and tags the result with the mode so fingerprints of different modes never match.
+
+#pragma once
+
+#include "AudioAnalysisTypes.h"
+
+#include <JuceHeader.h>
+
+#include <optional>
+
+/// Stateless content fingerprinting helpers.
+class FileFingerprint
+{
+public:
+    /// Bytes hashed from each end of the file by the fast mode.
+    static constexpr int sampledBytes = 64 * 1024;
+
+    /// Returns the fingerprint of the file's contents in the given mode, such as "fast:0123456789abcdef",
+    /// or an empty string for AudioFingerprintMode::none or when the file cannot be read.
+    /// The fast mode hashes the file size with the first and last sampledBytes bytes,
+    /// so its cost does not depend on the file length.
+    static juce::String compute(const juce::File& file, AudioFingerprintMode mode);
+
+    /// Returns the same fingerprint as compute(file, mode) from the file's bytes already read into memory.
+    /// The file only names the source in log messages.
+    static juce::String compute(const juce::File& file, const juce::MemoryBlock& fileData, AudioFingerprintMode mode);
+
+    /// Returns the XXH64 digest of the bytes with the given seed.
+    /// Fingerprints are this hash over the file size, as 8 little-endian bytes, followed by the hashed contents.
+    static juce::uint64 hash(const void* data, size_t numBytes, juce::uint64 seed = 0);
+
+    /// Returns the name used for the mode on the command line.
+    static juce::String getModeName(AudioFingerprintMode mode);
+
+    /// Parses a mode name as returned by getModeName, ignoring case and surrounding whitespace.
+    static std::optional<AudioFingerprintMode> parseModeName(const juce::String& name);
+};
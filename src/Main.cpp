@@ -25,6 +25,9 @@ enum MenuItemId {
     editChainMenuItemId,
     clearChainMenuItemId,
     scanPluginsMenuItemId,
+    peakOnlyProfileMenuItemId,
+    peakAndLoudnessProfileMenuItemId,
+    fullProfileMenuItemId,
 };
 }  // namespace audiobatch::app
 
@@ -159,6 +162,8 @@ private:
             case 2:
                 appendPluginOptionsMenuItems(menu);
                 menu.addSeparator();
+                appendAnalysisProfileMenuItems(menu);
+                menu.addSeparator();
                 menu.addItem(audioSettingsMenuItemId, "Audio Settings...");
                 break;
             case 3:
@@ -187,6 +192,8 @@ private:
             case 1:
                 appendPluginOptionsMenuItems(menu);
                 menu.addSeparator();
+                appendAnalysisProfileMenuItems(menu);
+                menu.addSeparator();
                 menu.addItem(audioSettingsMenuItemId, "Audio Settings...");
                 break;
             case 2:
@@ -267,6 +274,15 @@ private:
                     chain->showScanWindow();
                 }
                 break;
+            case peakOnlyProfileMenuItemId:
+                getAudioBatch().setAnalysisProfile(AudioAnalysisProfile::peakOnly);
+                break;
+            case peakAndLoudnessProfileMenuItemId:
+                getAudioBatch().setAnalysisProfile(AudioAnalysisProfile::peakAndLoudness);
+                break;
+            case fullProfileMenuItemId:
+                getAudioBatch().setAnalysisProfile(AudioAnalysisProfile::full);
+                break;
             default:
                 handlePluginChoiceMenuItem(menuItemID);
                 break;
@@ -296,6 +312,22 @@ private:
         menu.addItem(scanPluginsMenuItemId, "Scan for Plugins...");
     }
 
+    /// Appends the analysis profile choices, ticking the active one.
+    void appendAnalysisProfileMenuItems(juce::PopupMenu& menu) const
+    {
+        const auto profile = getAudioBatch().getAnalysisProfile();
+
+        menu.addSectionHeader("Analysis Profile");
+        menu.addItem(peakOnlyProfileMenuItemId, "Sample Peak Only", true, profile == AudioAnalysisProfile::peakOnly);
+        menu.addItem(
+            peakAndLoudnessProfileMenuItemId,
+            "Sample Peak and Loudness",
+            true,
+            profile == AudioAnalysisProfile::peakAndLoudness
+        );
+        menu.addItem(fullProfileMenuItemId, "Full (with True Peak)", true, profile == AudioAnalysisProfile::full);
+    }
+
     /// Decodes a menu result against the known plugin list and appends the chosen plugin to the chain.
     void handlePluginChoiceMenuItem(const int menuItemID) const
     {
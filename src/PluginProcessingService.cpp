@@ -18,7 +18,6 @@
 
 namespace audiobatch::plugin_processing
 {
-constexpr int processingBlockSize = 1024;
 constexpr int outputBitsPerSample = 16;
 constexpr auto outputExtension = ".aiff";
 
@@ -79,7 +78,12 @@ static int clampChannelCount(const int channels)
 /// We preserve the plugin's existing bus count and only override the main bus channel set,
 /// because some plugins have sidechain or aux buses that should be left alone.
 /// If that fails we fall back through several common configurations.
-static bool configurePluginChannels(juce::AudioPluginInstance& plugin, const int numChannels, const double sampleRate)
+static bool configurePluginChannels(
+    juce::AudioPluginInstance& plugin,
+    const int numChannels,
+    const double sampleRate,
+    const int blockSize
+)
 {
     auto trySetMainBusChannels = [&plugin](const juce::AudioChannelSet& channelSet) {
         auto layout = plugin.getBusesLayout();
@@ -116,7 +120,7 @@ static bool configurePluginChannels(juce::AudioPluginInstance& plugin, const int
     if (!layoutConfigured && numChannels <= 2) {
         // Last resort: ask the processor to accept the channel counts directly.
         // Some plugins do not honor setBusesLayout but still process correctly if play config details are set.
-        plugin.setPlayConfigDetails(numChannels, numChannels, sampleRate, processingBlockSize);
+        plugin.setPlayConfigDetails(numChannels, numChannels, sampleRate, blockSize);
         layoutConfigured
             = plugin.getTotalNumInputChannels() >= numChannels && plugin.getTotalNumOutputChannels() >= numChannels;
     }
@@ -177,7 +181,9 @@ PluginProcessingResult PluginProcessingService::processFile(
     }
 
     auto& formatManager = getThreadLocalFormatManager();
-    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+    const auto ioSettings = AudioAnalysisService::getIoSettings(file);
+    const auto processingBlockSize = ioSettings.processingBlockSize;
+    auto reader = AudioAnalysisService::createReader(formatManager, file, ioSettings);
 
     if (reader == nullptr) {
         return fail(file, "Unsupported or unreadable audio file");
@@ -234,7 +240,7 @@ PluginProcessingResult PluginProcessingService::processFile(
     for (std::size_t pluginIndex = 0; pluginIndex < chainInstances.size(); ++pluginIndex) {
         auto* plugin = chainInstances[pluginIndex];
 
-        if (!configurePluginChannels(*plugin, numChannels, sampleRate)) {
+        if (!configurePluginChannels(*plugin, numChannels, sampleRate, processingBlockSize)) {
             writer.reset();
             utils::deleteFile(temporaryFile.getFile());
             return fail(
@@ -329,6 +335,9 @@ PluginProcessingResult PluginProcessingService::processFile(
     }
 
     writer.reset();
+    // Release the source before the output replaces it, since a memory-mapped reader keeps the file mapped.
+    reader.reset();
+
     for (auto* plugin : chainInstances) {
         plugin->releaseResources();
     }
@@ -0,0 +1,543 @@
+/// Implementation of SamplePeakScanner.
+/// Each kernel keeps vector accumulators that use the same "replace only when strictly smaller or larger"
+/// comparison as the scalar reference, so NaN samples are skipped identically on every path,
+/// then folds the lanes and finishes the unaligned tail with the scalar loop.
+/// The stereo interleave kernels build the frame layout from the registers already loaded for the peak scan,
+/// so each sample is read from memory only once.
+/// The kernel is chosen once from the compiled-in instruction sets and the CPU feature flags.
+
+#include "SamplePeakScanner.h"
+
+#include "utils.h"
+
+#include <algorithm>
+#include <array>
+
+#if JUCE_INTEL
+#include <immintrin.h>
+#endif
+
+#if JUCE_ARM && (defined(__ARM_NEON) || defined(_M_ARM64))
+#include <arm_neon.h>
+#define AUDIOBATCH_HAS_NEON 1
+#else
+#define AUDIOBATCH_HAS_NEON 0
+#endif
+
+// GCC and Clang only emit AVX2 instructions inside functions that opt in to the target,
+// while MSVC accepts the intrinsics anywhere.
+#if JUCE_INTEL && (defined(__GNUC__) || defined(__clang__))
+#define AUDIOBATCH_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define AUDIOBATCH_TARGET_AVX2
+#endif
+
+/// Block min/max kernels for each supported instruction set.
+namespace audiobatch::peak
+{
+using ExtremaKernel = void (*)(const float*, int, float&, float&);
+using StereoInterleaveKernel = void (*)(const float*, const float*, int, float*, float*, float*);
+
+/// Reference implementation that every vector kernel must match.
+/// std::min and std::max keep the running value unless the sample compares strictly smaller or larger,
+/// so NaN samples never replace it.
+static void updateExtremaScalar(const float* samples, const int numSamples, float& minimum, float& maximum)
+{
+    auto runningMinimum = minimum;
+    auto runningMaximum = maximum;
+
+    for (int index = 0; index < numSamples; ++index) {
+        runningMinimum = std::min(runningMinimum, samples[index]);
+        runningMaximum = std::max(runningMaximum, samples[index]);
+    }
+
+    minimum = runningMinimum;
+    maximum = runningMaximum;
+}
+
+/// Reference implementation of the fused stereo pass.
+/// Writes left/right sample pairs and updates both channels' extremes in one traversal.
+static void interleaveStereoWithExtremaScalar(
+    const float* left,
+    const float* right,
+    const int numSamples,
+    float* interleaved,
+    float* minimums,
+    float* maximums
+)
+{
+    for (int index = 0; index < numSamples; ++index) {
+        const auto leftSample = left[index];
+        const auto rightSample = right[index];
+        minimums[0] = std::min(minimums[0], leftSample);
+        maximums[0] = std::max(maximums[0], leftSample);
+        minimums[1] = std::min(minimums[1], rightSample);
+        maximums[1] = std::max(maximums[1], rightSample);
+        interleaved[2 * index] = leftSample;
+        interleaved[2 * index + 1] = rightSample;
+    }
+}
+
+/// Folds the vector lanes into the running extremes with the scalar comparison.
+template<std::size_t LaneCount>
+static void foldLanes(
+    const std::array<float, LaneCount>& minimumLanes,
+    const std::array<float, LaneCount>& maximumLanes,
+    float& minimum,
+    float& maximum
+)
+{
+    for (std::size_t lane = 0; lane < LaneCount; ++lane) {
+        minimum = std::min(minimum, minimumLanes[lane]);
+        maximum = std::max(maximum, maximumLanes[lane]);
+    }
+}
+
+#if JUCE_INTEL
+/// SSE kernel with two independent accumulator pairs to hide the min/max latency.
+/// _mm_min_ps(sample, running) returns the running value unless sample < running,
+/// which is exactly the std::min(running, sample) behaviour of the scalar reference.
+static void updateExtremaSse(const float* samples, const int numSamples, float& minimum, float& maximum)
+{
+    constexpr int samplesPerIteration = 8;
+    auto minimumA = _mm_set1_ps(minimum);
+    auto minimumB = minimumA;
+    auto maximumA = _mm_set1_ps(maximum);
+    auto maximumB = maximumA;
+    int index = 0;
+
+    for (; index + samplesPerIteration <= numSamples; index += samplesPerIteration) {
+        const auto first = _mm_loadu_ps(samples + index);
+        const auto second = _mm_loadu_ps(samples + index + 4);
+        minimumA = _mm_min_ps(first, minimumA);
+        maximumA = _mm_max_ps(first, maximumA);
+        minimumB = _mm_min_ps(second, minimumB);
+        maximumB = _mm_max_ps(second, maximumB);
+    }
+
+    std::array<float, 4> minimumLanes {};
+    std::array<float, 4> maximumLanes {};
+    _mm_storeu_ps(minimumLanes.data(), _mm_min_ps(minimumB, minimumA));
+    _mm_storeu_ps(maximumLanes.data(), _mm_max_ps(maximumB, maximumA));
+    foldLanes(minimumLanes, maximumLanes, minimum, maximum);
+
+    updateExtremaScalar(samples + index, numSamples - index, minimum, maximum);
+}
+
+/// AVX2 kernel, the 256-bit version of the SSE kernel.
+static AUDIOBATCH_TARGET_AVX2 void updateExtremaAvx2(
+    const float* samples,
+    const int numSamples,
+    float& minimum,
+    float& maximum
+)
+{
+    constexpr int samplesPerIteration = 16;
+    auto minimumA = _mm256_set1_ps(minimum);
+    auto minimumB = minimumA;
+    auto maximumA = _mm256_set1_ps(maximum);
+    auto maximumB = maximumA;
+    int index = 0;
+
+    for (; index + samplesPerIteration <= numSamples; index += samplesPerIteration) {
+        const auto first = _mm256_loadu_ps(samples + index);
+        const auto second = _mm256_loadu_ps(samples + index + 8);
+        minimumA = _mm256_min_ps(first, minimumA);
+        maximumA = _mm256_max_ps(first, maximumA);
+        minimumB = _mm256_min_ps(second, minimumB);
+        maximumB = _mm256_max_ps(second, maximumB);
+    }
+
+    std::array<float, 8> minimumLanes {};
+    std::array<float, 8> maximumLanes {};
+    _mm256_storeu_ps(minimumLanes.data(), _mm256_min_ps(minimumB, minimumA));
+    _mm256_storeu_ps(maximumLanes.data(), _mm256_max_ps(maximumB, maximumA));
+    foldLanes(minimumLanes, maximumLanes, minimum, maximum);
+
+    updateExtremaScalar(samples + index, numSamples - index, minimum, maximum);
+}
+
+/// SSE version of the fused stereo pass.
+/// The unpack instructions build the interleaved frames from the same registers the extremes are taken from.
+static void interleaveStereoWithExtremaSse(
+    const float* left,
+    const float* right,
+    const int numSamples,
+    float* interleaved,
+    float* minimums,
+    float* maximums
+)
+{
+    constexpr int samplesPerIteration = 4;
+    auto leftMinimum = _mm_set1_ps(minimums[0]);
+    auto leftMaximum = _mm_set1_ps(maximums[0]);
+    auto rightMinimum = _mm_set1_ps(minimums[1]);
+    auto rightMaximum = _mm_set1_ps(maximums[1]);
+    int index = 0;
+
+    for (; index + samplesPerIteration <= numSamples; index += samplesPerIteration) {
+        const auto leftSamples = _mm_loadu_ps(left + index);
+        const auto rightSamples = _mm_loadu_ps(right + index);
+        leftMinimum = _mm_min_ps(leftSamples, leftMinimum);
+        leftMaximum = _mm_max_ps(leftSamples, leftMaximum);
+        rightMinimum = _mm_min_ps(rightSamples, rightMinimum);
+        rightMaximum = _mm_max_ps(rightSamples, rightMaximum);
+        _mm_storeu_ps(interleaved + 2 * index, _mm_unpacklo_ps(leftSamples, rightSamples));
+        _mm_storeu_ps(interleaved + 2 * index + 4, _mm_unpackhi_ps(leftSamples, rightSamples));
+    }
+
+    std::array<float, 4> minimumLanes {};
+    std::array<float, 4> maximumLanes {};
+    _mm_storeu_ps(minimumLanes.data(), leftMinimum);
+    _mm_storeu_ps(maximumLanes.data(), leftMaximum);
+    foldLanes(minimumLanes, maximumLanes, minimums[0], maximums[0]);
+    _mm_storeu_ps(minimumLanes.data(), rightMinimum);
+    _mm_storeu_ps(maximumLanes.data(), rightMaximum);
+    foldLanes(minimumLanes, maximumLanes, minimums[1], maximums[1]);
+
+    interleaveStereoWithExtremaScalar(
+        left + index, right + index, numSamples - index, interleaved + 2 * index, minimums, maximums
+    );
+}
+
+/// AVX2 version of the fused stereo pass.
+/// The 256-bit unpacks work within 128-bit halves, so a cross-lane permute restores frame order.
+static AUDIOBATCH_TARGET_AVX2 void interleaveStereoWithExtremaAvx2(
+    const float* left,
+    const float* right,
+    const int numSamples,
+    float* interleaved,
+    float* minimums,
+    float* maximums
+)
+{
+    constexpr int samplesPerIteration = 8;
+    auto leftMinimum = _mm256_set1_ps(minimums[0]);
+    auto leftMaximum = _mm256_set1_ps(maximums[0]);
+    auto rightMinimum = _mm256_set1_ps(minimums[1]);
+    auto rightMaximum = _mm256_set1_ps(maximums[1]);
+    int index = 0;
+
+    for (; index + samplesPerIteration <= numSamples; index += samplesPerIteration) {
+        const auto leftSamples = _mm256_loadu_ps(left + index);
+        const auto rightSamples = _mm256_loadu_ps(right + index);
+        leftMinimum = _mm256_min_ps(leftSamples, leftMinimum);
+        leftMaximum = _mm256_max_ps(leftSamples, leftMaximum);
+        rightMinimum = _mm256_min_ps(rightSamples, rightMinimum);
+        rightMaximum = _mm256_max_ps(rightSamples, rightMaximum);
+
+        const auto low = _mm256_unpacklo_ps(leftSamples, rightSamples);
+        const auto high = _mm256_unpackhi_ps(leftSamples, rightSamples);
+        _mm256_storeu_ps(interleaved + 2 * index, _mm256_permute2f128_ps(low, high, 0x20));
+        _mm256_storeu_ps(interleaved + 2 * index + 8, _mm256_permute2f128_ps(low, high, 0x31));
+    }
+
+    std::array<float, 8> minimumLanes {};
+    std::array<float, 8> maximumLanes {};
+    _mm256_storeu_ps(minimumLanes.data(), leftMinimum);
+    _mm256_storeu_ps(maximumLanes.data(), leftMaximum);
+    foldLanes(minimumLanes, maximumLanes, minimums[0], maximums[0]);
+    _mm256_storeu_ps(minimumLanes.data(), rightMinimum);
+    _mm256_storeu_ps(maximumLanes.data(), rightMaximum);
+    foldLanes(minimumLanes, maximumLanes, minimums[1], maximums[1]);
+
+    interleaveStereoWithExtremaScalar(
+        left + index, right + index, numSamples - index, interleaved + 2 * index, minimums, maximums
+    );
+}
+#endif
+
+#if AUDIOBATCH_HAS_NEON
+/// NEON kernel.
+/// vminq_f32 propagates NaN, so the kernel uses compare-and-select to keep the scalar semantics.
+static void updateExtremaNeon(const float* samples, const int numSamples, float& minimum, float& maximum)
+{
+    constexpr int samplesPerIteration = 8;
+    auto minimumA = vdupq_n_f32(minimum);
+    auto minimumB = minimumA;
+    auto maximumA = vdupq_n_f32(maximum);
+    auto maximumB = maximumA;
+    int index = 0;
+
+    for (; index + samplesPerIteration <= numSamples; index += samplesPerIteration) {
+        const auto first = vld1q_f32(samples + index);
+        const auto second = vld1q_f32(samples + index + 4);
+        minimumA = vbslq_f32(vcltq_f32(first, minimumA), first, minimumA);
+        maximumA = vbslq_f32(vcgtq_f32(first, maximumA), first, maximumA);
+        minimumB = vbslq_f32(vcltq_f32(second, minimumB), second, minimumB);
+        maximumB = vbslq_f32(vcgtq_f32(second, maximumB), second, maximumB);
+    }
+
+    std::array<float, 4> minimumLanes {};
+    std::array<float, 4> maximumLanes {};
+    vst1q_f32(minimumLanes.data(), minimumA);
+    vst1q_f32(maximumLanes.data(), maximumA);
+    foldLanes(minimumLanes, maximumLanes, minimum, maximum);
+    vst1q_f32(minimumLanes.data(), minimumB);
+    vst1q_f32(maximumLanes.data(), maximumB);
+    foldLanes(minimumLanes, maximumLanes, minimum, maximum);
+
+    updateExtremaScalar(samples + index, numSamples - index, minimum, maximum);
+}
+
+/// NEON version of the fused stereo pass, using a two-register interleaving store.
+static void interleaveStereoWithExtremaNeon(
+    const float* left,
+    const float* right,
+    const int numSamples,
+    float* interleaved,
+    float* minimums,
+    float* maximums
+)
+{
+    constexpr int samplesPerIteration = 4;
+    auto leftMinimum = vdupq_n_f32(minimums[0]);
+    auto leftMaximum = vdupq_n_f32(maximums[0]);
+    auto rightMinimum = vdupq_n_f32(minimums[1]);
+    auto rightMaximum = vdupq_n_f32(maximums[1]);
+    int index = 0;
+
+    for (; index + samplesPerIteration <= numSamples; index += samplesPerIteration) {
+        float32x4x2_t frames;
+        frames.val[0] = vld1q_f32(left + index);
+        frames.val[1] = vld1q_f32(right + index);
+        leftMinimum = vbslq_f32(vcltq_f32(frames.val[0], leftMinimum), frames.val[0], leftMinimum);
+        leftMaximum = vbslq_f32(vcgtq_f32(frames.val[0], leftMaximum), frames.val[0], leftMaximum);
+        rightMinimum = vbslq_f32(vcltq_f32(frames.val[1], rightMinimum), frames.val[1], rightMinimum);
+        rightMaximum = vbslq_f32(vcgtq_f32(frames.val[1], rightMaximum), frames.val[1], rightMaximum);
+        vst2q_f32(interleaved + 2 * index, frames);
+    }
+
+    std::array<float, 4> minimumLanes {};
+    std::array<float, 4> maximumLanes {};
+    vst1q_f32(minimumLanes.data(), leftMinimum);
+    vst1q_f32(maximumLanes.data(), leftMaximum);
+    foldLanes(minimumLanes, maximumLanes, minimums[0], maximums[0]);
+    vst1q_f32(minimumLanes.data(), rightMinimum);
+    vst1q_f32(maximumLanes.data(), rightMaximum);
+    foldLanes(minimumLanes, maximumLanes, minimums[1], maximums[1]);
+
+    interleaveStereoWithExtremaScalar(
+        left + index, right + index, numSamples - index, interleaved + 2 * index, minimums, maximums
+    );
+}
+#endif
+
+/// Returns the function implementing the given kernel, or the scalar reference when it is not compiled in.
+static ExtremaKernel getKernelFunction(const SamplePeakScanner::Kernel kernel)
+{
+    switch (kernel) {
+        case SamplePeakScanner::Kernel::sse:
+#if JUCE_INTEL
+            return updateExtremaSse;
+#else
+            return updateExtremaScalar;
+#endif
+        case SamplePeakScanner::Kernel::avx2:
+#if JUCE_INTEL
+            return updateExtremaAvx2;
+#else
+            return updateExtremaScalar;
+#endif
+        case SamplePeakScanner::Kernel::neon:
+#if AUDIOBATCH_HAS_NEON
+            return updateExtremaNeon;
+#else
+            return updateExtremaScalar;
+#endif
+        case SamplePeakScanner::Kernel::scalar:
+        default:
+            return updateExtremaScalar;
+    }
+}
+
+/// Returns the fused stereo interleave function for the given kernel,
+/// or the scalar reference when it is not compiled in.
+static StereoInterleaveKernel getStereoInterleaveFunction(const SamplePeakScanner::Kernel kernel)
+{
+    switch (kernel) {
+        case SamplePeakScanner::Kernel::sse:
+#if JUCE_INTEL
+            return interleaveStereoWithExtremaSse;
+#else
+            return interleaveStereoWithExtremaScalar;
+#endif
+        case SamplePeakScanner::Kernel::avx2:
+#if JUCE_INTEL
+            return interleaveStereoWithExtremaAvx2;
+#else
+            return interleaveStereoWithExtremaScalar;
+#endif
+        case SamplePeakScanner::Kernel::neon:
+#if AUDIOBATCH_HAS_NEON
+            return interleaveStereoWithExtremaNeon;
+#else
+            return interleaveStereoWithExtremaScalar;
+#endif
+        case SamplePeakScanner::Kernel::scalar:
+        default:
+            return interleaveStereoWithExtremaScalar;
+    }
+}
+
+/// Interleaves any channel count by scanning each channel with the extrema kernel
+/// and then scattering it into the frame layout.
+/// Used for layouts other than stereo, which this tool does not target for speed.
+static void interleaveWithExtremaGeneric(
+    const ExtremaKernel extremaKernel,
+    const float* const* channels,
+    const int numChannels,
+    const int numSamples,
+    float* interleaved,
+    float* minimums,
+    float* maximums
+)
+{
+    for (int channel = 0; channel < numChannels; ++channel) {
+        const auto* channelSamples = channels[channel];
+        extremaKernel(channelSamples, numSamples, minimums[channel], maximums[channel]);
+
+        for (int index = 0; index < numSamples; ++index) {
+            interleaved[index * numChannels + channel] = channelSamples[index];
+        }
+    }
+}
+
+/// Picks the preferred available kernel once and logs the choice.
+static SamplePeakScanner::Kernel selectKernel()
+{
+    constexpr std::array preferredKernels {
+        SamplePeakScanner::Kernel::avx2,
+        SamplePeakScanner::Kernel::neon,
+        SamplePeakScanner::Kernel::sse,
+    };
+
+    auto selectedKernel = SamplePeakScanner::Kernel::scalar;
+
+    for (const auto kernel : preferredKernels) {
+        if (SamplePeakScanner::isKernelAvailable(kernel)) {
+            selectedKernel = kernel;
+            break;
+        }
+    }
+
+    utils::logDebug("Sample peak scanner using {} kernel", SamplePeakScanner::getKernelName(selectedKernel));
+    return selectedKernel;
+}
+}  // namespace audiobatch::peak
+
+using namespace audiobatch::peak;
+
+bool SamplePeakScanner::isKernelAvailable(const Kernel kernel)
+{
+    switch (kernel) {
+        case Kernel::sse:
+#if JUCE_INTEL
+            return juce::SystemStats::hasSSE2();
+#else
+            return false;
+#endif
+        case Kernel::avx2:
+#if JUCE_INTEL
+            return juce::SystemStats::hasAVX2();
+#else
+            return false;
+#endif
+        case Kernel::neon:
+            return AUDIOBATCH_HAS_NEON != 0;
+        case Kernel::scalar:
+        default:
+            return true;
+    }
+}
+
+SamplePeakScanner::Kernel SamplePeakScanner::getActiveKernel()
+{
+    static const auto activeKernel = selectKernel();
+    return activeKernel;
+}
+
+juce::String SamplePeakScanner::getKernelName(const Kernel kernel)
+{
+    switch (kernel) {
+        case Kernel::sse:
+            return "SSE";
+        case Kernel::avx2:
+            return "AVX2";
+        case Kernel::neon:
+            return "NEON";
+        case Kernel::scalar:
+        default:
+            return "scalar";
+    }
+}
+
+void SamplePeakScanner::updateExtrema(
+    const Kernel kernel,
+    const float* samples,
+    const int numSamples,
+    float& minimum,
+    float& maximum
+)
+{
+    jassert(isKernelAvailable(kernel));
+
+    if (samples == nullptr || numSamples <= 0) {
+        return;
+    }
+
+    getKernelFunction(kernel)(samples, numSamples, minimum, maximum);
+}
+
+void SamplePeakScanner::updateExtrema(const float* samples, const int numSamples, float& minimum, float& maximum)
+{
+    static const auto activeKernelFunction = getKernelFunction(getActiveKernel());
+
+    if (samples == nullptr || numSamples <= 0) {
+        return;
+    }
+
+    activeKernelFunction(samples, numSamples, minimum, maximum);
+}
+
+void SamplePeakScanner::interleaveWithExtrema(
+    const Kernel kernel,
+    const float* const* channels,
+    const int numChannels,
+    const int numSamples,
+    float* interleaved,
+    float* minimums,
+    float* maximums
+)
+{
+    jassert(isKernelAvailable(kernel));
+
+    if (channels == nullptr || numChannels <= 0 || numSamples <= 0) {
+        return;
+    }
+
+    if (numChannels == 2) {
+        getStereoInterleaveFunction(kernel)(channels[0], channels[1], numSamples, interleaved, minimums, maximums);
+        return;
+    }
+
+    interleaveWithExtremaGeneric(
+        getKernelFunction(kernel), channels, numChannels, numSamples, interleaved, minimums, maximums
+    );
+}
+
+void SamplePeakScanner::interleaveWithExtrema(
+    const float* const* channels,
+    const int numChannels,
+    const int numSamples,
+    float* interleaved,
+    float* minimums,
+    float* maximums
+)
+{
+    if (channels == nullptr || numChannels <= 0 || numSamples <= 0) {
+        return;
+    }
+
+    interleaveWithExtrema(getActiveKernel(), channels, numChannels, numSamples, interleaved, minimums, maximums);
+}
@@ -0,0 +1,64 @@
+/// Vectorized sample peak scanning for the analysis pipeline.
+/// SamplePeakScanner updates running per-channel minimum and maximum sample values
+/// over whole blocks of planar audio, using SSE, AVX2, or NEON kernels picked once at runtime
+/// and a scalar fallback that defines the reference behaviour.
+/// It can also interleave the block for the loudness analyzer in the same pass.
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/// Stateless block min/max and interleave kernels with runtime instruction set dispatch.
+class SamplePeakScanner
+{
+public:
+    /// Kernel implementations, in increasing order of preference on their architecture.
+    enum class Kernel {
+        scalar,
+        sse,
+        avx2,
+        neon,
+    };
+
+    /// Updates the running extremes with every sample in the block using the fastest available kernel.
+    /// Matches the scalar reference exactly, including ignoring NaN samples,
+    /// except that a tie between 0.0 and -0.0 may keep either sign.
+    static void updateExtrema(const float* samples, int numSamples, float& minimum, float& maximum);
+
+    /// Updates the running extremes with an explicitly chosen kernel.
+    /// The kernel must be available on this machine.
+    static void updateExtrema(Kernel kernel, const float* samples, int numSamples, float& minimum, float& maximum);
+
+    /// Writes the planar channels into interleaved frames and updates each channel's extremes in the same pass.
+    /// The interleaved destination must hold numChannels * numSamples values,
+    /// and the extremes arrays one value per channel.
+    static void interleaveWithExtrema(
+        const float* const* channels,
+        int numChannels,
+        int numSamples,
+        float* interleaved,
+        float* minimums,
+        float* maximums
+    );
+
+    /// Runs the fused interleave and extremes pass with an explicitly chosen kernel.
+    /// The kernel must be available on this machine.
+    static void interleaveWithExtrema(
+        Kernel kernel,
+        const float* const* channels,
+        int numChannels,
+        int numSamples,
+        float* interleaved,
+        float* minimums,
+        float* maximums
+    );
+
+    /// Returns the kernel selected for this machine by the runtime dispatch.
+    static Kernel getActiveKernel();
+
+    /// Returns true when the kernel was compiled in and the CPU supports it.
+    static bool isKernelAvailable(Kernel kernel);
+
+    /// Returns a short display name for the kernel, used in log output.
+    static juce::String getKernelName(Kernel kernel);
+};
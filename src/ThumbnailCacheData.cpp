@@ -0,0 +1,103 @@
+/// Implementation of ThumbnailCacheData.
+/// Contains the delta filter over min/max frames, the zlib packing around it,
+/// and the check of the unpacked AudioThumbnail header against the number of bytes that follow it.
+
+#include "ThumbnailCacheData.h"
+
+#include <cstring>
+
+/// Delta filtering and header checks for packed thumbnails.
+namespace audiobatch::thumbnail
+{
+/// zlib level used for cache data. Higher levels barely shrink min/max data further but compress slower.
+constexpr int compressionLevel = 1;
+
+/// Offsets of the thumbnail sample count and the channel count in the AudioThumbnail header.
+constexpr size_t numThumbnailSamplesOffset = 24;
+constexpr size_t numChannelsOffset = 28;
+
+/// Replaces each byte with its difference from the byte one stride earlier, in place.
+/// AudioThumbnail stores a min and a max byte per channel per frame, so with a stride of one frame
+/// each byte is compared with the same value of the previous frame, which zlib compresses far better.
+static void encodeDeltas(juce::uint8* bytes, const size_t numBytes, const size_t stride)
+{
+    for (auto index = numBytes; index-- > stride;) {
+        bytes[index] = static_cast<juce::uint8>(bytes[index] - bytes[index - stride]);
+    }
+}
+
+/// Reverses encodeDeltas in place.
+static void decodeDeltas(juce::uint8* bytes, const size_t numBytes, const size_t stride)
+{
+    for (auto index = stride; index < numBytes; ++index) {
+        bytes[index] = static_cast<juce::uint8>(bytes[index] + bytes[index - stride]);
+    }
+}
+
+/// Returns true when the data is a whole AudioThumbnail::saveTo stream.
+/// The zlib stream of a truncated blob just ends early, so its length is what gives it away.
+static bool isCompleteThumbnail(const juce::MemoryBlock& data)
+{
+    if (data.getSize() < ThumbnailCacheData::thumbnailHeaderBytes || std::memcmp(data.getData(), "jatm", 4) != 0) {
+        return false;
+    }
+
+    const auto* bytes = static_cast<const juce::uint8*>(data.getData());
+    const auto numThumbnailSamples
+        = static_cast<juce::int32>(juce::ByteOrder::littleEndianInt(bytes + numThumbnailSamplesOffset));
+    const auto numChannels = static_cast<juce::int32>(juce::ByteOrder::littleEndianInt(bytes + numChannelsOffset));
+
+    if (numThumbnailSamples < 0 || numChannels <= 0) {
+        return false;
+    }
+
+    const auto minMaxBytes = static_cast<juce::int64>(numThumbnailSamples) * numChannels * 2;
+    return static_cast<juce::int64>(data.getSize() - ThumbnailCacheData::thumbnailHeaderBytes) == minMaxBytes;
+}
+}  // namespace audiobatch::thumbnail
+
+using namespace audiobatch::thumbnail;
+
+juce::MemoryBlock ThumbnailCacheData::compress(juce::MemoryBlock thumbnailData, const int numChannels)
+{
+    const auto stride = static_cast<juce::uint8>(juce::jlimit(1, 255, numChannels * 2));
+    encodeDeltas(static_cast<juce::uint8*>(thumbnailData.getData()), thumbnailData.getSize(), stride);
+
+    juce::MemoryBlock packed;
+
+    {
+        juce::MemoryOutputStream output(packed, false);
+        output.writeByte(static_cast<char>(stride));
+        juce::GZIPCompressorOutputStream compressor(output, compressionLevel);
+        compressor.write(thumbnailData.getData(), thumbnailData.getSize());
+    }
+
+    return packed;
+}
+
+juce::MemoryBlock ThumbnailCacheData::decompress(const juce::MemoryBlock& packed)
+{
+    juce::MemoryBlock data;
+
+    if (packed.getSize() < 2) {
+        return data;
+    }
+
+    const auto stride = static_cast<size_t>(static_cast<const juce::uint8*>(packed.getData())[0]);
+
+    if (stride == 0) {
+        return data;
+    }
+
+    juce::MemoryInputStream input(packed.begin() + 1, packed.getSize() - 1, false);
+    juce::GZIPDecompressorInputStream decompressor(input);
+    decompressor.readIntoMemoryBlock(data);
+
+    decodeDeltas(static_cast<juce::uint8*>(data.getData()), data.getSize(), stride);
+
+    if (!isCompleteThumbnail(data)) {
+        data.reset();
+    }
+
+    return data;
+}
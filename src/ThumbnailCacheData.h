@@ -0,0 +1,28 @@
+/// Compact storage format for waveform previews in the analysis cache.
+/// ThumbnailCacheData packs the data written by juce::AudioThumbnail::saveTo
+/// as a stride byte followed by zlib-compressed frame deltas, and unpacks and validates it again,
+/// so a truncated or corrupted cache blob is rejected instead of loading as a partial waveform.
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/// Stateless packing of serialized thumbnails.
+class ThumbnailCacheData
+{
+public:
+    /// Size of the header AudioThumbnail::saveTo writes before the min/max bytes:
+    /// the "jatm" tag, the samples per thumbnail sample, the total and finished sample counts,
+    /// the thumbnail sample and channel counts, the sample rate, and 16 reserved bytes, all little-endian.
+    static constexpr size_t thumbnailHeaderBytes = 52;
+
+    /// Packs data written by AudioThumbnail::saveTo.
+    /// Each byte is stored as its difference from the same channel's min or max byte in the previous frame,
+    /// then the result is compressed with zlib.
+    static juce::MemoryBlock compress(juce::MemoryBlock thumbnailData, int numChannels);
+
+    /// Unpacks data written by compress.
+    /// Returns an empty block unless the result is a complete AudioThumbnail::saveTo stream:
+    /// it must start with the tag and hold exactly the min/max bytes its header declares.
+    static juce::MemoryBlock decompress(const juce::MemoryBlock& packed);
+};
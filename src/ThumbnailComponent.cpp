@@ -1,5 +1,5 @@
 /// Implementation of the ThumbnailComponent waveform preview.
-/// Covers waveform painting and cache load and save,
+/// Covers waveform painting, cache load and save through ThumbnailCacheData,
 /// transport scrubbing through the mouse handlers,
 /// wheel-based zoom and gain gestures,
 /// and the timer-driven position marker updates during playback.
@@ -7,6 +7,7 @@
 #include "ThumbnailComponent.h"
 
 #include "CustomLookAndFeel.h"
+#include "ThumbnailCacheData.h"
 
 #include <JuceHeader.h>
 
@@ -56,7 +57,10 @@ bool ThumbnailComponent::loadFromCacheData(const juce::MemoryBlock& waveformData
         return false;
     }
 
-    if (juce::MemoryInputStream input(waveformData, false); !thumbnail.loadFrom(input)) {
+    const auto thumbnailData = ThumbnailCacheData::decompress(waveformData);
+    juce::MemoryInputStream input(thumbnailData, false);
+
+    if (thumbnailData.isEmpty() || !thumbnail.loadFrom(input)) {
         visibleRange = {};
         stopTimer();
         repaint();
@@ -91,9 +95,12 @@ juce::MemoryBlock ThumbnailComponent::saveToCacheData() const
         return waveformData;
     }
 
-    juce::MemoryOutputStream output(waveformData, false);
-    thumbnail.saveTo(output);
-    return waveformData;
+    {
+        juce::MemoryOutputStream output(waveformData, false);
+        thumbnail.saveTo(output);
+    }
+
+    return ThumbnailCacheData::compress(std::move(waveformData), thumbnail.getNumChannels());
 }
 
 void ThumbnailComponent::setThumbnailFullyLoadedCallback(std::function<void()> callback)
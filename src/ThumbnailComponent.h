@@ -65,9 +65,10 @@ public:
     void resized() override;
 
     /// Restores a previously cached waveform without re-reading the audio file.
+    /// Unpacks data written by saveToCacheData, and fails on truncated or corrupted data.
     bool loadFromCacheData(const juce::MemoryBlock& waveformData);
 
-    /// Serializes the current waveform so it can be stored in the cache.
+    /// Serializes the current waveform so it can be stored in the cache, packed by ThumbnailCacheData.
     juce::MemoryBlock saveToCacheData() const;
 
     /// Sets the visible time range for the waveform viewport.
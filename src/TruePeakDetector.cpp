@@ -0,0 +1,366 @@
+/// Implementation of TruePeakDetector.
+/// Builds the same 49-tap Hann-windowed sinc interpolator as libebur128 and splits it into polyphase filters.
+/// The kernels vectorize across consecutive input samples:
+/// every lane computes one output position, so each tap is a broadcast coefficient times an unaligned load.
+/// The scalar kernel defines the reference behaviour, and the unit tests compare the vector kernels against it.
+
+#include "TruePeakDetector.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numbers>
+
+#if JUCE_INTEL
+#include <immintrin.h>
+#endif
+
+#if JUCE_ARM && (defined(__ARM_NEON) || defined(_M_ARM64))
+#include <arm_neon.h>
+#define AUDIOBATCH_HAS_NEON 1
+#else
+#define AUDIOBATCH_HAS_NEON 0
+#endif
+
+#if JUCE_INTEL && (defined(__GNUC__) || defined(__clang__))
+#define AUDIOBATCH_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define AUDIOBATCH_TARGET_AVX2
+#endif
+
+/// Filter design and interpolation kernels for each supported instruction set.
+namespace audiobatch::true_peak
+{
+constexpr int interpolatorTaps = 49;
+constexpr double negligibleCoefficient = 0.000001;
+
+/// Returns the largest absolute value of the interpolated phases over numSamples input positions.
+/// work points at tapsPerPhase - 1 history samples followed by the new samples,
+/// and coefficients holds phaseCount filters of tapsPerPhase taps each, newest sample first.
+using InterpolationKernel = float (*)(const float*, int, const float*, int, int);
+
+/// Returns the oversampling factor libebur128 uses for the sample rate.
+static int oversamplingFactorForSampleRate(const int sampleRate)
+{
+    if (sampleRate < 96000) {
+        return 4;
+    }
+
+    return sampleRate < 192000 ? 2 : 1;
+}
+
+/// Reference implementation that every vector kernel must match.
+static float interpolatePeakScalar(
+    const float* work,
+    const int numSamples,
+    const float* coefficients,
+    const int phaseCount,
+    const int tapsPerPhase
+)
+{
+    const auto* newestSamples = work + tapsPerPhase - 1;
+    float peak = 0.0f;
+
+    for (int index = 0; index < numSamples; ++index) {
+        for (int phase = 0; phase < phaseCount; ++phase) {
+            const auto* phaseCoefficients = coefficients + phase * tapsPerPhase;
+            float sum = 0.0f;
+
+            for (int tap = 0; tap < tapsPerPhase; ++tap) {
+                sum += phaseCoefficients[tap] * newestSamples[index - tap];
+            }
+
+            peak = std::max(peak, std::abs(sum));
+        }
+    }
+
+    return peak;
+}
+
+/// Folds the vector lanes into the running peak with the scalar comparison.
+template<std::size_t LaneCount>
+static float foldLanes(const std::array<float, LaneCount>& peakLanes, const float peak)
+{
+    auto result = peak;
+
+    for (const auto lanePeak : peakLanes) {
+        result = std::max(result, lanePeak);
+    }
+
+    return result;
+}
+
+#if JUCE_INTEL
+/// SSE kernel computing four output positions per phase at a time.
+/// _mm_max_ps(value, running) keeps the running peak when the value is NaN, like the scalar std::max.
+static float interpolatePeakSse(
+    const float* work,
+    const int numSamples,
+    const float* coefficients,
+    const int phaseCount,
+    const int tapsPerPhase
+)
+{
+    constexpr int samplesPerIteration = 4;
+    const auto* newestSamples = work + tapsPerPhase - 1;
+    const auto signMask = _mm_set1_ps(-0.0f);
+    auto peaks = _mm_setzero_ps();
+    int index = 0;
+
+    for (; index + samplesPerIteration <= numSamples; index += samplesPerIteration) {
+        for (int phase = 0; phase < phaseCount; ++phase) {
+            const auto* phaseCoefficients = coefficients + phase * tapsPerPhase;
+            auto sums = _mm_setzero_ps();
+
+            for (int tap = 0; tap < tapsPerPhase; ++tap) {
+                const auto samples = _mm_loadu_ps(newestSamples + index - tap);
+                sums = _mm_add_ps(sums, _mm_mul_ps(_mm_load1_ps(phaseCoefficients + tap), samples));
+            }
+
+            peaks = _mm_max_ps(_mm_andnot_ps(signMask, sums), peaks);
+        }
+    }
+
+    std::array<float, 4> peakLanes {};
+    _mm_storeu_ps(peakLanes.data(), peaks);
+    const auto tailPeak
+        = interpolatePeakScalar(work + index, numSamples - index, coefficients, phaseCount, tapsPerPhase);
+    return foldLanes(peakLanes, tailPeak);
+}
+
+/// AVX2 kernel, the 256-bit version of the SSE kernel.
+static AUDIOBATCH_TARGET_AVX2 float interpolatePeakAvx2(
+    const float* work,
+    const int numSamples,
+    const float* coefficients,
+    const int phaseCount,
+    const int tapsPerPhase
+)
+{
+    constexpr int samplesPerIteration = 8;
+    const auto* newestSamples = work + tapsPerPhase - 1;
+    const auto signMask = _mm256_set1_ps(-0.0f);
+    auto peaks = _mm256_setzero_ps();
+    int index = 0;
+
+    for (; index + samplesPerIteration <= numSamples; index += samplesPerIteration) {
+        for (int phase = 0; phase < phaseCount; ++phase) {
+            const auto* phaseCoefficients = coefficients + phase * tapsPerPhase;
+            auto sums = _mm256_setzero_ps();
+
+            for (int tap = 0; tap < tapsPerPhase; ++tap) {
+                const auto samples = _mm256_loadu_ps(newestSamples + index - tap);
+                sums = _mm256_add_ps(sums, _mm256_mul_ps(_mm256_broadcast_ss(phaseCoefficients + tap), samples));
+            }
+
+            peaks = _mm256_max_ps(_mm256_andnot_ps(signMask, sums), peaks);
+        }
+    }
+
+    std::array<float, 8> peakLanes {};
+    _mm256_storeu_ps(peakLanes.data(), peaks);
+    const auto tailPeak
+        = interpolatePeakScalar(work + index, numSamples - index, coefficients, phaseCount, tapsPerPhase);
+    return foldLanes(peakLanes, tailPeak);
+}
+#endif
+
+#if AUDIOBATCH_HAS_NEON
+/// NEON kernel.
+/// vmaxq_f32 propagates NaN, so the kernel uses compare-and-select to keep the scalar semantics.
+static float interpolatePeakNeon(
+    const float* work,
+    const int numSamples,
+    const float* coefficients,
+    const int phaseCount,
+    const int tapsPerPhase
+)
+{
+    constexpr int samplesPerIteration = 4;
+    const auto* newestSamples = work + tapsPerPhase - 1;
+    auto peaks = vdupq_n_f32(0.0f);
+    int index = 0;
+
+    for (; index + samplesPerIteration <= numSamples; index += samplesPerIteration) {
+        for (int phase = 0; phase < phaseCount; ++phase) {
+            const auto* phaseCoefficients = coefficients + phase * tapsPerPhase;
+            auto sums = vdupq_n_f32(0.0f);
+
+            for (int tap = 0; tap < tapsPerPhase; ++tap) {
+                sums = vmlaq_n_f32(sums, vld1q_f32(newestSamples + index - tap), phaseCoefficients[tap]);
+            }
+
+            const auto magnitudes = vabsq_f32(sums);
+            peaks = vbslq_f32(vcgtq_f32(magnitudes, peaks), magnitudes, peaks);
+        }
+    }
+
+    std::array<float, 4> peakLanes {};
+    vst1q_f32(peakLanes.data(), peaks);
+    const auto tailPeak
+        = interpolatePeakScalar(work + index, numSamples - index, coefficients, phaseCount, tapsPerPhase);
+    return foldLanes(peakLanes, tailPeak);
+}
+#endif
+
+/// Returns the function implementing the given kernel, or the scalar reference when it is not compiled in.
+static InterpolationKernel getKernelFunction(const SamplePeakScanner::Kernel kernel)
+{
+    switch (kernel) {
+        case SamplePeakScanner::Kernel::sse:
+#if JUCE_INTEL
+            return interpolatePeakSse;
+#else
+            return interpolatePeakScalar;
+#endif
+        case SamplePeakScanner::Kernel::avx2:
+#if JUCE_INTEL
+            return interpolatePeakAvx2;
+#else
+            return interpolatePeakScalar;
+#endif
+        case SamplePeakScanner::Kernel::neon:
+#if AUDIOBATCH_HAS_NEON
+            return interpolatePeakNeon;
+#else
+            return interpolatePeakScalar;
+#endif
+        case SamplePeakScanner::Kernel::scalar:
+        default:
+            return interpolatePeakScalar;
+    }
+}
+
+/// Designs the interpolator the way libebur128 does and splits it into one filter per output phase,
+/// indexed from the newest input sample. Coefficients below the library's threshold are dropped.
+static std::vector<std::vector<double>> designPolyphaseFilters(const int factor)
+{
+    const auto tapsPerPhase = (interpolatorTaps + factor - 1) / factor;
+    std::vector phases(static_cast<size_t>(factor), std::vector(static_cast<size_t>(tapsPerPhase), 0.0));
+
+    for (int tap = 0; tap < interpolatorTaps; ++tap) {
+        const auto offset = static_cast<double>(tap) - static_cast<double>(interpolatorTaps - 1) / 2.0;
+        auto coefficient = 1.0;
+
+        if (std::abs(offset) > negligibleCoefficient) {
+            const auto phaseOffset = offset * std::numbers::pi / factor;
+            coefficient = std::sin(phaseOffset) / phaseOffset;
+        }
+
+        coefficient *= 0.5 * (1.0 - std::cos(2.0 * std::numbers::pi * tap / (interpolatorTaps - 1)));
+
+        if (std::abs(coefficient) > negligibleCoefficient) {
+            phases[static_cast<size_t>(tap % factor)][static_cast<size_t>(tap / factor)] = coefficient;
+        }
+    }
+
+    return phases;
+}
+
+/// Returns true when the phase filter only delays the input,
+/// so its output peaks are the sample peaks and need no interpolation.
+static bool isPureDelay(const std::vector<double>& phase)
+{
+    const auto nonZeroTaps = std::ranges::count_if(phase, [](const double value) { return value != 0.0; });
+    return nonZeroTaps == 1 && std::ranges::find(phase, 1.0) != phase.end();
+}
+}  // namespace audiobatch::true_peak
+
+using namespace audiobatch::true_peak;
+
+TruePeakDetector::TruePeakDetector(const int numChannels, const int sampleRate) :
+    oversamplingFactor(oversamplingFactorForSampleRate(sampleRate)),
+    histories(static_cast<size_t>(juce::jmax(0, numChannels)))
+{
+    std::vector<std::vector<double>> interpolatingPhases;
+
+    for (auto& phase : designPolyphaseFilters(oversamplingFactor)) {
+        if (!isPureDelay(phase)) {
+            interpolatingPhases.push_back(std::move(phase));
+        }
+    }
+
+    // Trailing zero taps are trimmed, so the history only keeps the samples the filters read.
+    for (const auto& phase : interpolatingPhases) {
+        const auto lastTap
+            = std::find_if(phase.rbegin(), phase.rend(), [](const double value) { return value != 0.0; });
+        tapsPerPhase = std::max(tapsPerPhase, static_cast<int>(phase.rend() - lastTap));
+    }
+
+    for (const auto& phase : interpolatingPhases) {
+        for (int tap = 0; tap < tapsPerPhase; ++tap) {
+            coefficients.push_back(static_cast<float>(phase[static_cast<size_t>(tap)]));
+        }
+    }
+
+    historyLength = juce::jmax(0, tapsPerPhase - 1);
+    reset();
+}
+
+void TruePeakDetector::prepare(const int numChannels, const int sampleRate)
+{
+    if (oversamplingFactorForSampleRate(sampleRate) != oversamplingFactor
+        || static_cast<size_t>(juce::jmax(0, numChannels)) != histories.size())
+    {
+        *this = TruePeakDetector(numChannels, sampleRate);
+        return;
+    }
+
+    reset();
+}
+
+void TruePeakDetector::reset()
+{
+    for (auto& history : histories) {
+        history.assign(static_cast<size_t>(historyLength), 0.0f);
+    }
+}
+
+float TruePeakDetector::processChannel(
+    const SamplePeakScanner::Kernel kernel,
+    const int channel,
+    const float* samples,
+    const int numSamples
+)
+{
+    auto& history = histories[static_cast<size_t>(channel)];
+    const auto workLength = static_cast<size_t>(historyLength + numSamples);
+
+    if (workBuffer.size() < workLength) {
+        workBuffer.resize(workLength);
+    }
+
+    std::ranges::copy(history, workBuffer.begin());
+    std::copy(samples, samples + numSamples, workBuffer.begin() + historyLength);
+
+    const auto phaseCount = static_cast<int>(coefficients.size()) / tapsPerPhase;
+    const auto interpolate = getKernelFunction(kernel);
+    const auto peak = interpolate(workBuffer.data(), numSamples, coefficients.data(), phaseCount, tapsPerPhase);
+
+    std::copy(workBuffer.begin() + numSamples, workBuffer.begin() + numSamples + historyLength, history.begin());
+    return peak;
+}
+
+void TruePeakDetector::process(
+    const SamplePeakScanner::Kernel kernel,
+    const float* const* channels,
+    const int numSamples,
+    double* truePeaks
+)
+{
+    jassert(SamplePeakScanner::isKernelAvailable(kernel));
+
+    if (channels == nullptr || numSamples <= 0 || coefficients.empty()) {
+        return;
+    }
+
+    for (size_t channel = 0; channel < histories.size(); ++channel) {
+        const auto peak = processChannel(kernel, static_cast<int>(channel), channels[channel], numSamples);
+        truePeaks[channel] = std::max(truePeaks[channel], static_cast<double>(peak));
+    }
+}
+
+void TruePeakDetector::process(const float* const* channels, const int numSamples, double* truePeaks)
+{
+    process(SamplePeakScanner::getActiveKernel(), channels, numSamples, truePeaks);
+}
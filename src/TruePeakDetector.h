@@ -0,0 +1,61 @@
+/// In-tree ITU-R BS.1770-4 true peak measurement for the analysis pipeline.
+/// TruePeakDetector oversamples planar audio with a polyphase FIR interpolator
+/// and tracks the largest absolute interpolated value per channel.
+/// The filter design matches libebur128, so results agree with its true peak mode,
+/// while the inner loops run on the same SSE, AVX2, or NEON kernels that SamplePeakScanner selects.
+
+#pragma once
+
+#include "SamplePeakScanner.h"
+
+#include <JuceHeader.h>
+
+#include <vector>
+
+/// Polyphase true peak interpolator with per-channel filter history.
+class TruePeakDetector
+{
+public:
+    /// Creates a detector for the channel count and sample rate.
+    /// Oversamples 4x below 96 kHz, 2x below 192 kHz, and not at all above that, like libebur128.
+    TruePeakDetector(int numChannels, int sampleRate);
+
+    /// Returns the oversampling factor chosen for the sample rate.
+    [[nodiscard]] int getOversamplingFactor() const noexcept
+    {
+        return oversamplingFactor;
+    }
+
+    /// Interpolates the next block of planar samples and raises each channel's running true peak,
+    /// given as a linear magnitude, using the fastest available kernel.
+    /// The filter history carries over between calls, so consecutive blocks behave like one stream.
+    ///
+    /// The interpolated output lags the input by half the filter length,
+    /// so the final samples of a stream only reach the peaks through the sample peak,
+    /// which callers fold in the same way libebur128 does.
+    void process(const float* const* channels, int numSamples, double* truePeaks);
+
+    /// Interpolates the next block with an explicitly chosen kernel.
+    /// The kernel must be available on this machine.
+    void process(SamplePeakScanner::Kernel kernel, const float* const* channels, int numSamples, double* truePeaks);
+
+    /// Reconfigures the detector for a new stream with the channel count and sample rate.
+    /// When both match the current setup only the history is cleared, so no memory is allocated.
+    void prepare(int numChannels, int sampleRate);
+
+    /// Clears the filter history, as if the next block started a new stream.
+    void reset();
+
+private:
+    /// Appends the block to the channel's history and returns the interpolated peak of the new samples.
+    float processChannel(SamplePeakScanner::Kernel kernel, int channel, const float* samples, int numSamples);
+
+    int oversamplingFactor = 1;
+    int tapsPerPhase = 0;
+    int historyLength = 0;
+    /// Coefficients of the phases that interpolate between input samples, tapsPerPhase values each.
+    /// The phase that reproduces the input samples is left out, since the sample peak covers it.
+    std::vector<float> coefficients;
+    std::vector<std::vector<float>> histories;
+    std::vector<float> workBuffer;
+};
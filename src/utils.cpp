@@ -1,6 +1,6 @@
 /// Implementation of the utils namespace helpers.
 /// Covers logger creation, moving files to the OS trash with a native fallback on Windows,
-/// file deletion with error logging,
+/// file deletion with error logging, the shared settings file location,
 /// and collecting and formatting system and build information for logs and the About dialog.
 
 #include "utils.h"
@@ -54,6 +54,17 @@ bool deleteFile(const juce::File& file)
     return true;
 }
 
+juce::PropertiesFile::Options settingsFileOptions()
+{
+    juce::PropertiesFile::Options options;
+    options.applicationName = "AudioBatch";
+    options.filenameSuffix = ".settings";
+    options.osxLibrarySubFolder = "Application Support";
+    options.folderName = "AudioBatch";
+    options.storageFormat = juce::PropertiesFile::storeAsXML;
+    return options;
+}
+
 juce::StringArray systemInfo()
 {
     const auto compile_time = juce::Time::getCompilationDate();
@@ -102,6 +102,9 @@ bool moveToTrash(const juce::File& file);
 /// Returns true if the file did not exist or was deleted successfully.
 bool deleteFile(const juce::File& file);
 
+/// Returns the storage options of the AudioBatch.settings file shared by the GUI and CLI.
+juce::PropertiesFile::Options settingsFileOptions();
+
 /// Collects build and runtime environment details for logs and diagnostics.
 juce::StringArray systemInfo();
 
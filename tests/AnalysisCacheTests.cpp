@@ -0,0 +1,467 @@
+/// Unit tests for AnalysisCache.
+/// Checks that queued records reach the database on shutdown and after a commit that failed,
+/// and that a writer killed in the middle of its work leaves every committed batch whole:
+/// the stored rows are an exact prefix of the queue, and every batch reported as committed is among them.
+/// Imports must only match copies with new modification times by a full content fingerprint.
+/// Also reports how many single-record stores and lookups the cache runs per second.
+
+#include "AnalysisCache.h"
+#include "FileFingerprint.h"
+#include "ScratchDirectory.h"
+#include "TestProcesses.h"
+
+#include <sqlite3.h>
+
+#include <JuceHeader.h>
+
+#include <vector>
+
+/// Records, scratch databases, and raw SQLite access for the analysis cache tests.
+namespace audiobatch::tests::cache
+{
+constexpr std::int64_t baseModifiedTimeMs = 1'700'000'000'000;
+
+/// Records queued by the shutdown test, more than one batch.
+constexpr int shutdownRecordCount = static_cast<int>(AnalysisCache::writeBatchSize) * 3 + 17;
+/// How long the retry test holds the write lock, longer than the writer's busy timeout.
+constexpr int lockHoldMs = 3000;
+/// How long to wait for a retried batch to show up in the database.
+constexpr int retryTimeoutMs = 10000;
+
+/// Processes killed by the crash test, each with a fresh database.
+constexpr int crashRounds = 4;
+/// The crash writer flushes explicitly after this many records, and the write-behind thread commits in between.
+constexpr int crashFlushInterval = 1000;
+/// The crash writer stops by itself after this many records, in case nothing kills it.
+constexpr int crashWriterRecordCount = 500000;
+/// Committed records the crash writer must report before it is killed.
+constexpr int crashKillAfterRecords = 3000;
+/// Size of the files exported and imported by the import test, larger than the samples of a fast fingerprint.
+constexpr size_t importFileSize = 4 * FileFingerprint::sampledBytes;
+/// How far the import test moves the modification times of the copied files.
+constexpr std::int64_t importTimeShiftMs = 3'600'000;
+
+/// Records stored and looked up one call at a time by the throughput test.
+constexpr int throughputRecordCount = 5000;
+
+/// Upper bound for the random delay between reaching crashKillAfterRecords and the kill.
+constexpr int crashKillJitterMs = 100;
+constexpr int crashTimeoutMs = 60000;
+
+/// Returns the record queued at the given position. Every field depends on the index,
+/// so a row stored under the wrong path or with another record's values does not match.
+static AudioAnalysisRecord makeRecord(const juce::File& directory, const int index)
+{
+    auto record = AudioAnalysisRecord::fromFileInfo({
+        directory.getChildFile(juce::String::formatted("track%06d.wav", index)),
+        1000 + index,
+        baseModifiedTimeMs + index,
+    });
+
+    record.formatName = "WAV file";
+    record.status = AudioAnalysisStatus::analyzed;
+    record.profile = AudioAnalysisProfile::full;
+    record.sampleRate = 44100;
+    record.channels = 2;
+    record.bitsPerSample = 24;
+    record.lengthInSamples = std::int64_t {44100} * (1 + index % 600);
+    record.durationSeconds = static_cast<double>(record.lengthInSamples) / record.sampleRate;
+    record.peakLeft = static_cast<float>(index % 1000 + 1) / 1000.0f;
+    record.peakRight = record.peakLeft / 2.0f;
+    record.overallPeak = record.peakLeft;
+    record.truePeakLeft = record.peakLeft * 1.25;
+    record.truePeakRight = record.peakRight * 1.25;
+    record.overallTruePeak = record.truePeakLeft;
+    record.integratedLufs = -10.0 - index % 50;
+    record.maxShortTermLufs = record.integratedLufs + 3.0;
+    return record;
+}
+
+/// Returns the file information of the records at positions 0 to count - 1.
+static std::vector<AudioFileInfo> makeFileInfos(const juce::File& directory, const int count)
+{
+    std::vector<AudioFileInfo> files;
+    files.reserve(static_cast<size_t>(count));
+
+    for (int index = 0; index < count; ++index) {
+        const auto record = makeRecord(directory, index);
+        files.push_back({record.file, record.fileSize, record.modifiedTimeMs});
+    }
+
+    return files;
+}
+
+/// Returns true when the cached record holds the values that were queued.
+static bool matchesQueuedRecord(const AudioAnalysisRecord& cached, const AudioAnalysisRecord& queued)
+{
+    return cached.fullPath == queued.fullPath && cached.fileSize == queued.fileSize
+        && cached.modifiedTimeMs == queued.modifiedTimeMs && cached.lengthInSamples == queued.lengthInSamples
+        && cached.profile == queued.profile && cached.isComplete && juce::exactlyEqual(cached.peakLeft, queued.peakLeft)
+        && juce::exactlyEqual(cached.peakRight, queued.peakRight)
+        && juce::exactlyEqual(cached.overallTruePeak, queued.overallTruePeak)
+        && juce::exactlyEqual(cached.integratedLufs, queued.integratedLufs)
+        && juce::exactlyEqual(cached.maxShortTermLufs, queued.maxShortTermLufs);
+}
+
+/// A connection of its own to the test database, for checks that must bypass the cache and its queue.
+class RawConnection
+{
+public:
+    explicit RawConnection(const juce::File& databaseFile)
+    {
+        const auto path = databaseFile.getFullPathName();
+
+        if (sqlite3_open_v2(path.toRawUTF8(), &database, SQLITE_OPEN_READWRITE, nullptr) != SQLITE_OK) {
+            sqlite3_close(database);
+            database = nullptr;
+        }
+    }
+
+    ~RawConnection()
+    {
+        sqlite3_close(database);
+    }
+
+    bool execute(const char* sql) const
+    {
+        return database != nullptr && sqlite3_exec(database, sql, nullptr, nullptr, nullptr) == SQLITE_OK;
+    }
+
+    /// Returns the first column of the first row as text, or an empty string when the query fails.
+    juce::String queryText(const char* sql) const
+    {
+        sqlite3_stmt* statement = nullptr;
+        juce::String result;
+
+        if (database != nullptr && sqlite3_prepare_v2(database, sql, -1, &statement, nullptr) == SQLITE_OK
+            && sqlite3_step(statement) == SQLITE_ROW)
+        {
+            result = juce::String::fromUTF8(reinterpret_cast<const char*>(sqlite3_column_text(statement, 0)));
+        }
+
+        sqlite3_finalize(statement);
+        return result;
+    }
+
+private:
+    sqlite3* database = nullptr;
+
+    JUCE_DECLARE_NON_COPYABLE(RawConnection)
+};
+
+/// Writes importFileSize bytes that depend on the seed, so files written with different seeds differ everywhere.
+static bool writeImportFile(const juce::File& file, const int seed)
+{
+    juce::MemoryBlock data;
+    data.setSize(importFileSize);
+    auto* bytes = static_cast<juce::uint8*>(data.getData());
+
+    for (size_t index = 0; index < importFileSize; ++index) {
+        bytes[index] = static_cast<juce::uint8>((index * 131 + index / 251 + static_cast<size_t>(seed)) & 0xff);
+    }
+
+    return file.replaceWithData(data.getData(), data.getSize());
+}
+
+/// Returns the record of an analyzed file as it is on disk, fingerprinted in the given mode.
+static AudioAnalysisRecord makeFileRecord(const juce::File& file, const AudioFingerprintMode mode)
+{
+    const auto info = AudioFileInfo::fromFile(file);
+    auto record = makeRecord(file.getParentDirectory(), 0);
+    record.file = file;
+    record.fullPath = file.getFullPathName();
+    record.fileSize = info.fileSize;
+    record.modifiedTimeMs = info.modifiedTimeMs;
+    record.fingerprint = FileFingerprint::compute(file, mode);
+    return record;
+}
+
+/// Returns the committed record count the crash writer last reported, or 0 before its first report.
+static int readProgress(const juce::File& progressFile)
+{
+    return progressFile.loadFileAsString().getIntValue();
+}
+}  // namespace audiobatch::tests::cache
+
+using namespace audiobatch::tests;
+using namespace audiobatch::tests::cache;
+
+int audiobatch::tests::runAnalysisCacheCrashWriter(const juce::ArgumentList& arguments)
+{
+    const juce::File databaseFile(arguments.getValueForOption(analysisCacheCrashWriterOption));
+    const juce::File progressFile(arguments.getValueForOption(progressFileOption));
+    const auto directory = databaseFile.getSiblingFile("library");
+    AnalysisCache cache(databaseFile);
+
+    if (!cache.open()) {
+        return 1;
+    }
+
+    for (int index = 0; index < crashWriterRecordCount; ++index) {
+        cache.enqueueAnalysis(makeRecord(directory, index));
+
+        // The report is replaced by a rename, so the test never reads a partial count.
+        if ((index + 1) % crashFlushInterval == 0 && cache.flushPendingAnalyses()) {
+            progressFile.replaceWithText(juce::String(index + 1));
+        }
+    }
+
+    return 0;
+}
+
+/// Exercises the write-behind queue of AnalysisCache against a database in a scratch directory.
+class AnalysisCacheTests final : public juce::UnitTest
+{
+public:
+    AnalysisCacheTests() :
+        juce::UnitTest("AnalysisCache", "AudioBatch")
+    { }
+
+    void runTest() override
+    {
+        beginTest("Queued records are stored on shutdown");
+        testShutdownFlush();
+
+        beginTest("Writer retries a batch that failed to commit");
+        testCommitRetry();
+
+        beginTest("Imports match new modification times only by a full fingerprint");
+        testImportFingerprints();
+
+        beginTest("Single stores and lookups run quickly");
+        testSingleRecordThroughput();
+
+        beginTest("A killed writer leaves every committed batch whole");
+
+        for (int round = 0; round < crashRounds; ++round) {
+            testCrashConsistency(round);
+        }
+    }
+
+private:
+    void testShutdownFlush()
+    {
+        const ScratchDirectory scratch;
+        const auto databaseFile = scratch.directory.getChildFile("analysis.db");
+        const auto library = scratch.directory.getChildFile("library");
+
+        {
+            AnalysisCache cache(databaseFile);
+            expect(cache.open());
+
+            for (int index = 0; index < shutdownRecordCount; ++index) {
+                cache.enqueueAnalysis(makeRecord(library, index));
+            }
+        }
+
+        AnalysisCache cache(databaseFile);
+        expect(cache.open());
+        expectEquals(cache.getStats().analysisRows, shutdownRecordCount);
+        expectStoredPrefix(cache, library, shutdownRecordCount, shutdownRecordCount);
+    }
+
+    void testCommitRetry()
+    {
+        const ScratchDirectory scratch;
+        const auto databaseFile = scratch.directory.getChildFile("analysis.db");
+        const auto library = scratch.directory.getChildFile("library");
+        constexpr int recordCount = 5;
+
+        AnalysisCache cache(databaseFile);
+        expect(cache.open());
+
+        // Another connection holds the write lock past the writer's busy timeout, so the first batch fails.
+        // The later records do not wake the writer, since only the first record and full batches do.
+        const RawConnection blocker(databaseFile);
+        expect(blocker.execute("BEGIN IMMEDIATE;"));
+
+        for (int index = 0; index < recordCount; ++index) {
+            cache.enqueueAnalysis(makeRecord(library, index));
+        }
+
+        juce::Thread::sleep(lockHoldMs);
+        expect(blocker.execute("COMMIT;"));
+
+        const RawConnection reader(databaseFile);
+        const auto deadline = juce::Time::getMillisecondCounter() + retryTimeoutMs;
+        auto storedCount = 0;
+
+        while (juce::Time::getMillisecondCounter() < deadline) {
+            storedCount = reader.queryText("SELECT COUNT(*) FROM file_analysis;").getIntValue();
+
+            if (storedCount == recordCount) {
+                break;
+            }
+
+            juce::Thread::sleep(50);
+        }
+
+        expectEquals(storedCount, recordCount, "records still queued after the write lock was released");
+    }
+
+    void testSingleRecordThroughput()
+    {
+        const ScratchDirectory scratch;
+        const auto library = scratch.directory.getChildFile("library");
+        AnalysisCache cache(scratch.directory.getChildFile("analysis.db"));
+        expect(cache.open());
+
+        // Every call runs its own statement and transaction, so the per-call overhead dominates.
+        const auto storeStartMs = juce::Time::getMillisecondCounterHiRes();
+
+        for (int index = 0; index < throughputRecordCount; ++index) {
+            cache.storeAnalysis(makeRecord(library, index));
+        }
+
+        const auto storeMs = juce::Time::getMillisecondCounterHiRes() - storeStartMs;
+        const auto files = makeFileInfos(library, throughputRecordCount);
+        auto hits = 0;
+        const auto lookupStartMs = juce::Time::getMillisecondCounterHiRes();
+
+        for (const auto& fileInfo : files) {
+            hits += static_cast<int>(cache.getAnalyses({fileInfo}).hits.size());
+        }
+
+        const auto lookupMs = juce::Time::getMillisecondCounterHiRes() - lookupStartMs;
+        expectEquals(hits, throughputRecordCount);
+
+        logMessage(
+            juce::String(throughputRecordCount) + " records: "
+            + juce::String(1000.0 * throughputRecordCount / juce::jmax(1.0, storeMs), 0) + " stores/s, "
+            + juce::String(1000.0 * throughputRecordCount / juce::jmax(1.0, lookupMs), 0) + " lookups/s"
+        );
+    }
+
+    void testImportFingerprints()
+    {
+        const ScratchDirectory scratch;
+        const auto source = scratch.directory.getChildFile("source");
+        const auto copy = scratch.directory.getChildFile("copy");
+        const auto exportFile = scratch.directory.getChildFile("library.cache");
+        expect(source.createDirectory().wasOk() && copy.createDirectory().wasOk());
+
+        // The middle of edited.wav changes in the copy, which keeps the size and both ends of the file.
+        const juce::StringArray fileNames {"fast.wav", "full.wav", "edited.wav"};
+
+        {
+            AnalysisCache cache(scratch.directory.getChildFile("source.db"));
+            expect(cache.open());
+
+            for (const auto& fileName : fileNames) {
+                const auto file = source.getChildFile(fileName);
+                expect(writeImportFile(file, 0));
+                const auto mode = fileName == "fast.wav" ? AudioFingerprintMode::fast : AudioFingerprintMode::full;
+                expect(cache.storeAnalysis(makeFileRecord(file, mode)));
+            }
+
+            const auto exported = cache.exportAnalyses(source, exportFile);
+            expect(!exported.hasError(), exported.errorMessage);
+            expectEquals(exported.transferredRows, fileNames.size());
+        }
+
+        for (const auto& fileName : fileNames) {
+            const auto file = copy.getChildFile(fileName);
+            expect(source.getChildFile(fileName).copyFileTo(file));
+
+            if (fileName == "edited.wav") {
+                juce::FileOutputStream output(file);
+                expect(output.openedOk() && output.setPosition(static_cast<juce::int64>(importFileSize / 2)));
+                output.writeByte(0x55);
+                output.writeByte(0x2a);
+            }
+
+            const auto modifiedTime = source.getChildFile(fileName).getLastModificationTime();
+            expect(file.setLastModificationTime(juce::Time(modifiedTime.toMilliseconds() + importTimeShiftMs)));
+        }
+
+        AnalysisCache cache(scratch.directory.getChildFile("copy.db"));
+        expect(cache.open());
+        const auto imported = cache.importAnalyses(exportFile, copy);
+        expect(!imported.hasError(), imported.errorMessage);
+        expectEquals(imported.transferredRows, 1);
+        expectEquals(imported.skippedRows, 2);
+
+        AudioAnalysisRecord record;
+        expect(cache.getAnalysis(copy.getChildFile("full.wav"), record), "full fingerprint not matched");
+        expect(!cache.getAnalysis(copy.getChildFile("fast.wav"), record), "fast fingerprint matched");
+        expect(!cache.getAnalysis(copy.getChildFile("edited.wav"), record), "edited file matched");
+    }
+
+    void testCrashConsistency(const int round)
+    {
+        const ScratchDirectory scratch;
+        const auto databaseFile = scratch.directory.getChildFile("analysis.db");
+        const auto progressFile = scratch.directory.getChildFile("progress.txt");
+        const auto library = databaseFile.getSiblingFile("library");
+        const auto executable = juce::File::getSpecialLocation(juce::File::currentExecutableFile);
+
+        juce::ChildProcess writer;
+        const juce::StringArray command {
+            executable.getFullPathName(),
+            juce::String(analysisCacheCrashWriterOption) + "=" + databaseFile.getFullPathName(),
+            juce::String(progressFileOption) + "=" + progressFile.getFullPathName(),
+        };
+
+        if (!writer.start(command, 0)) {
+            expect(false, "could not start the crash writer");
+            return;
+        }
+
+        const auto deadline = juce::Time::getMillisecondCounter() + crashTimeoutMs;
+
+        while (readProgress(progressFile) < crashKillAfterRecords && writer.isRunning()
+               && juce::Time::getMillisecondCounter() < deadline)
+        {
+            juce::Thread::sleep(1);
+        }
+
+        // The jitter moves the kill across the batches, so some rounds land inside an open transaction.
+        juce::Thread::sleep(getRandom().nextInt(crashKillJitterMs));
+        const auto killedWhileRunning = writer.isRunning();
+        writer.kill();
+        writer.waitForProcessToFinish(crashTimeoutMs);
+
+        const auto reportedCount = readProgress(progressFile);
+        expect(reportedCount >= crashKillAfterRecords, "the crash writer did not commit its first batches");
+
+        expectEquals(RawConnection(databaseFile).queryText("PRAGMA integrity_check;"), juce::String("ok"));
+
+        AnalysisCache cache(databaseFile);
+        expect(cache.open());
+
+        const auto storedCount = cache.getStats().analysisRows;
+        logMessage(
+            "Round " + juce::String(round + 1) + ": " + juce::String(storedCount) + " rows stored, "
+            + juce::String(reportedCount) + " reported committed"
+            + (killedWhileRunning ? juce::String() : juce::String(", writer finished before the kill"))
+        );
+
+        expect(storedCount >= reportedCount, "records reported as committed are missing");
+        expectStoredPrefix(cache, library, storedCount, storedCount + 1);
+    }
+
+    /// Expects the cache to hold exactly the first storedCount of the first lookupCount records, unchanged.
+    void expectStoredPrefix(
+        AnalysisCache& cache,
+        const juce::File& library,
+        const int storedCount,
+        const int lookupCount
+    )
+    {
+        const auto lookup = cache.getAnalyses(makeFileInfos(library, lookupCount), AudioAnalysisProfile::full);
+        expectEquals(static_cast<int>(lookup.hits.size()), storedCount);
+        expectEquals(static_cast<int>(lookup.misses.size()), lookupCount - storedCount);
+
+        int mismatches = 0;
+
+        for (size_t index = 0; index < lookup.hits.size(); ++index) {
+            if (!matchesQueuedRecord(lookup.hits[index], makeRecord(library, static_cast<int>(index)))) {
+                ++mismatches;
+            }
+        }
+
+        expectEquals(mismatches, 0, "stored rows that differ from the queued records");
+    }
+};
+
+static AnalysisCacheTests analysisCacheTests;
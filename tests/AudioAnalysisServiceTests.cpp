@@ -0,0 +1,418 @@
+/// Unit tests for AudioAnalysisService.
+/// Counts the allocations of repeated analyses through a replaced global operator new,
+/// and requires a worker's reused analysis context to make the same number for a short and a long file,
+/// so nothing in the analysis allocates per block.
+/// libebur128 allocates with malloc, so its analyzer state and gating history are not counted.
+/// Also requires a long file analyzed in segments on a pool to match its sequential analysis,
+/// and files decoded on a separate job through the block queue to measure exactly as when decoded in place.
+/// Reports the read throughput of mapped and streamed readers with a cold and a warm page cache.
+
+#include "AudioAnalysisService.h"
+#include "ScratchDirectory.h"
+
+#include <JuceHeader.h>
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <optional>
+
+#if JUCE_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/// Synthetic audio files and allocation counting for the analysis service tests.
+namespace audiobatch::tests::analysis
+{
+constexpr int testChannels = 2;
+/// Frames written per block when creating test files.
+constexpr int writeBlockFrames = 65536;
+
+/// Lengths of the files compared by the allocation test. The long one reads many more blocks.
+constexpr double shortFileSeconds = 5.0;
+constexpr double longFileSeconds = 60.0;
+
+/// Length and format of the file compared segmented and sequentially.
+/// Fifteen minutes split into three segments at the five minute minimum, so two seams are checked.
+/// A low rate and 16 bits keep the file near 80 MB.
+constexpr double segmentedFileSeconds = 15.0 * 60.0;
+constexpr double segmentedSampleRate = 22050.0;
+constexpr int segmentedSegments = 3;
+/// Largest loudness difference allowed between the segmented and the sequential analysis, in LU.
+constexpr double loudnessTolerance = 0.01;
+
+/// Length of the file read by the throughput test, about 48 MB as 24-bit stereo at 44.1 kHz.
+constexpr double throughputFileSeconds = 180.0;
+/// Reads of the file timed per reader setup and cache state, of which the fastest is reported.
+constexpr int timedReadRuns = 3;
+
+/// Set while countAllocations runs its function.
+static std::atomic<bool> countingAllocations {false};
+/// Calls to operator new since countAllocations started.
+static std::atomic<std::int64_t> allocationCount {0};
+
+/// Returns the number of operator new calls made while running the function, on any thread.
+template<typename Function>
+static std::int64_t countAllocations(Function&& function)
+{
+    allocationCount = 0;
+    countingAllocations = true;
+    function();
+    countingAllocations = false;
+    return allocationCount.load();
+}
+
+/// Writes a stereo WAV file: two tones with slowly changing levels over a little noise,
+/// so loudness, short-term loudness, and the peaks all vary over the file.
+static bool writeTestFile(
+    const juce::File& file,
+    const double seconds,
+    const double sampleRate = 44100.0,
+    const int bitsPerSample = 24
+)
+{
+    std::unique_ptr<juce::OutputStream> output(file.createOutputStream().release());
+
+    if (output == nullptr) {
+        return false;
+    }
+
+    juce::WavAudioFormat format;
+    const auto writer = format.createWriterFor(
+        output,
+        juce::AudioFormatWriterOptions()
+            .withSampleRate(sampleRate)
+            .withNumChannels(testChannels)
+            .withBitsPerSample(bitsPerSample)
+    );
+
+    if (writer == nullptr) {
+        return false;
+    }
+
+    const auto totalFrames = static_cast<std::int64_t>(seconds * sampleRate);
+    juce::AudioBuffer<float> buffer(testChannels, writeBlockFrames);
+    juce::Random random(1);
+
+    for (std::int64_t blockStart = 0; blockStart < totalFrames; blockStart += writeBlockFrames) {
+        const auto numFrames = static_cast<int>(std::min<std::int64_t>(writeBlockFrames, totalFrames - blockStart));
+
+        for (int frame = 0; frame < numFrames; ++frame) {
+            const auto time = static_cast<double>(blockStart + frame) / sampleRate;
+            const auto level = 0.35 + 0.3 * std::sin(juce::MathConstants<double>::twoPi * 0.05 * time);
+            const auto noise = 0.02 * (random.nextDouble() - 0.5);
+            const auto left = level * std::sin(juce::MathConstants<double>::twoPi * 440.0 * time) + noise;
+            const auto right = (0.7 - level) * std::sin(juce::MathConstants<double>::twoPi * 1250.0 * time) + noise;
+            buffer.setSample(0, frame, static_cast<float>(left));
+            buffer.setSample(1, frame, static_cast<float>(right));
+        }
+
+        if (!writer->writeFromAudioSampleBuffer(buffer, 0, numFrames)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/// Drops the file's pages from the page cache, so the next read comes from storage.
+/// Returns false where the platform offers no way to do so without privileges.
+static bool evictFromPageCache(const juce::File& file)
+{
+#if JUCE_LINUX
+    const auto descriptor = ::open(file.getFullPathName().toRawUTF8(), O_RDONLY);
+
+    if (descriptor < 0) {
+        return false;
+    }
+
+    // Dirty pages stay cached until they are written back.
+    ::fdatasync(descriptor);
+    const auto evicted = ::posix_fadvise(descriptor, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    ::close(descriptor);
+    return evicted;
+#else
+    juce::ignoreUnused(file);
+    return false;
+#endif
+}
+
+/// Opens the file with AudioAnalysisService::createReader, reads every block as the analysis does,
+/// and returns the time taken in milliseconds, or a negative value when opening or reading failed.
+static double timeReaderPass(
+    juce::AudioFormatManager& formatManager,
+    const juce::File& file,
+    const AudioIoSettings& settings,
+    juce::AudioBuffer<float>& buffer
+)
+{
+    const auto startMs = juce::Time::getMillisecondCounterHiRes();
+    const auto reader = AudioAnalysisService::createReader(formatManager, file, settings);
+
+    if (reader == nullptr) {
+        return -1.0;
+    }
+
+    buffer.setSize(static_cast<int>(reader->numChannels), settings.analysisBlockSize, false, false, true);
+
+    for (std::int64_t position = 0; position < reader->lengthInSamples; position += settings.analysisBlockSize) {
+        const auto numFrames
+            = static_cast<int>(std::min<std::int64_t>(settings.analysisBlockSize, reader->lengthInSamples - position));
+
+        if (!reader->read(&buffer, 0, numFrames, position, true, true)) {
+            return -1.0;
+        }
+    }
+
+    return juce::Time::getMillisecondCounterHiRes() - startMs;
+}
+}  // namespace audiobatch::tests::analysis
+
+using namespace audiobatch::tests;
+using namespace audiobatch::tests::analysis;
+
+// Counting replacements of the global allocation functions. The array forms forward to these.
+void* operator new(const std::size_t size)
+{
+    if (countingAllocations.load(std::memory_order_relaxed)) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (auto* memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+/// Checks how much AudioAnalysisService allocates per analyzed file.
+class AudioAnalysisServiceTests final : public juce::UnitTest
+{
+public:
+    AudioAnalysisServiceTests() :
+        juce::UnitTest("AudioAnalysisService", "AudioBatch")
+    { }
+
+    void runTest() override
+    {
+        beginTest("A reused context allocates the same for short and long files");
+        testAllocationsPerFile();
+
+        beginTest("Segmented analysis matches sequential analysis");
+        testSegmentedAnalysis();
+
+        beginTest("Decoding on a separate job matches decoding in place");
+        testDecodeJob();
+
+        beginTest("Reader throughput with a cold and a warm page cache");
+        testReaderThroughput();
+    }
+
+private:
+    void testAllocationsPerFile()
+    {
+        const ScratchDirectory scratch;
+        const auto shortFile = scratch.directory.getChildFile("short.wav");
+        const auto longFile = scratch.directory.getChildFile("long.wav");
+        expect(writeTestFile(shortFile, shortFileSeconds));
+        expect(writeTestFile(longFile, longFileSeconds));
+
+        const auto shortInfo = AudioFileInfo::fromFile(shortFile);
+        const auto longInfo = AudioFileInfo::fromFile(longFile);
+
+        for (const auto mapped : {true, false}) {
+            AudioIoSettings settings;
+            settings.useMemoryMapping = mapped;
+            settings.readaheadBytes = mapped ? 0 : 1 << 16;
+
+            for (const auto profile :
+                 {AudioAnalysisProfile::peakOnly, AudioAnalysisProfile::peakAndLoudness, AudioAnalysisProfile::full})
+            {
+                const auto label = AudioAnalysisService::getProfileName(profile) + (mapped ? ", mapped" : ", streamed");
+                AudioAnalysisContext context;
+                AudioAnalysisRecord record;
+
+                // The first analysis grows the context's buffers to fit.
+                record = AudioAnalysisService::analyzeFile(longInfo, settings, context, profile);
+                expect(!record.hasError(), label + ": " + record.errorMessage);
+
+                const auto shortAllocations = countAllocations([&] {
+                    record = AudioAnalysisService::analyzeFile(shortInfo, settings, context, profile);
+                });
+                const auto longAllocations = countAllocations([&] {
+                    record = AudioAnalysisService::analyzeFile(longInfo, settings, context, profile);
+                });
+                const auto repeatedAllocations = countAllocations([&] {
+                    record = AudioAnalysisService::analyzeFile(shortInfo, settings, context, profile);
+                });
+
+                expect(!record.hasError(), label + ": " + record.errorMessage);
+                expectEquals(longAllocations, shortAllocations, label + ", long file");
+                expectEquals(repeatedAllocations, shortAllocations, label + ", repeated");
+                logMessage(label + ": " + juce::String(shortAllocations) + " allocations per file");
+            }
+        }
+    }
+
+    void testSegmentedAnalysis()
+    {
+        const ScratchDirectory scratch;
+        const auto file = scratch.directory.getChildFile("long.wav");
+        expect(writeTestFile(file, segmentedFileSeconds, segmentedSampleRate, 16));
+
+        const auto fileInfo = AudioFileInfo::fromFile(file);
+        const AudioIoSettings settings;
+
+        // A context without a scheduler always analyzes sequentially.
+        AudioAnalysisContext sequentialContext;
+        const auto sequential = AudioAnalysisService::analyzeFile(fileInfo, settings, sequentialContext);
+
+        juce::ThreadPool threadPool(segmentedSegments - 1);
+        std::atomic<int> helperJobs {0};
+        AudioAnalysisContext segmentedContext;
+        segmentedContext.setSegmentScheduler(
+            [&threadPool, &helperJobs](std::function<void()> job) {
+                ++helperJobs;
+                threadPool.addJob(std::move(job));
+            },
+            segmentedSegments
+        );
+        const auto segmented = AudioAnalysisService::analyzeFile(fileInfo, settings, segmentedContext);
+
+        expect(!sequential.hasError(), sequential.errorMessage);
+        expect(!segmented.hasError(), segmented.errorMessage);
+        expectEquals(helperJobs.load(), segmentedSegments - 1, "helper jobs");
+
+        expectEquals(segmented.peakLeft, sequential.peakLeft, "left peak");
+        expectEquals(segmented.peakRight, sequential.peakRight, "right peak");
+        expectEquals(segmented.overallPeak, sequential.overallPeak, "overall peak");
+        expectEquals(segmented.truePeakLeft, sequential.truePeakLeft, "left true peak");
+        expectEquals(segmented.truePeakRight, sequential.truePeakRight, "right true peak");
+        expectEquals(segmented.overallTruePeak, sequential.overallTruePeak, "overall true peak");
+        expectWithinAbsoluteError(
+            segmented.integratedLufs, sequential.integratedLufs, loudnessTolerance, "integrated loudness"
+        );
+        expectWithinAbsoluteError(
+            segmented.maxShortTermLufs, sequential.maxShortTermLufs, loudnessTolerance, "maximum short-term loudness"
+        );
+
+        logMessage(
+            "Integrated " + juce::String(sequential.integratedLufs, 4) + " LUFS sequential, "
+            + juce::String(segmented.integratedLufs, 4) + " LUFS in " + juce::String(segmentedSegments) + " segments"
+        );
+    }
+
+    void testDecodeJob()
+    {
+        const ScratchDirectory scratch;
+        const auto file = scratch.directory.getChildFile("streamed.wav");
+        expect(writeTestFile(file, longFileSeconds));
+
+        const auto fileInfo = AudioFileInfo::fromFile(file);
+        AudioIoSettings settings;
+        // Mapped readers always decode in place.
+        settings.useMemoryMapping = false;
+
+        AudioAnalysisContext inPlaceContext;
+        AudioAnalysisContext decodeJobContext;
+        // Declared after the context, so the pool has finished every job before the context is destroyed.
+        juce::ThreadPool decodePool(1);
+        std::atomic<int> decodeJobs {0};
+        decodeJobContext.setDecodeScheduler([&decodePool, &decodeJobs](std::function<void()> job) {
+            ++decodeJobs;
+            decodePool.addJob(std::move(job));
+        });
+
+        // The peak stop closes the queue while the decode job is still running ahead.
+        for (const auto stopAtPeakDb : {std::optional<float> {}, std::optional<float> {-6.0f}}) {
+            const auto label = juce::String(stopAtPeakDb.has_value() ? "stop at peak" : "whole file");
+            const auto inPlace = AudioAnalysisService::analyzeFile(
+                fileInfo, settings, inPlaceContext, AudioAnalysisProfile::full, stopAtPeakDb
+            );
+            const auto decoded = AudioAnalysisService::analyzeFile(
+                fileInfo, settings, decodeJobContext, AudioAnalysisProfile::full, stopAtPeakDb
+            );
+
+            expect(!decoded.hasError(), label + ": " + decoded.errorMessage);
+            expect(decoded.isComplete == inPlace.isComplete, label + ", completeness");
+            expect(stopAtPeakDb.has_value() != decoded.isComplete, label + ", stopped early");
+            expectEquals(decoded.peakLeft, inPlace.peakLeft, label + ", left peak");
+            expectEquals(decoded.peakRight, inPlace.peakRight, label + ", right peak");
+            expectEquals(decoded.overallTruePeak, inPlace.overallTruePeak, label + ", true peak");
+            expectEquals(decoded.integratedLufs, inPlace.integratedLufs, label + ", integrated loudness");
+            expectEquals(decoded.maxShortTermLufs, inPlace.maxShortTermLufs, label + ", maximum short-term loudness");
+        }
+
+        expectEquals(decodeJobs.load(), 2, "decode jobs");
+    }
+
+    void testReaderThroughput()
+    {
+        const ScratchDirectory scratch;
+        const auto file = scratch.directory.getChildFile("throughput.wav");
+        expect(writeTestFile(file, throughputFileSeconds));
+
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+        juce::AudioBuffer<float> buffer;
+        const auto megabytes = static_cast<double>(file.getSize()) / 1.0e6;
+
+        struct ReaderSetup {
+            const char* label;
+            bool useMemoryMapping;
+            int readaheadBytes;
+        };
+
+        const std::array<ReaderSetup, 3> setups {{
+            {"mapped", true, 0},
+            {"streamed", false, 0},
+            {"readahead", false, 1 << 20},
+        }};
+
+        for (const auto& [label, useMemoryMapping, readaheadBytes] : setups) {
+            AudioIoSettings settings;
+            settings.useMemoryMapping = useMemoryMapping;
+            settings.readaheadBytes = readaheadBytes;
+
+            for (const auto cold : {true, false}) {
+                if (cold && !evictFromPageCache(file)) {
+                    logMessage(juce::String(label) + ", cold: not measured, the page cache cannot be dropped here");
+                    continue;
+                }
+
+                auto fastestMs = 0.0;
+
+                for (int run = 0; run < timedReadRuns; ++run) {
+                    if (cold) {
+                        evictFromPageCache(file);
+                    }
+
+                    const auto passMs = timeReaderPass(formatManager, file, settings, buffer);
+                    expect(passMs >= 0.0, juce::String(label) + " reader failed");
+                    fastestMs = run == 0 ? passMs : juce::jmin(fastestMs, passMs);
+                }
+
+                logMessage(
+                    juce::String(label) + (cold ? ", cold: " : ", warm: ")
+                    + juce::String(megabytes / juce::jmax(0.001, fastestMs / 1000.0), 0) + " MB/s"
+                );
+            }
+        }
+    }
+};
+
+static AudioAnalysisServiceTests audioAnalysisServiceTests;
@@ -0,0 +1,156 @@
+/// Unit tests for FileFingerprint.
+/// Checks the in-tree XXH64 against digests from the reference implementation, below, at, and across
+/// the 32-byte stripe, then checks that file fingerprints hash the size with the right bytes in each mode,
+/// across the reader's chunk boundaries, and that fingerprints of files already in memory match those read from disk.
+
+#include "FileFingerprint.h"
+#include "ScratchDirectory.h"
+
+#include <JuceHeader.h>
+
+#include <array>
+#include <vector>
+
+/// Test data and reference digests for the fingerprint tests.
+namespace audiobatch::tests::fingerprint
+{
+/// Seed used for the seeded reference digests.
+constexpr juce::uint64 testSeed = 0x9E3779B97F4A7C15ULL;
+
+/// XXH64 of the pattern bytes of the given length, with seed 0 and with testSeed,
+/// as computed by the reference implementation.
+struct HashVector {
+    size_t length;
+    juce::uint64 digest;
+    juce::uint64 seededDigest;
+};
+
+constexpr std::array<HashVector, 14> hashVectors {{
+    {1, 0xE934A84ADB052768ULL, 0x126BB57A12364AA5ULL},
+    {3, 0xA83378D1EB86EC62ULL, 0x22F4AAA6A7ABCB74ULL},
+    {4, 0x9882E57ED36C4CFCULL, 0x499FEE07183420C5ULL},
+    {7, 0xF0AEF407B44730F8ULL, 0xDDD5CBDF4F66BE03ULL},
+    {8, 0xA5BC8D8944331FE7ULL, 0x66C50C48C04F54F2ULL},
+    {12, 0x26F149A7BC288970ULL, 0xC2D0EF4D3C47639FULL},
+    {31, 0x1ADD2D10328C4897ULL, 0x2F9A0F7A103F96B1ULL},
+    {32, 0x333288D992CF3B16ULL, 0x00F9F22649DC408CULL},
+    {33, 0x379B60150F2CFC7FULL, 0xBC46DB4BD8CDCFDBULL},
+    {63, 0x230F593878FE3703ULL, 0x659FA365EB8D72B9ULL},
+    {64, 0x60A3644CA073E2CBULL, 0x3A446539D50B6703ULL},
+    {65, 0x8A8D527218171F2EULL, 0x6AA173B8AF5EC677ULL},
+    {100, 0xACD07A6400E07DEFULL, 0xE7461AE27E57FE50ULL},
+    {1000, 0xA7E693E78C02860CULL, 0x0842628AC6B47135ULL},
+}};
+
+/// Fingerprints of a file holding the pattern bytes of the given length, from the reference implementation:
+/// XXH64 of the size as 8 little-endian bytes, then the whole file or its first and last 64 KiB.
+struct FileVector {
+    juce::int64 length;
+    const char* fast;
+    const char* full;
+};
+
+constexpr std::array<FileVector, 6> fileVectors {{
+    {0, "fast:34c96acdcadb1bbb", "full:34c96acdcadb1bbb"},
+    {100, "fast:301f54e82449904b", "full:301f54e82449904b"},
+    // Exactly both samples: the fast mode still hashes the whole file.
+    {2 * FileFingerprint::sampledBytes, "fast:bcfefb1a4a201482", "full:bcfefb1a4a201482"},
+    // One byte more: the fast mode skips that middle byte.
+    {2 * FileFingerprint::sampledBytes + 1, "fast:e4aa0c48b5fe37f2", "full:41d40941bac76a17"},
+    // Past the full mode's 1 MiB read chunk, so a stripe straddles two reads.
+    {(1 << 20) + 100, "fast:d92ef24066b5b500", "full:ab4f5e9ac5905a32"},
+    {3 * (1 << 20) + 17, "fast:d5e76f728977bbc5", "full:1be4389142c3cc87"},
+}};
+
+/// Returns the test pattern: every byte differs from its neighbours, and the sequence does not repeat
+/// with the 64 KiB sample size, so hashing the wrong range changes the digest.
+static juce::MemoryBlock makePattern(const juce::int64 length)
+{
+    juce::MemoryBlock data;
+    data.setSize(static_cast<size_t>(length));
+    auto* bytes = static_cast<juce::uint8*>(data.getData());
+
+    for (juce::int64 index = 0; index < length; ++index) {
+        bytes[index] = static_cast<juce::uint8>((index * 131 + index / 257) & 0xff);
+    }
+
+    return data;
+}
+}  // namespace audiobatch::tests::fingerprint
+
+using namespace audiobatch::tests;
+using namespace audiobatch::tests::fingerprint;
+
+/// Compares FileFingerprint with the XXH64 reference implementation.
+class FileFingerprintTests final : public juce::UnitTest
+{
+public:
+    FileFingerprintTests() :
+        juce::UnitTest("FileFingerprint", "AudioBatch")
+    { }
+
+    void runTest() override
+    {
+        beginTest("XXH64 matches the reference implementation");
+        testHashVectors();
+
+        beginTest("File fingerprints hash the size and the sampled or full contents");
+        testFileVectors();
+
+        beginTest("Mode names round trip");
+
+        for (const auto mode : {AudioFingerprintMode::none, AudioFingerprintMode::fast, AudioFingerprintMode::full}) {
+            const auto parsed = FileFingerprint::parseModeName(" " + FileFingerprint::getModeName(mode).toUpperCase());
+            expect(parsed.has_value() && *parsed == mode, FileFingerprint::getModeName(mode));
+        }
+
+        expect(!FileFingerprint::parseModeName("sampled").has_value());
+    }
+
+private:
+    void testHashVectors()
+    {
+        // Published digests of the empty string and of "abc".
+        expect(FileFingerprint::hash("", 0) == 0xEF46DB3751D8E999ULL, "empty input");
+        expect(FileFingerprint::hash("abc", 3) == 0x44BC2CF5AD770999ULL, "\"abc\"");
+
+        for (const auto& [length, digest, seededDigest] : hashVectors) {
+            const auto data = makePattern(static_cast<juce::int64>(length));
+            const auto label = juce::String(static_cast<int>(length)) + " bytes";
+            expect(FileFingerprint::hash(data.getData(), length) == digest, label);
+            expect(FileFingerprint::hash(data.getData(), length, testSeed) == seededDigest, label + ", seeded");
+        }
+    }
+
+    void testFileVectors()
+    {
+        const ScratchDirectory scratch;
+
+        for (const auto& [length, fast, full] : fileVectors) {
+            const auto data = makePattern(length);
+            const auto file = scratch.directory.getChildFile("pattern" + juce::String(length) + ".bin");
+            expect(file.replaceWithData(data.getData(), data.getSize()));
+
+            const auto label = juce::String(length) + " bytes";
+            expectEquals(FileFingerprint::compute(file, AudioFingerprintMode::fast), juce::String(fast), label);
+            expectEquals(FileFingerprint::compute(file, AudioFingerprintMode::full), juce::String(full), label);
+            expectEquals(FileFingerprint::compute(file, AudioFingerprintMode::none), juce::String(), label);
+
+            // The prefetch stage fingerprints its in-memory copy, which must agree with the file.
+            for (const auto mode : {AudioFingerprintMode::fast, AudioFingerprintMode::full}) {
+                expectEquals(
+                    FileFingerprint::compute(file, data, mode),
+                    FileFingerprint::compute(file, mode),
+                    label + " in memory, " + FileFingerprint::getModeName(mode)
+                );
+            }
+        }
+
+        expectEquals(
+            FileFingerprint::compute(scratch.directory.getChildFile("missing.bin"), AudioFingerprintMode::full),
+            juce::String()
+        );
+    }
+};
+
+static FileFingerprintTests fileFingerprintTests;
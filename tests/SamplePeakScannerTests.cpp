@@ -0,0 +1,259 @@
+/// Unit tests for SamplePeakScanner.
+/// Runs every kernel available on the machine through the explicit-kernel overloads
+/// and requires the same extremes and interleaved output as the scalar reference,
+/// over every tail length up to several vector widths and blocks with NaN, signed zero, and infinite samples.
+
+#include "SamplePeakScanner.h"
+
+#include <JuceHeader.h>
+
+#include <cstring>
+#include <limits>
+#include <vector>
+
+/// Signal generators and comparison helpers for the sample peak scanner tests.
+namespace audiobatch::tests::peak
+{
+using Kernel = SamplePeakScanner::Kernel;
+
+constexpr auto infinity = std::numeric_limits<float>::infinity();
+constexpr auto quietNaN = std::numeric_limits<float>::quiet_NaN();
+
+/// Longest block length tested sample by sample, covering every tail of the widest kernel's unrolled loop.
+constexpr int maximumTailTestLength = 80;
+
+/// Running extremes the scan starts from: the analysis start value, empty extremes, and a signed zero.
+constexpr std::array<std::pair<float, float>, 3> startingExtremes {{
+    {0.0f, 0.0f},
+    {infinity, -infinity},
+    {-0.0f, -0.0f},
+}};
+
+/// Returns the vector kernels available on this machine. The scalar kernel is the reference.
+static std::vector<Kernel> getVectorKernels()
+{
+    std::vector<Kernel> kernels;
+
+    for (const auto kernel : {Kernel::sse, Kernel::avx2, Kernel::neon}) {
+        if (SamplePeakScanner::isKernelAvailable(kernel)) {
+            kernels.push_back(kernel);
+        }
+    }
+
+    return kernels;
+}
+
+/// Fills a block with random full-scale samples.
+static std::vector<float> makeNoise(juce::Random& random, const int numSamples)
+{
+    std::vector<float> samples(static_cast<size_t>(numSamples));
+
+    for (auto& sample : samples) {
+        sample = random.nextFloat() * 2.0f - 1.0f;
+    }
+
+    return samples;
+}
+
+/// Returns the named blocks each kernel is compared on, at the given length.
+/// The special values land at the start, in the vector body, and in the scalar tail.
+static std::vector<std::pair<juce::String, std::vector<float>>> makeSignals(juce::Random& random, const int numSamples)
+{
+    std::vector<std::pair<juce::String, std::vector<float>>> signals;
+    signals.emplace_back("noise", makeNoise(random, numSamples));
+
+    auto withNaN = makeNoise(random, numSamples);
+
+    for (int index = 0; index < numSamples; index += 7) {
+        withNaN[static_cast<size_t>(index)] = quietNaN;
+    }
+
+    if (numSamples > 0) {
+        withNaN.back() = quietNaN;
+    }
+
+    signals.emplace_back("NaN", std::move(withNaN));
+    signals.emplace_back("all NaN", std::vector(static_cast<size_t>(numSamples), quietNaN));
+
+    std::vector<float> signedZeros(static_cast<size_t>(numSamples));
+
+    for (int index = 0; index < numSamples; ++index) {
+        signedZeros[static_cast<size_t>(index)] = index % 3 == 0 ? -0.0f : 0.0f;
+    }
+
+    signals.emplace_back("signed zeros", std::move(signedZeros));
+
+    auto withInfinity = makeNoise(random, numSamples);
+
+    if (numSamples > 2) {
+        withInfinity[static_cast<size_t>(numSamples / 2)] = infinity;
+        withInfinity[static_cast<size_t>(numSamples - 1)] = -infinity;
+    }
+
+    signals.emplace_back("infinity", std::move(withInfinity));
+
+    // A single loud sample in the last position only reaches the result through the scalar tail.
+    auto tailPeak = makeNoise(random, numSamples);
+
+    if (numSamples > 0) {
+        tailPeak.back() = -1.5f;
+    }
+
+    signals.emplace_back("tail peak", std::move(tailPeak));
+    return signals;
+}
+
+/// Returns true when the extremes are equal. Documented as free to differ only in the sign of a zero,
+/// which compares equal here as well.
+static bool sameExtreme(const float actual, const float expected)
+{
+    return juce::exactlyEqual(actual, expected) || (std::isnan(actual) && std::isnan(expected));
+}
+}  // namespace audiobatch::tests::peak
+
+using namespace audiobatch::tests::peak;
+
+/// Compares every available kernel against the scalar reference.
+class SamplePeakScannerTests final : public juce::UnitTest
+{
+public:
+    SamplePeakScannerTests() :
+        juce::UnitTest("SamplePeakScanner", "AudioBatch")
+    { }
+
+    void runTest() override
+    {
+        const auto kernels = getVectorKernels();
+        logMessage("Vector kernels available: " + juce::String(static_cast<int>(kernels.size())));
+
+        beginTest("Scalar kernel is always available");
+        expect(SamplePeakScanner::isKernelAvailable(Kernel::scalar));
+        expect(SamplePeakScanner::isKernelAvailable(SamplePeakScanner::getActiveKernel()));
+
+        beginTest("Extremes match the scalar reference");
+
+        for (const auto kernel : kernels) {
+            testExtrema(kernel);
+        }
+
+        beginTest("Fused interleave matches the scalar reference");
+
+        for (const auto kernel : kernels) {
+            testInterleave(kernel);
+        }
+    }
+
+private:
+    /// Block lengths tested: every length up to maximumTailTestLength and a few long blocks.
+    static std::vector<int> getLengths()
+    {
+        std::vector<int> lengths;
+
+        for (int length = 0; length <= maximumTailTestLength; ++length) {
+            lengths.push_back(length);
+        }
+
+        for (const auto length : {1000, 4096, 4099}) {
+            lengths.push_back(length);
+        }
+
+        return lengths;
+    }
+
+    void testExtrema(const Kernel kernel)
+    {
+        const auto kernelName = SamplePeakScanner::getKernelName(kernel);
+        juce::Random random(1);
+        int mismatches = 0;
+
+        for (const auto length : getLengths()) {
+            for (const auto& [signalName, samples] : makeSignals(random, length)) {
+                for (const auto& [startMinimum, startMaximum] : startingExtremes) {
+                    auto expectedMinimum = startMinimum;
+                    auto expectedMaximum = startMaximum;
+                    SamplePeakScanner::updateExtrema(
+                        Kernel::scalar, samples.data(), length, expectedMinimum, expectedMaximum
+                    );
+
+                    auto minimum = startMinimum;
+                    auto maximum = startMaximum;
+                    SamplePeakScanner::updateExtrema(kernel, samples.data(), length, minimum, maximum);
+
+                    if (!sameExtreme(minimum, expectedMinimum) || !sameExtreme(maximum, expectedMaximum)) {
+                        ++mismatches;
+                        expect(
+                            false,
+                            kernelName + " extremes differ for " + signalName + " of "
+                                + juce::String(length) + " samples"
+                        );
+                    }
+                }
+            }
+        }
+
+        expectEquals(mismatches, 0, kernelName);
+    }
+
+    void testInterleave(const Kernel kernel)
+    {
+        const auto kernelName = SamplePeakScanner::getKernelName(kernel);
+        juce::Random random(2);
+        int mismatches = 0;
+
+        // Stereo has dedicated kernels, while other channel counts go through the per-channel path.
+        for (const auto numChannels : {1, 2, 3}) {
+            for (const auto length : getLengths()) {
+                const auto signals = makeSignals(random, length);
+                std::vector<const float*> channels;
+
+                for (int channel = 0; channel < numChannels; ++channel) {
+                    channels.push_back(signals[static_cast<size_t>(channel) % signals.size()].second.data());
+                }
+
+                const auto outputSize = static_cast<size_t>(numChannels * length);
+                std::vector<float> expectedInterleaved(outputSize, 2.0f);
+                std::vector<float> interleaved(outputSize, 3.0f);
+                std::vector expectedMinimums(static_cast<size_t>(numChannels), 0.0f);
+                std::vector expectedMaximums(static_cast<size_t>(numChannels), 0.0f);
+                auto minimums = expectedMinimums;
+                auto maximums = expectedMaximums;
+
+                SamplePeakScanner::interleaveWithExtrema(
+                    Kernel::scalar,
+                    channels.data(),
+                    numChannels,
+                    length,
+                    expectedInterleaved.data(),
+                    expectedMinimums.data(),
+                    expectedMaximums.data()
+                );
+
+                SamplePeakScanner::interleaveWithExtrema(
+                    kernel, channels.data(), numChannels, length, interleaved.data(), minimums.data(), maximums.data()
+                );
+
+                // The interleaved output is a copy, so it must match bit for bit, NaN payloads included.
+                auto matches = std::memcmp(interleaved.data(), expectedInterleaved.data(), outputSize * sizeof(float))
+                    == 0;
+
+                for (size_t channel = 0; channel < static_cast<size_t>(numChannels); ++channel) {
+                    matches = matches && sameExtreme(minimums[channel], expectedMinimums[channel])
+                        && sameExtreme(maximums[channel], expectedMaximums[channel]);
+                }
+
+                if (!matches) {
+                    ++mismatches;
+                    expect(
+                        false,
+                        kernelName + " interleave differs for " + juce::String(numChannels) + " channels of "
+                            + juce::String(length) + " samples"
+                    );
+                }
+            }
+        }
+
+        expectEquals(mismatches, 0, kernelName);
+    }
+};
+
+static SamplePeakScannerTests samplePeakScannerTests;
@@ -0,0 +1,26 @@
+/// Temporary directories for unit tests that work with real files.
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace audiobatch::tests
+{
+/// An empty directory below the temporary folder, deleted with its contents afterwards.
+struct ScratchDirectory {
+    juce::File directory = juce::File::getSpecialLocation(juce::File::tempDirectory)
+                               .getNonexistentChildFile("AudioBatchTests", {}, false);
+
+    ScratchDirectory()
+    {
+        directory.createDirectory();
+    }
+
+    ~ScratchDirectory()
+    {
+        directory.deleteRecursively();
+    }
+
+    JUCE_DECLARE_NON_COPYABLE(ScratchDirectory)
+};
+}  // namespace audiobatch::tests
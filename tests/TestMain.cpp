@@ -0,0 +1,30 @@
+/// Console entry point for the unit test executable.
+/// Runs every juce::UnitTest registered in the AudioBatch category
+/// and returns a non-zero exit code when any expectation failed, so CTest reports the failure.
+/// Tests that need a process to kill start this executable again with a helper option from TestProcesses.h.
+
+#include "TestProcesses.h"
+
+#include <JuceHeader.h>
+
+/// Entry point for the unit test executable.
+int main(int argc, char* argv[])
+{
+    const juce::ArgumentList arguments(argc, argv);
+
+    if (arguments.containsOption(audiobatch::tests::analysisCacheCrashWriterOption)) {
+        return audiobatch::tests::runAnalysisCacheCrashWriter(arguments);
+    }
+
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure(false);
+    runner.runTestsInCategory("AudioBatch");
+
+    int failures = 0;
+
+    for (int index = 0; index < runner.getNumResults(); ++index) {
+        failures += runner.getResult(index)->failures;
+    }
+
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,20 @@
+/// Helper processes that unit tests start from the test executable itself.
+/// TestMain runs the helper named on the command line instead of the tests,
+/// so a test can kill a real process in the middle of its work.
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace audiobatch::tests
+{
+/// Runs the analysis cache crash writer on the database given as its value.
+constexpr auto analysisCacheCrashWriterOption = "--analysis-cache-crash-writer";
+/// File the crash writer reports its progress to.
+constexpr auto progressFileOption = "--progress-file";
+
+/// Queues analysis records into the database, flushing now and then and writing the number of records
+/// known to be committed to the progress file, until the process is killed.
+/// Returns a non-zero exit code when the database cannot be opened.
+int runAnalysisCacheCrashWriter(const juce::ArgumentList& arguments);
+}  // namespace audiobatch::tests
@@ -0,0 +1,173 @@
+/// Unit tests for ThumbnailCacheData.
+/// Round-trips AudioThumbnail::saveTo streams with odd and even channel counts through compress and decompress,
+/// and requires truncated blobs, garbage, and streams whose header does not match their length to come back empty.
+/// Also reports how long unpacking the preview of a one-hour file takes.
+
+#include "ThumbnailCacheData.h"
+
+#include <JuceHeader.h>
+
+#include <cmath>
+
+/// Synthetic thumbnail streams for the cache data tests.
+namespace audiobatch::tests::thumbnail
+{
+/// Source samples per thumbnail frame, as used by ThumbnailComponent.
+constexpr int samplesPerThumbSample = 1024;
+constexpr int sampleRate = 44100;
+/// Frames in the preview of a one-hour file at the sample rate above.
+constexpr int oneHourFrames = 3600 * sampleRate / samplesPerThumbSample;
+/// Unpacks of the one-hour preview that are timed.
+constexpr int timedDecodeRuns = 20;
+
+/// Returns a stream in the layout AudioThumbnail::saveTo writes: the header followed by a min and a max byte
+/// per channel per frame. The envelope changes slowly with some noise, like the preview of real material.
+static juce::MemoryBlock makeThumbnailData(const int numChannels, const int numFrames)
+{
+    juce::MemoryBlock data;
+    juce::Random random(numFrames);
+    const auto totalSamples = static_cast<juce::int64>(numFrames) * samplesPerThumbSample;
+
+    {
+        juce::MemoryOutputStream output(data, false);
+        output.write("jatm", 4);
+        output.writeInt(samplesPerThumbSample);
+        output.writeInt64(totalSamples);
+        output.writeInt64(totalSamples);
+        output.writeInt(numFrames);
+        output.writeInt(numChannels);
+        output.writeInt(sampleRate);
+        output.writeInt64(0);
+        output.writeInt64(0);
+
+        for (int frame = 0; frame < numFrames; ++frame) {
+            for (int channel = 0; channel < numChannels; ++channel) {
+                const auto envelope = 0.5 + 0.4 * std::sin(frame * 0.003 + channel);
+                const auto level = juce::jlimit(0, 127, static_cast<int>(127.0 * envelope) + random.nextInt(9) - 4);
+                output.writeByte(static_cast<char>(-level));
+                output.writeByte(static_cast<char>(level));
+            }
+        }
+    }
+
+    return data;
+}
+}  // namespace audiobatch::tests::thumbnail
+
+using namespace audiobatch::tests::thumbnail;
+
+/// Checks that cached waveform previews unpack to exactly what was packed, or not at all.
+class ThumbnailCacheDataTests final : public juce::UnitTest
+{
+public:
+    ThumbnailCacheDataTests() :
+        juce::UnitTest("ThumbnailCacheData", "AudioBatch")
+    { }
+
+    void runTest() override
+    {
+        beginTest("Thumbnails round trip with any channel count");
+        testRoundTrip();
+
+        beginTest("Truncated blobs are rejected");
+        testTruncation();
+
+        beginTest("Garbage and inconsistent streams are rejected");
+        testGarbage();
+
+        beginTest("One-hour preview unpacks quickly");
+        testLongFileDecode();
+    }
+
+private:
+    void testRoundTrip()
+    {
+        for (const auto numChannels : {1, 2, 3, 5, 6, 7}) {
+            for (const auto numFrames : {0, 1, 2, 1000}) {
+                const auto data = makeThumbnailData(numChannels, numFrames);
+                const auto packed = ThumbnailCacheData::compress(data, numChannels);
+                const auto label = juce::String(numChannels) + " channels, " + juce::String(numFrames) + " frames";
+                expect(ThumbnailCacheData::decompress(packed) == data, label);
+
+                if (numFrames == 1000) {
+                    expect(packed.getSize() < data.getSize(), label + " did not shrink");
+                }
+            }
+        }
+    }
+
+    void testTruncation()
+    {
+        for (const auto numChannels : {1, 2, 3}) {
+            const auto data = makeThumbnailData(numChannels, 1000);
+            const auto packed = ThumbnailCacheData::compress(data, numChannels);
+            int misreadLengths = 0;
+
+            for (size_t length = 0; length < packed.getSize(); ++length) {
+                const auto unpacked = ThumbnailCacheData::decompress(juce::MemoryBlock(packed.getData(), length));
+
+                // Cutting only the zlib trailer can leave every thumbnail byte intact, which is then correct.
+                const auto cutsPayload = length + 16 < packed.getSize();
+
+                if (cutsPayload ? !unpacked.isEmpty() : !(unpacked.isEmpty() || unpacked == data)) {
+                    ++misreadLengths;
+                }
+            }
+
+            expectEquals(misreadLengths, 0, juce::String(numChannels) + " channels");
+        }
+    }
+
+    void testGarbage()
+    {
+        juce::Random random(17);
+
+        for (int blob = 0; blob < 200; ++blob) {
+            juce::MemoryBlock garbage(static_cast<size_t>(random.nextInt(4096)));
+            random.fillBitsRandomly(garbage.getData(), garbage.getSize());
+            expect(ThumbnailCacheData::decompress(garbage).isEmpty(), "random blob " + juce::String(blob));
+        }
+
+        const auto data = makeThumbnailData(3, 100);
+
+        // A zero stride byte cannot come from compress.
+        auto zeroStride = ThumbnailCacheData::compress(data, 3);
+        static_cast<juce::uint8*>(zeroStride.getData())[0] = 0;
+        expect(ThumbnailCacheData::decompress(zeroStride).isEmpty(), "zero stride");
+
+        // Valid zlib data that is not a thumbnail stream.
+        juce::MemoryBlock untagged(data);
+        untagged[0] = 'x';
+        expect(ThumbnailCacheData::decompress(ThumbnailCacheData::compress(untagged, 3)).isEmpty(), "missing tag");
+
+        // A stream missing its last frame, and one with a spare byte, both disagree with their header.
+        const juce::MemoryBlock shortened(data.getData(), data.getSize() - 6);
+        expect(ThumbnailCacheData::decompress(ThumbnailCacheData::compress(shortened, 3)).isEmpty(), "short stream");
+
+        juce::MemoryBlock extended(data);
+        extended.append("\0", 1);
+        expect(ThumbnailCacheData::decompress(ThumbnailCacheData::compress(extended, 3)).isEmpty(), "long stream");
+    }
+
+    void testLongFileDecode()
+    {
+        const auto data = makeThumbnailData(2, oneHourFrames);
+        const auto packed = ThumbnailCacheData::compress(data, 2);
+        auto decodeMs = 0.0;
+
+        for (int run = 0; run < timedDecodeRuns; ++run) {
+            const auto startMs = juce::Time::getMillisecondCounterHiRes();
+            const auto unpacked = ThumbnailCacheData::decompress(packed);
+            decodeMs += juce::Time::getMillisecondCounterHiRes() - startMs;
+            expect(unpacked == data);
+        }
+
+        logMessage(
+            "One-hour stereo preview: " + juce::String(static_cast<int>(data.getSize() / 1024)) + " KiB raw, "
+            + juce::String(static_cast<int>(packed.getSize() / 1024)) + " KiB packed, "
+            + juce::String(decodeMs / timedDecodeRuns, 2) + " ms per unpack"
+        );
+    }
+};
+
+static ThumbnailCacheDataTests thumbnailCacheDataTests;
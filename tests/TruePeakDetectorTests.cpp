@@ -0,0 +1,196 @@
+/// Unit tests for TruePeakDetector.
+/// Measures generated signals with every available kernel and with libebur128's true peak mode,
+/// and requires the results to agree within 0.01 dB.
+/// The signals are fed to the detector in blocks of varying length, so the filter history is covered too.
+
+#include "TruePeakDetector.h"
+
+extern "C" {
+#include <ebur128.h>
+}
+
+#include <JuceHeader.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+/// Signal generators and reference measurement for the true peak tests.
+namespace audiobatch::tests::truepeak
+{
+using Kernel = SamplePeakScanner::Kernel;
+
+/// Largest allowed difference from libebur128, in dB.
+constexpr double toleranceDb = 0.01;
+constexpr int numChannels = 2;
+constexpr int signalSeconds = 1;
+
+/// A generated stereo test signal, one vector per channel.
+struct TestSignal {
+    juce::String name;
+    std::vector<std::vector<float>> channels;
+};
+
+/// Returns a signal whose samples come from the generator, given the channel and the time in seconds.
+static TestSignal makeSignal(
+    const juce::String& name,
+    const int sampleRate,
+    const std::function<float(int channel, double seconds)>& generator
+)
+{
+    TestSignal signal {name, {}};
+    const auto numSamples = sampleRate * signalSeconds;
+
+    for (int channel = 0; channel < numChannels; ++channel) {
+        auto& samples = signal.channels.emplace_back(static_cast<size_t>(numSamples));
+
+        for (int index = 0; index < numSamples; ++index) {
+            samples[static_cast<size_t>(index)] = generator(channel, static_cast<double>(index) / sampleRate);
+        }
+    }
+
+    return signal;
+}
+
+/// Returns the test signals for the sample rate.
+/// The quarter sample rate sine at a 45 degree phase never samples its crest, so its true peak is 3 dB above
+/// the sample peak, and the square wave overshoots between samples, so both fail without interpolation.
+static std::vector<TestSignal> makeSignals(const int sampleRate)
+{
+    constexpr auto twoPi = juce::MathConstants<double>::twoPi;
+    const auto rate = static_cast<double>(sampleRate);
+    std::vector<TestSignal> signals;
+
+    signals.push_back(makeSignal("quarter rate sine", sampleRate, [rate](const int channel, const double seconds) {
+        return static_cast<float>(0.5 * std::sin(twoPi * rate / 4.0 * seconds + twoPi / 8.0 * (channel + 1)));
+    }));
+
+    signals.push_back(makeSignal("1 kHz sine", sampleRate, [](const int channel, const double seconds) {
+        return static_cast<float>((channel == 0 ? 0.9 : 0.25) * std::sin(twoPi * 997.0 * seconds));
+    }));
+
+    signals.push_back(makeSignal("square wave", sampleRate, [](const int channel, const double seconds) {
+        const auto frequency = channel == 0 ? 441.0 : 1234.5;
+        return std::fmod(seconds * frequency, 1.0) < 0.5 ? 0.5f : -0.5f;
+    }));
+
+    juce::Random random(sampleRate);
+
+    signals.push_back(makeSignal("noise", sampleRate, [&random](int, double) {
+        return random.nextFloat() * 1.6f - 0.8f;
+    }));
+
+    return signals;
+}
+
+/// Measures the signal with libebur128 and returns each channel's true peak as a linear magnitude.
+static std::vector<double> measureWithLibebur128(const TestSignal& signal, const int sampleRate)
+{
+    const auto numSamples = signal.channels.front().size();
+    std::vector<float> interleaved(numSamples * numChannels);
+
+    for (size_t index = 0; index < numSamples; ++index) {
+        for (size_t channel = 0; channel < numChannels; ++channel) {
+            interleaved[index * numChannels + channel] = signal.channels[channel][index];
+        }
+    }
+
+    std::vector peaks(numChannels, 0.0);
+    auto* state = ebur128_init(numChannels, static_cast<unsigned long>(sampleRate), EBUR128_MODE_TRUE_PEAK);
+
+    if (state == nullptr) {
+        return peaks;
+    }
+
+    ebur128_add_frames_float(state, interleaved.data(), numSamples);
+
+    for (unsigned int channel = 0; channel < numChannels; ++channel) {
+        ebur128_true_peak(state, channel, &peaks[channel]);
+    }
+
+    ebur128_destroy(&state);
+    return peaks;
+}
+
+/// Measures the signal with the detector in blocks of random length
+/// and folds in the sample peak, as the analysis does, since the last samples never leave the filter delay.
+static std::vector<double> measureWithDetector(const Kernel kernel, const TestSignal& signal, const int sampleRate)
+{
+    TruePeakDetector detector(numChannels, sampleRate);
+    std::vector peaks(numChannels, 0.0);
+    juce::Random random(sampleRate + static_cast<int>(kernel));
+    const auto numSamples = static_cast<int>(signal.channels.front().size());
+
+    for (int start = 0; start < numSamples;) {
+        const auto blockSize = std::min(numSamples - start, 1 + random.nextInt(4096));
+        const std::array<const float*, numChannels> channels {
+            signal.channels[0].data() + start, signal.channels[1].data() + start
+        };
+
+        detector.process(kernel, channels.data(), blockSize, peaks.data());
+        start += blockSize;
+    }
+
+    for (size_t channel = 0; channel < numChannels; ++channel) {
+        for (const auto sample : signal.channels[channel]) {
+            peaks[channel] = std::max(peaks[channel], static_cast<double>(std::abs(sample)));
+        }
+    }
+
+    return peaks;
+}
+}  // namespace audiobatch::tests::truepeak
+
+using namespace audiobatch::tests::truepeak;
+
+/// Compares the detector against libebur128 on generated signals.
+class TruePeakDetectorTests final : public juce::UnitTest
+{
+public:
+    TruePeakDetectorTests() :
+        juce::UnitTest("TruePeakDetector", "AudioBatch")
+    { }
+
+    void runTest() override
+    {
+        std::vector<Kernel> kernels;
+
+        for (const auto kernel : {Kernel::scalar, Kernel::sse, Kernel::avx2, Kernel::neon}) {
+            if (SamplePeakScanner::isKernelAvailable(kernel)) {
+                kernels.push_back(kernel);
+            }
+        }
+
+        beginTest("Oversampling factor follows the sample rate");
+        expectEquals(TruePeakDetector(numChannels, 44100).getOversamplingFactor(), 4);
+        expectEquals(TruePeakDetector(numChannels, 96000).getOversamplingFactor(), 2);
+        expectEquals(TruePeakDetector(numChannels, 192000).getOversamplingFactor(), 1);
+
+        // 192 kHz is not oversampled, so there the true peak is the sample peak on both sides.
+        for (const auto sampleRate : {44100, 48000, 96000, 192000}) {
+            beginTest("True peak matches libebur128 at " + juce::String(sampleRate) + " Hz");
+
+            for (const auto& signal : makeSignals(sampleRate)) {
+                const auto expectedPeaks = measureWithLibebur128(signal, sampleRate);
+
+                for (const auto kernel : kernels) {
+                    const auto peaks = measureWithDetector(kernel, signal, sampleRate);
+
+                    for (size_t channel = 0; channel < numChannels; ++channel) {
+                        expectWithinAbsoluteError(
+                            juce::Decibels::gainToDecibels(peaks[channel]),
+                            juce::Decibels::gainToDecibels(expectedPeaks[channel]),
+                            toleranceDb,
+                            signal.name + ", channel " + juce::String(static_cast<int>(channel)) + ", "
+                                + SamplePeakScanner::getKernelName(kernel) + " kernel"
+                        );
+                    }
+                }
+            }
+        }
+    }
+};
+
+static TruePeakDetectorTests truePeakDetectorTests;